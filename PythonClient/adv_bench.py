@@ -0,0 +1,74 @@
+"""Measures how long a freshly started scanner takes to discover the device.
+
+Each round starts a new BleakScanner, as a central coming up cold would, and
+times the first advertisement carrying the HID service and the first one
+that also carries the name (which the device puts in its scan response).
+
+    python adv_bench.py [--rounds 20] [--timeout 10] [--name Azmuth]
+"""
+import argparse
+import asyncio
+import statistics
+import time
+
+from bleak import BleakScanner
+
+from main import DEVICE_NAME
+
+HID_SERVICE_UUID = "00001812-0000-1000-8000-00805f9b34fb"
+
+
+async def discover_once(name, timeout):
+    """(seconds to the HID advertisement, seconds to the name), None if unseen."""
+    seen = {}
+    done = asyncio.Event()
+    start = time.perf_counter()
+
+    def on_adv(device, adv):
+        now = time.perf_counter() - start
+        if HID_SERVICE_UUID in adv.service_uuids:
+            seen.setdefault("hid", now)
+            seen.setdefault("addr", device.address)
+        if adv.local_name and name.lower() in adv.local_name.lower():
+            seen.setdefault("name", now)
+            if device.address == seen.get("addr"):
+                done.set()
+
+    async with BleakScanner(detection_callback=on_adv):
+        try:
+            await asyncio.wait_for(done.wait(), timeout)
+        except asyncio.TimeoutError:
+            pass
+    return seen.get("hid"), seen.get("name")
+
+
+def summary(label, values):
+    found = [v for v in values if v is not None]
+    if not found:
+        return f"{label}: never seen"
+    return (f"{label}: {len(found)}/{len(values)} found, min {min(found) * 1000:.0f} ms, "
+            f"median {statistics.median(found) * 1000:.0f} ms, max {max(found) * 1000:.0f} ms")
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--rounds", type=int, default=20)
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--name", default=DEVICE_NAME)
+    args = parser.parse_args()
+
+    hid, named = [], []
+    for i in range(args.rounds):
+        t_hid, t_name = await discover_once(args.name, args.timeout)
+        hid.append(t_hid)
+        named.append(t_name)
+        print(f"round {i + 1}: hid {t_hid if t_hid is None else f'{t_hid * 1000:.0f} ms'}, "
+              f"name {t_name if t_name is None else f'{t_name * 1000:.0f} ms'}")
+        await asyncio.sleep(0.5)  # let the adapter drop its cache between rounds
+
+    print(summary("HID service", hid))
+    print(summary("Name", named))
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,153 @@
+"""Holds one connection to the device open for any number of client runs.
+
+    python daemon.py                # or --address AA:BB:..., or --sim
+    python main.py volup            # goes through the daemon while it runs
+
+Clients find the daemon through daemon.json in the client cache directory,
+which holds its loopback port and a token only the current user can read;
+streams that do not start with the token are closed. Writes, reads and
+notifications pass through as the packets of host_sim/sim_link.h, each
+behind a 2-byte length (transport.DaemonTransport). When the link drops the
+daemon connects again, and clients that subscribed keep their notifications.
+"""
+import argparse
+import asyncio
+import os
+import secrets
+import struct
+
+import transport
+from main import DEVICE_NAME
+from transport import (ATT_ERR_UNLIKELY, MSG_HELLO, MSG_MTU, MSG_MTU_RSP, MSG_NOTIFY, MSG_READ, MSG_READ_RSP,
+                       MSG_SUBSCRIBE, MSG_WRITE, MSG_WRITE_CMD, MSG_WRITE_RSP, SIM_UUIDS)
+
+READY_TIMEOUT = 15.0  # how long a request waits for the device to come back
+RECONNECT_DELAY = 1.0
+
+
+class Daemon:
+    def __init__(self, args, token):
+        self.args = args
+        self.token = token
+        self.device = None
+        self.ready = asyncio.Event()
+        self.subscribers = {chr_id: set() for chr_id in SIM_UUIDS}
+        self.notifying = set()  # characteristics subscribed on the current link
+        self.att_lock = asyncio.Lock()
+
+    # ── Device side ──
+    async def hold(self):
+        while True:
+            device = transport.from_arguments(self.args, DEVICE_NAME)
+            try:
+                async with device:
+                    self.device = device
+                    self.notifying.clear()
+                    for chr_id, subs in self.subscribers.items():
+                        if subs:
+                            await self.subscribe(chr_id)
+                    self.ready.set()
+                    print(f"Connected to {device.description}, MTU {device.mtu_size}")
+                    await device.disconnected.wait()
+                    print("Link lost, connecting again")
+            except Exception as e:  # keep the daemon up whatever the link did
+                print(f"Connection failed: {e}")
+            self.ready.clear()
+            self.device = None
+            await asyncio.sleep(RECONNECT_DELAY)
+
+    async def subscribe(self, chr_id):
+        if chr_id in self.notifying:
+            return
+        self.notifying.add(chr_id)
+        await self.device.start_notify(SIM_UUIDS[chr_id], lambda _, data: self.fan_out(chr_id, data))
+
+    def fan_out(self, chr_id, data):
+        pkt = bytes((MSG_NOTIFY, chr_id)) + bytes(data)
+        for writer in self.subscribers[chr_id]:
+            transport.write_frame(writer, pkt)
+
+    # ── Client side ──
+    async def serve(self, reader, writer):
+        try:
+            hello = await transport.read_frame(reader)
+            if not secrets.compare_digest(hello, bytes((MSG_HELLO, 0)) + self.token.encode()):
+                return
+            while True:
+                pkt = await transport.read_frame(reader)
+                if len(pkt) < 2:
+                    break
+                rsp = await self.handle(pkt[0], pkt[1], pkt[2:], writer)
+                if rsp:
+                    transport.write_frame(writer, rsp)
+                    await writer.drain()
+        except ConnectionError:
+            pass
+        finally:
+            for subs in self.subscribers.values():
+                subs.discard(writer)
+            writer.close()
+
+    async def handle(self, msg, chr_id, data, writer):
+        """The response packet for one client packet, None when it has none."""
+        try:
+            await asyncio.wait_for(self.ready.wait(), READY_TIMEOUT)
+        except asyncio.TimeoutError:
+            return self.refuse(msg)
+        if msg == MSG_MTU:
+            return bytes((MSG_MTU_RSP, 0)) + struct.pack("<H", self.device.mtu_size)
+        uuid = SIM_UUIDS.get(chr_id)
+        if uuid is None:
+            return self.refuse(msg)
+        try:
+            if msg == MSG_WRITE_CMD:
+                await self.device.write_gatt_char(uuid, data, response=False)
+            elif msg == MSG_SUBSCRIBE:
+                self.subscribers[chr_id].add(writer)
+                await self.subscribe(chr_id)
+            elif msg == MSG_WRITE:
+                async with self.att_lock:
+                    await self.device.write_gatt_char(uuid, data, response=True)
+                return bytes((MSG_WRITE_RSP, chr_id, 0))
+            elif msg == MSG_READ:
+                async with self.att_lock:
+                    value = await self.device.read_gatt_char(uuid)
+                return bytes((MSG_READ_RSP, chr_id, 0)) + bytes(value)
+        except Exception as e:
+            print(f"Request 0x{msg:02x} failed: {e}")
+            return self.refuse(msg, getattr(e, "att_error", None))
+        return None
+
+    @staticmethod
+    def refuse(msg, att_error=None):
+        rsp = {MSG_WRITE: MSG_WRITE_RSP, MSG_READ: MSG_READ_RSP}.get(msg)
+        return bytes((rsp, 0, att_error or ATT_ERR_UNLIKELY)) if rsp else None
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    transport.add_arguments(parser)
+    parser.add_argument("--port", type=int, default=0, help="loopback port (default: any free one)")
+    args = parser.parse_args()
+    args.no_daemon = True
+
+    token = secrets.token_hex(16)
+    daemon = Daemon(args, token)
+    server = await asyncio.start_server(daemon.serve, "127.0.0.1", args.port)
+    port = server.sockets[0].getsockname()[1]
+    path = transport.daemon_file()
+    transport.write_private(path, {"port": port, "token": token, "pid": os.getpid()})
+    print(f"Listening on 127.0.0.1:{port}")
+    try:
+        async with server:
+            await daemon.hold()
+    finally:
+        if transport.read_json(path).get("token") == token:
+            os.remove(path)
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,265 @@
+"""Drives several devices at once from one event loop.
+
+    python fleet.py --count 3                       # the first 3 devices found
+    python fleet.py --address AA:.. BB:..           # these devices
+    python fleet.py --sim /tmp/a.sock /tmp/b.sock   # host_sim instances
+    python fleet.py --count 4 --script cmds.txt --shard
+
+One scan finds all devices and they connect concurrently. Every device has
+its own send queue and sender task, so a slow or lossy link only delays its
+own commands; a full queue drops the command for that device and counts it.
+At the prompt:
+
+  <cmd>                 send to every device (text or any main.py command)
+  shard <cmd>           send to the next device in turn
+  @<i> <cmd>            send to device i
+  script <path> [shard] every line of a file, to all devices or dealt out in turn
+  sync                  time-sync every device
+  at +<ms> <cmd>        run cmd on every device at one instant of the synced clock
+  stats                 per-device throughput, latency and link state
+  exit / quit
+"""
+import argparse
+import asyncio
+import collections
+import contextlib
+import os
+import time
+
+import hid_proto
+import transport
+from hid_proto import WRITE_CHAR_UUID
+from main import DEVICE_NAME, ClockSync, now_us, write_text
+
+QUEUE_SIZE = 256
+LATENCY_SAMPLES = 1024
+EXEC_WAIT = 1.0  # seconds after the due time to wait for execution reports
+
+
+class Device:
+    """One connected device: its send queue, sender task and counters."""
+
+    def __init__(self, index, client):
+        self.index = index
+        self.client = client
+        self.queue = asyncio.Queue(QUEUE_SIZE)
+        self.clock = ClockSync(client, self.on_exec)
+        self.sync = None  # (offset us, round trip us) of the last sync
+        self.execs = []
+        self.sent = 0
+        self.bytes = 0
+        self.dropped = 0
+        self.failed = 0
+        self.latency = collections.deque(maxlen=LATENCY_SAMPLES)  # submit to last write, seconds
+        self.started = time.perf_counter()
+
+    def submit(self, cmd):
+        try:
+            self.queue.put_nowait((time.perf_counter(), cmd))
+        except asyncio.QueueFull:
+            self.dropped += 1
+
+    async def sender(self):
+        while True:
+            queued_at, cmd = await self.queue.get()
+            try:
+                if hid_proto.is_command(cmd):
+                    data = cmd.encode()
+                    await self.client.write_gatt_char(WRITE_CHAR_UUID, data, response=False)
+                    self.bytes += len(data)
+                else:
+                    self.bytes += (await write_text(self.client, cmd))[0]
+                self.sent += 1
+                self.latency.append(time.perf_counter() - queued_at)
+            except Exception as e:
+                self.failed += 1
+                print(f"[{self.index}] {cmd!r} failed: {e}")
+            finally:
+                self.queue.task_done()
+
+    def on_exec(self, msg):
+        self.execs.append(msg)
+
+    def report(self):
+        elapsed = time.perf_counter() - self.started
+        line = (f"[{self.index}] {self.client.description}: {self.sent} cmds, {self.bytes} B, "
+                f"{self.bytes / elapsed:.0f} B/s")
+        if self.latency:
+            lat = sorted(self.latency)
+            pick = lambda q: lat[min(len(lat) - 1, int(q * len(lat)))] * 1000
+            line += f", latency p50 {pick(0.5):.1f} ms p95 {pick(0.95):.1f} ms max {lat[-1] * 1000:.1f} ms"
+        line += f", queued {self.queue.qsize()}, dropped {self.dropped}, failed {self.failed}"
+        if self.sync:
+            line += f", sync rtt {self.sync[1]} us"
+        return line
+
+
+class Fleet:
+    def __init__(self, devices):
+        self.devices = devices
+        self._next = 0
+
+    def broadcast(self, cmd):
+        for d in self.devices:
+            d.submit(cmd)
+
+    def shard(self, cmd):
+        self.devices[self._next % len(self.devices)].submit(cmd)
+        self._next += 1
+
+    async def drain(self):
+        await asyncio.gather(*(d.queue.join() for d in self.devices))
+
+    async def sync(self):
+        async def one(d):
+            try:
+                d.sync = await d.clock.sync()
+            except Exception as e:
+                print(f"[{d.index}] sync failed: {e}")
+        await asyncio.gather(*(one(d) for d in self.devices))
+        for d in self.devices:
+            if d.sync:
+                print(f"[{d.index}] offset {d.sync[0]} us, round trip {d.sync[1]} us")
+
+    async def at(self, lead_ms, cmd):
+        """Schedules cmd on every device for the same client-clock instant
+        and reports how far apart the devices actually ran it."""
+        if not all(d.sync for d in self.devices):
+            print("Not every device is synced; run 'sync' first")
+            return
+        due_ms = now_us() // 1000 + lead_ms
+        for d in self.devices:
+            d.execs.clear()
+            await d.clock.start()
+            d.submit(f"at {due_ms} {cmd}")
+        await asyncio.sleep(max(0.0, due_ms / 1000 - time.time()) + EXEC_WAIT)
+        ran = {}
+        for d in self.devices:
+            if not d.execs:
+                print(f"[{d.index}] no execution report")
+                continue
+            msg = d.execs[-1]
+            ran[d.index] = msg["due"] + msg["late"]
+            print(f"[{d.index}] ran {msg['late']} us late, +/-{msg['uncertainty']} us")
+        if len(ran) > 1:
+            bound = max(d.execs[-1]["uncertainty"] for d in self.devices if d.execs)
+            print(f"Spread {max(ran.values()) - min(ran.values())} us across {len(ran)} devices "
+                  f"(clock error up to +/-{bound} us each)")
+
+    async def script(self, path, shard):
+        with open(path, encoding="utf-8") as f:
+            for line in f:
+                line = line.rstrip("\r\n")
+                if line:
+                    (self.shard if shard else self.broadcast)(line)
+        await self.drain()
+
+    async def command(self, cmd):
+        word, _, rest = cmd.partition(" ")
+        if word == "shard":
+            self.shard(rest)
+        elif word.startswith("@") and word[1:].isdigit():
+            index = int(word[1:])
+            if index >= len(self.devices):
+                print(f"No device {index}")
+                return
+            self.devices[index].submit(rest)
+        elif word == "script":
+            shard = rest.endswith(" shard")
+            await self.script(rest[:-len(" shard")] if shard else rest, shard)
+        elif word == "sync":
+            await self.sync()
+        elif word == "at" and rest.startswith("+"):
+            lead, _, inner = rest[1:].partition(" ")
+            await self.at(int(lead), inner)
+        elif word == "stats":
+            for d in self.devices:
+                print(d.report())
+        else:
+            self.broadcast(cmd)
+
+
+async def discover(name, count, timeout):
+    """Up to count devices from one scan, returned as soon as count are seen."""
+    from bleak import BleakScanner
+
+    found = {}
+    done = asyncio.Event()
+
+    def on_adv(device, adv):
+        if hid_proto.SERVICE_UUID in adv.service_uuids or \
+                (adv.local_name and name.lower() in adv.local_name.lower()):
+            found.setdefault(device.address, device)
+            if len(found) >= count:
+                done.set()
+
+    async with BleakScanner(detection_callback=on_adv):
+        with contextlib.suppress(asyncio.TimeoutError):
+            await asyncio.wait_for(done.wait(), timeout)
+    return list(found.values())[:count]
+
+
+async def transports(args):
+    if args.sim:
+        link = lambda: transport.LinkModel(args.interval, args.loss)
+        return [transport.SimTransport(path, link(), args.mtu) for path in args.sim]
+    targets = args.address or await discover(args.name, args.count, args.scan_timeout)
+    if not args.address:
+        print(f"Found {len(targets)} of {args.count} devices")
+    # Explicit addresses never read the cache; keep main.py's entry intact
+    cache = transport.DeviceCache(os.path.join(transport.cache_dir(), "fleet.json"))
+    return [transport.BleakTransport(t, args.name, cache=cache) for t in targets]
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=2, help="devices to find when scanning")
+    parser.add_argument("--address", nargs="+", help="connect to these devices without scanning")
+    parser.add_argument("--sim", nargs="+", metavar="SOCKET", help="host_sim instances instead of BLE")
+    parser.add_argument("--name", default=DEVICE_NAME)
+    parser.add_argument("--scan-timeout", type=float, default=10.0)
+    parser.add_argument("--interval", type=float, default=0.0, metavar="MS",
+                        help="simulated connection interval (--sim)")
+    parser.add_argument("--loss", type=float, default=0.0, help="simulated retry share (--sim)")
+    parser.add_argument("--mtu", type=int, default=247, help="ATT MTU to request (--sim)")
+    parser.add_argument("--script", help="send this file's lines, print stats and exit")
+    parser.add_argument("--shard", action="store_true", help="deal --script lines out instead of broadcasting")
+    args = parser.parse_args()
+
+    candidates = await transports(args)
+    async with contextlib.AsyncExitStack() as stack:
+        started = time.perf_counter()
+        results = await asyncio.gather(*(stack.enter_async_context(t) for t in candidates),
+                                       return_exceptions=True)
+        devices = []
+        for t, r in zip(candidates, results):
+            if isinstance(r, BaseException):
+                print(f"{t.description}: connection failed: {r}")
+            else:
+                devices.append(Device(len(devices), r))
+        if not devices:
+            return
+        print(f"Connected {len(devices)} devices in {time.perf_counter() - started:.2f} s")
+        fleet = Fleet(devices)
+        senders = [asyncio.create_task(d.sender()) for d in devices]
+        try:
+            if args.script:
+                await fleet.script(args.script, args.shard)
+                await fleet.command("stats")
+                return
+            while True:
+                cmd = (await asyncio.to_thread(input, "fleet> ")).strip()
+                if cmd.lower() in ("exit", "quit"):
+                    break
+                try:
+                    if cmd:
+                        await fleet.command(cmd)
+                except Exception as e:
+                    print(f"Failed: {e}")
+        finally:
+            for task in senders:
+                task.cancel()
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
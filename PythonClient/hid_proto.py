@@ -0,0 +1,342 @@
+"""Binary command frames understood by the device (see main/hid_proto.h).
+
+Every frame is  0x00 | opcode | payload length | payload  and several frames
+may share one GATT write. Text commands never start with a NUL byte.
+"""
+import re
+import struct
+
+import lzss
+
+# Custom service (CUSTOM_SERVICE_UUID_BASE in main/mainHid.c), also in the scan response
+SERVICE_UUID = "12345678-9012-3456-7890-abcdef123456"
+# Custom service characteristics (CUSTOM_CHAR_*_UUID_BASE in main/mainHid.c)
+WRITE_CHAR_UUID = "04030201-fceb-dac9-b8a7-f6e5d4c3b2a1"
+STATUS_CHAR_UUID = "14131211-6c5b-4a39-2817-06f5e4d3c2b1"
+CLOCK_CHAR_UUID = "24232221-7c6b-5a49-3827-1605f4e3d2c1"
+STATS_CHAR_UUID = "34333231-8c7b-6a59-4837-261504f3e2d1"
+CONFIG_CHAR_UUID = "44434241-9c8b-7a69-5847-36251403f2e1"
+CHAR_UUIDS = (WRITE_CHAR_UUID, STATUS_CHAR_UUID, CLOCK_CHAR_UUID, STATS_CHAR_UUID, CONFIG_CHAR_UUID)
+
+FRAME_MARKER = 0x00
+FRAME_HDR_LEN = 3
+MAX_PAYLOAD = 255
+
+OP_POS = 0x01
+OP_TEXT_Z = 0x02
+OP_TIME_SYNC = 0x03
+OP_CLOCK_SET = 0x04
+OP_SCRIPT = 0x05
+OP_MACRO_STORE = 0x06
+OP_MACRO_RUN = 0x07
+
+TEXT_Z_F_START = 0x01
+TEXT_Z_F_STORED = 0x02
+SCRIPT_F_START = 0x01
+MACRO_F_START = 0x01
+MACRO_F_END = 0x02
+
+# Script steps (hid_proto.h), compiled by hid_script.py
+STEP_KEYS = 0x01
+STEP_TAP = 0x02
+STEP_TIMING = 0x03
+STEP_MOUSE = 0x04
+STEP_CONSUMER = 0x05
+STEP_CONSUMER_BITS = 0x06
+STEP_ABS = 0x07
+STEP_WAIT = 0x08
+# Length of each step; STEP_KEYS is followed by its key count of keys
+STEP_LEN = {STEP_KEYS: 4, STEP_TAP: 3, STEP_TIMING: 3, STEP_MOUSE: 5, STEP_CONSUMER: 4,
+            STEP_CONSUMER_BITS: 3, STEP_ABS: 7, STEP_WAIT: 3}
+CHORD_MAX = 16  # HID_KEY_CHORD_MAX in main/hid_output.h
+
+MACRO_SLOTS = 4   # HID_MACRO_SLOTS in main/hid_macro.h
+MACRO_MAX = 1024  # HID_MACRO_MAX
+
+# Status characteristic: keyboard LEDs + protocol mode
+LED_NUM_LOCK = 0x01
+LED_CAPS_LOCK = 0x02
+LED_SCROLL_LOCK = 0x04
+
+# Text commands the device parses itself (main/hid_cmd.c run_command): a
+# keyword alone, or a keyword, a space and arguments it accepts. Anything
+# else is typed, is_command() tells which.
+COMMAND_WORDS = ("volup", "voldown", "mute", "play", "next", "prev", "stop", "click", "rightclick",
+                 "abort", "stats")
+MEDIA_NAMES = ("volup", "voldown", "mute", "play", "next", "prev", "stop")
+CONSUMER_BATCH_MAX = 8  # HID_CONSUMER_BATCH_MAX in main/hid_output.h
+MOTION_MAX_POINTS = 16  # HID_MOTION_MAX_POINTS in main/hid_motion.h
+MOTION_MAX_DURATION_MS = 60000  # HID_MOTION_MAX_DURATION_MS
+ABS_POINTER_MAX = 32767  # HID_ABS_POINTER_MAX in main/hid_report_map.h
+
+# Clock characteristic messages
+CLOCK_MSG_SYNC = 0x01
+CLOCK_MSG_EXEC = 0x02
+UNSYNCED = 0xFFFFFFFF
+LATE_MAX = 0x7FFFFFFF  # late saturates here, about 35 minutes
+
+# Stats characteristic: boot phases in hid_boot_phase_t order (main/hid_boot.h)
+BOOT_PHASES = ("app_main", "nvs", "controller", "services", "host start",
+               "host sync", "advertising", "connected", "deferred")
+NOT_REACHED = 0xFFFFFFFF
+
+# Config characteristic (main/hid_config.h)
+CFG_OP_SET = 0x01
+CFG_OP_RESET = 0x02
+CFG_OP_VIEW = 0x03
+CFG_VIEW_VALUES = 0
+CFG_VIEW_SCHEMA = 1
+CFG_TYPE_U8 = 1
+CFG_TYPE_U16 = 2
+CFG_TYPE_U32 = 3
+CFG_TYPE_STR = 4
+CFG_F_REBOOT = 0x01
+CFG_F_SECRET = 0x02
+CFG_INT_FORMATS = {CFG_TYPE_U8: "<B", CFG_TYPE_U16: "<H", CFG_TYPE_U32: "<I"}
+
+
+def frame(op: int, payload: bytes = b"") -> bytes:
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("frame payload too long")
+    return bytes((FRAME_MARKER, op, len(payload))) + payload
+
+
+def pos(x: int, y: int, buttons: int = 0) -> bytes:
+    return frame(OP_POS, struct.pack("<HHB", x, y, buttons))
+
+
+def time_sync(seq: int, client_us: int) -> bytes:
+    return frame(OP_TIME_SYNC, struct.pack("<BQ", seq & 0xFF, client_us))
+
+
+def clock_set(offset_us: int, rtt_us: int) -> bytes:
+    return frame(OP_CLOCK_SET, struct.pack("<qI", offset_us, rtt_us))
+
+
+def parse_clock(data: bytes) -> dict:
+    if data[0] == CLOCK_MSG_SYNC:
+        seq, t1, t2, t3 = struct.unpack_from("<BQQQ", data, 1)
+        return {"type": "sync", "seq": seq, "t1": t1, "t2": t2, "t3": t3}
+    due, late, uncertainty = struct.unpack_from("<QiI", data, 1)
+    return {"type": "exec", "due": due, "late": late, "uncertainty": uncertainty}
+
+
+def clock_offset(t1: int, t2: int, t3: int, t4: int):
+    """(offset, round trip) from one exchange; client clock = device + offset."""
+    rtt = (t4 - t1) - (t3 - t2)
+    offset = ((t1 - t2) + (t4 - t3)) // 2
+    return offset, rtt
+
+
+def parse_stats(data: bytes) -> dict:
+    """Boot phase -> microseconds since reset, None for phases not reached."""
+    times = struct.unpack_from("<%dI" % data[0], data, 1)
+    return {name: (None if t == NOT_REACHED else t)
+            for name, t in zip(BOOT_PHASES, times)}
+
+
+def config_view(view: int, start: int = 0) -> bytes:
+    return bytes((CFG_OP_VIEW, view, start))
+
+
+def config_reset() -> bytes:
+    return bytes((CFG_OP_RESET,))
+
+
+def parse_config(data: bytes):
+    """(view, first key index, key count, entries) from one config read.
+
+    Values entries are (key, raw value), schema entries are
+    (key, type, flags, min, max, name).
+    """
+    _version, view, start, count = data[:4]
+    entries, i = [], 4
+    while i < len(data):
+        if view == CFG_VIEW_SCHEMA:
+            key, typ, flags, lo, hi, n = struct.unpack_from("<BBBIIB", data, i)
+            i += 12
+            entries.append((key, typ, flags, lo, hi, data[i:i + n].decode("ascii")))
+        else:
+            key, n = data[i], data[i + 1]
+            i += 2
+            entries.append((key, bytes(data[i:i + n])))
+        i += n
+    return view, start, count, entries
+
+
+def config_decode(typ: int, raw: bytes):
+    if typ == CFG_TYPE_STR:
+        return raw.decode("ascii")
+    return struct.unpack(CFG_INT_FORMATS[typ], raw)[0]
+
+
+def config_set(schema: dict, values: dict) -> bytes:
+    """One write setting every name -> value in values, applied all or none.
+
+    schema maps key names to (key, type, flags, min, max) as read from the
+    device; values are checked against it before anything is sent.
+    """
+    out = bytearray((CFG_OP_SET,))
+    for name, value in values.items():
+        if name not in schema:
+            raise ValueError(f"unknown config key '{name}'")
+        key, typ, _flags, lo, hi = schema[name]
+        if typ == CFG_TYPE_STR:
+            raw = str(value).encode("ascii")
+            if not lo <= len(raw) <= hi:
+                raise ValueError(f"{name}: {lo} to {hi} characters")
+        else:
+            value = int(value, 0) if isinstance(value, str) else value
+            if not lo <= value <= hi:
+                raise ValueError(f"{name}: {lo} to {hi}")
+            raw = struct.pack(CFG_INT_FORMATS[typ], value)
+        out += bytes((key, len(raw))) + raw
+    return bytes(out)
+
+
+def parse_status(data: bytes) -> dict:
+    leds, mode = data[0], data[1]
+    return {
+        "num_lock": bool(leds & LED_NUM_LOCK),
+        "caps_lock": bool(leds & LED_CAPS_LOCK),
+        "scroll_lock": bool(leds & LED_SCROLL_LOCK),
+        "protocol": "boot" if mode == 0 else "report",
+    }
+
+
+_INT = r"[+-]?\d+"
+_HEX = r"[+-]?(?:0[xX])?[0-9a-fA-F]+"
+
+
+def _ints(args, counts):
+    """args is blank-separated integers (strtol rules), as many as one of counts."""
+    if not re.fullmatch(rf" *(?:{_INT}(?:(?: +|(?=[+-])){_INT})*)? *", args):
+        return False
+    return len(re.findall(_INT, args)) in counts
+
+
+def _motion(args, counts, duration_last=False):
+    """Motion arguments: int16 points and a duration the device accepts."""
+    if not _ints(args, counts):
+        return False
+    v = [int(x) for x in re.findall(_INT, args)]
+    duration = v.pop(2 if duration_last else 0)
+    return 0 <= duration <= MOTION_MAX_DURATION_MS and all(-32768 <= x <= 32767 for x in v)
+
+
+def _media(args):
+    keys = args.split()
+    return 0 < len(keys) <= CONSUMER_BATCH_MAX and all(
+        k in MEDIA_NAMES or re.fullmatch(_HEX, k) and 0 < int(k, 16) <= 0x3FF for k in keys)
+
+
+def _chord(args):
+    keys = args.split()
+    return 0 < len(keys) <= 1 + CHORD_MAX and all(re.fullmatch(_HEX, k) for k in keys) and \
+        int(keys[0], 16) <= 0xFF
+
+
+_COMMAND_ARGS = {
+    "unimode": lambda a: a.lower() in ("linux", "windows", "mac"),
+    "kbdmode": lambda a: a in ("6kro", "nkro"),
+    "at": lambda a: re.fullmatch(r"\+?\d+ +[^ ].*", a, re.S) is not None,
+    "pos": lambda a: _ints(a, (2,)) and all(0 <= int(v) <= ABS_POINTER_MAX for v in re.findall(_INT, a)),
+    "macro": lambda a: re.fullmatch(r"\d+ *", a) is not None and int(a) < MACRO_SLOTS,
+    "media": _media,
+    "chord": _chord,
+    "move": lambda a: _ints(a, (2,)),
+    "moveto": lambda a: _motion(a, (3,), duration_last=True),
+    "path": lambda a: _motion(a, range(3, 2 + 2 * MOTION_MAX_POINTS, 2)),
+    "drag": lambda a: _motion(a, range(3, 2 + 2 * MOTION_MAX_POINTS, 2)),
+    "bezier": lambda a: _motion(a, (7,)),
+}
+
+
+def is_command(text: str) -> bool:
+    """Whether the device runs text as a command rather than typing it."""
+    word, space, args = text.partition(" ")
+    if word in COMMAND_WORDS:
+        return not space
+    check = _COMMAND_ARGS.get(word)
+    return bool(check and args and check(args))
+
+
+def text_writes(text: str, max_write: int, min_gain: float = 0.9):
+    """Splits text into GATT writes, compressing when it pays off.
+
+    Text always goes out as OP_TEXT_Z frames, so no chunk is ever read as a
+    command. Compression is only used when the compressed stream plus
+    framing stays below min_gain of the raw size; otherwise the chunks are
+    stored text. Returns (writes, starts, compressed), starts holding where
+    in the UTF-8 text each write begins.
+    """
+    # Non-ASCII characters are typed by the device via the host input method
+    raw = text.encode("utf-8")
+    packed = lzss.compress(raw)
+    chunk = min(max_write, MAX_PAYLOAD) - FRAME_HDR_LEN - 1
+    nframes = -(-len(packed) // chunk)
+    if raw and len(packed) + nframes * (FRAME_HDR_LEN + 1) < len(raw) * min_gain:
+        writes = []
+        for i in range(0, len(packed), chunk):
+            flags = TEXT_Z_F_START if i == 0 else 0
+            writes.append(frame(OP_TEXT_Z, bytes((flags,)) + packed[i:i + chunk]))
+        return writes, lzss.chunk_starts(packed, chunk), True
+
+    # Stored text: typed as-is
+    writes = []
+    for i in range(0, len(raw), chunk):
+        flags = TEXT_Z_F_STORED | (TEXT_Z_F_START if i == 0 else 0)
+        writes.append(frame(OP_TEXT_Z, bytes((flags,)) + raw[i:i + chunk]))
+    return writes, list(range(0, len(raw), chunk)), False
+
+
+def split_steps(steps: bytes) -> list:
+    """Compiled script steps, one bytes object per step."""
+    out, i = [], 0
+    while i < len(steps):
+        n = STEP_LEN.get(steps[i])
+        if n is None:
+            raise ValueError(f"unknown script step 0x{steps[i]:02x} at {i}")
+        if steps[i] == STEP_KEYS:
+            n += steps[i + 3]
+        out.append(bytes(steps[i:i + n]))
+        i += n
+    return out
+
+
+def _step_chunks(steps: bytes, limit: int):
+    """Runs of whole steps of at most limit bytes each."""
+    chunks, cur = [], b""
+    for step in split_steps(steps):
+        if cur and len(cur) + len(step) > limit:
+            chunks.append(cur)
+            cur = b""
+        cur += step
+    return chunks + [cur] if cur else chunks
+
+
+def script_writes(steps: bytes, max_write: int):
+    """OP_SCRIPT frames replaying compiled steps, one per GATT write.
+
+    A step never spans two frames, so the device runs each frame as it comes.
+    """
+    limit = min(max_write, FRAME_HDR_LEN + MAX_PAYLOAD) - FRAME_HDR_LEN - 1
+    return [frame(OP_SCRIPT, bytes((SCRIPT_F_START if i == 0 else 0,)) + chunk)
+            for i, chunk in enumerate(_step_chunks(steps, limit))]
+
+
+def macro_writes(slot: int, steps: bytes, max_write: int):
+    """OP_MACRO_STORE frames that save compiled steps to a macro slot."""
+    if not 0 <= slot < MACRO_SLOTS:
+        raise ValueError(f"macro slot 0..{MACRO_SLOTS - 1}")
+    if not 0 < len(steps) <= MACRO_MAX:
+        raise ValueError(f"a macro holds 1 to {MACRO_MAX} bytes of steps, this one has {len(steps)}")
+    limit = min(max_write, FRAME_HDR_LEN + MAX_PAYLOAD) - FRAME_HDR_LEN - 2
+    chunks = _step_chunks(steps, limit)
+    return [frame(OP_MACRO_STORE, bytes((slot, (MACRO_F_START if i == 0 else 0) |
+                                         (MACRO_F_END if i == len(chunks) - 1 else 0))) + chunk)
+            for i, chunk in enumerate(chunks)]
+
+
+def macro_run(slot: int) -> bytes:
+    return frame(OP_MACRO_RUN, bytes((slot,)))
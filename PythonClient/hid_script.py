@@ -0,0 +1,582 @@
+"""Compiles HID scripts into the binary script steps of main/hid_proto.h.
+
+    python hid_script.py demo.hid                   # compile and report
+    python hid_script.py demo.hid --mtu 23 --interval 30 --phy 2 --steps
+
+Keys are resolved for the host's keyboard layout and every delay is made
+explicit when compiling, so the device parses nothing and only sends the
+reports. A script is one command per line, '#' starts a comment:
+
+  text <chars>              type chars; \\n, \\t and \\\\ are Enter, Tab and \\
+  line <chars>              the same followed by Enter
+  key <chord> [ms]          press a chord such as ctrl+alt+delete, held ms
+  hold <chord> / release    keep a chord down, then let everything go
+  wait <ms>
+  timing k=v ...            press, release, gap (text), click, media, tick (mouse) in ms;
+                            the device waits in 10 ms ticks, shorter delays round up
+  move dx dy [ms]           move at once, or glide over ms
+  path ms x1 y1 [x2 y2 ..]  follow a polyline, points relative to the start
+  drag ms x1 y1 [x2 y2 ..]  the same with the left button held
+  bezier ms cx1 cy1 cx2 cy2 x y
+  click [left|right|middle]
+  pos x y                   absolute pointer, 0..32767 per axis
+  media <key> ...           volup voldown mute play next prev stop or hex usages, in turn
+  repeat <n> ... end        the block n times (unrolled here)
+  layout us|uk              host keyboard layout (default us)
+  unimode linux|windows|mac host input method for non-ASCII text (default linux)
+
+Compiled scripts are cached under the client cache directory, keyed by
+their source, so replaying an unchanged script compiles nothing. The report
+gives the run time the steps ask for and what sending them costs on the air.
+"""
+import argparse
+import hashlib
+import os
+
+import hid_proto
+import transport
+from hid_proto import (STEP_ABS, STEP_CONSUMER, STEP_CONSUMER_BITS, STEP_KEYS, STEP_MOUSE, STEP_TAP, STEP_TIMING,
+                       STEP_WAIT)
+
+VERSION = 1  # part of the cache key; bump when the same source compiles differently
+MAX_STEPS = 1 << 20  # bytes of steps a script may unroll to
+
+# Device defaults (main/hid_config.c), the pacing until a 'timing' line
+DEFAULT_TIMING = {"press": 20, "release": 10, "gap": 100, "click": 20, "media": 30, "tick": 10}
+
+MODIFIERS = {
+    "ctrl": 0x01, "control": 0x01, "shift": 0x02, "alt": 0x04, "option": 0x04,
+    "gui": 0x08, "win": 0x08, "cmd": 0x08, "super": 0x08, "meta": 0x08,
+    "rctrl": 0x10, "rshift": 0x20, "ralt": 0x40, "altgr": 0x40, "rgui": 0x80,
+}
+NAMED_KEYS = {
+    "enter": 0x28, "return": 0x28, "esc": 0x29, "escape": 0x29, "backspace": 0x2A, "tab": 0x2B,
+    "space": 0x2C, "capslock": 0x39, "printscreen": 0x46, "scrolllock": 0x47, "pause": 0x48,
+    "insert": 0x49, "home": 0x4A, "pageup": 0x4B, "delete": 0x4C, "del": 0x4C, "end": 0x4D,
+    "pagedown": 0x4E, "right": 0x4F, "left": 0x50, "down": 0x51, "up": 0x52, "numlock": 0x53,
+    "menu": 0x65,
+}
+NAMED_KEYS.update({f"f{i}": 0x3A + i - 1 for i in range(1, 13)})
+KEY_ENTER = 0x28
+KEY_U = 0x18
+KP_DIGITS = [0x62] + list(range(0x59, 0x62))  # keypad 0..9
+KP_PLUS = 0x57
+MOD_CTRL, MOD_SHIFT, MOD_ALT = 0x01, 0x02, 0x04
+
+# Consumer usages: the bitmap report's in bit order (HID_CONSUMER_BIT_USAGES), then names
+CONSUMER_BITS = (0xE9, 0xEA, 0xE2, 0xCD, 0xB5, 0xB6, 0xB7)
+MEDIA_NAMES = {"volup": 0xE9, "voldown": 0xEA, "mute": 0xE2, "play": 0xCD, "next": 0xB5,
+               "prev": 0xB6, "stop": 0xB7}
+MOUSE_BUTTONS = {"left": 1, "right": 2, "middle": 4}
+
+
+def _layout(rows, extra):
+    """char -> (modifier, usage) from (usage, plain, shifted) rows."""
+    keys = {}
+    for usage, plain, shifted in rows:
+        keys.setdefault(plain, (0, usage))
+        keys.setdefault(shifted, (MOD_SHIFT, usage))
+    keys.update(extra)
+    return keys
+
+
+_LETTERS = [(0x04 + i, c, c.upper()) for i, c in enumerate("abcdefghijklmnopqrstuvwxyz")]
+_COMMON = _LETTERS + [(0x1E + i, str((i + 1) % 10), "") for i in range(10)] + \
+    [(0x28, "\n", ""), (0x2B, "\t", ""), (0x2C, " ", ""), (0x2D, "-", "_"), (0x2E, "=", "+"),
+     (0x2F, "[", "{"), (0x30, "]", "}"), (0x33, ";", ":"), (0x36, ",", "<"), (0x37, ".", ">"),
+     (0x38, "/", "?")]
+LAYOUTS = {
+    # Types what main/hid_keymap.c types
+    "us": _layout(_COMMON + [(0x1E + i, "", s) for i, s in enumerate("!@#$%^&*()")] +
+                  [(0x31, "\\", "|"), (0x34, "'", '"'), (0x35, "`", "~")], {}),
+    "uk": _layout(_COMMON + [(0x1E + i, "", s) for i, s in enumerate('!"£$%^&*()')] +
+                  [(0x32, "#", "~"), (0x34, "'", "@"), (0x35, "`", "¬"), (0x64, "\\", "|")],
+                  {"€": (0x40, 0x21)}),  # AltGr+4
+}
+for _keys in LAYOUTS.values():
+    _keys.pop("", None)
+
+
+class ScriptError(ValueError):
+    pass
+
+
+class Compiler:
+    """Turns script source into steps; one instance per compile."""
+
+    def __init__(self, layout="us", unimode="linux"):
+        self.set_layout(layout)
+        self.set_unimode(unimode)
+        self.timing = dict(DEFAULT_TIMING)
+        self.out = bytearray()
+        self.pacing = None  # (press, release) of the last STEP_TIMING
+        self.held = (0, ())  # modifier and keys down after 'hold'
+        self.line = 0
+
+    def set_layout(self, name):
+        if name not in LAYOUTS:
+            raise ScriptError(f"unknown layout '{name}', one of {', '.join(LAYOUTS)}")
+        self.keys = LAYOUTS[name]
+
+    def set_unimode(self, name):
+        if name not in ("linux", "windows", "mac"):
+            raise ScriptError(f"unknown input method '{name}'")
+        self.unimode = name
+
+    def compile(self, source):
+        self.run(parse(source))
+        if self.held != (0, ()):
+            self.keyboard(0, (), self.timing["release"])
+        return bytes(self.out)
+
+    def run(self, nodes):
+        for node in nodes:
+            self.line = node[0]
+            if node[1] == "repeat":
+                for _ in range(node[2]):
+                    self.run(node[3])
+                continue
+            try:
+                getattr(self, "cmd_" + node[1])(node[2])
+            except (ValueError, IndexError) as e:
+                raise ScriptError(f"line {self.line}: {e}") from None
+            if len(self.out) > MAX_STEPS:
+                raise ScriptError(f"line {self.line}: script unrolls to more than {MAX_STEPS} bytes")
+
+    # ── Step output ──
+    def emit(self, code, delay, payload=b""):
+        """A report step; delays past one step's 255 ms continue as a wait."""
+        self.out += bytes((code, min(delay, 255))) + payload
+        self.wait(delay - min(delay, 255))
+
+    def wait(self, ms):
+        while ms > 0:
+            n = min(ms, 0xFFFF)
+            self.out += bytes((STEP_WAIT, n & 0xFF, n >> 8))
+            ms -= n
+
+    def keyboard(self, modifier, keys, delay):
+        if len(keys) > hid_proto.CHORD_MAX:
+            raise ScriptError(f"at most {hid_proto.CHORD_MAX} keys at once")
+        self.emit(STEP_KEYS, delay, bytes((modifier, len(keys))) + bytes(keys))
+
+    def tap(self, modifier, key):
+        t = self.timing
+        release = t["release"] + t["gap"]
+        pacing = (t["press"], min(release, 255))
+        if pacing != self.pacing:
+            self.out += bytes((STEP_TIMING,) + pacing)
+            self.pacing = pacing
+        self.out += bytes((STEP_TAP, modifier, key))
+        self.wait(release - pacing[1])
+
+    def mouse(self, dx, dy, buttons, delay):
+        # Deltas beyond one report's range go out back to back
+        while abs(dx) > 127 or abs(dy) > 127:
+            sx, sy = max(-127, min(127, dx)), max(-127, min(127, dy))
+            self.emit(STEP_MOUSE, 0, bytes((sx & 0xFF, sy & 0xFF, buttons)))
+            dx, dy = dx - sx, dy - sy
+        self.emit(STEP_MOUSE, delay, bytes((dx & 0xFF, dy & 0xFF, buttons)))
+
+    def glide(self, curve, ms, buttons=0):
+        """Relative moves along curve(u) -> (x, y), u from 0 to 1, one per tick."""
+        tick = self.timing["tick"]
+        ticks = max(1, round(ms / tick))
+        x0 = y0 = 0
+        for i in range(1, ticks + 1):
+            x, y = (round(v) for v in curve(i / ticks))
+            self.mouse(x - x0, y - y0, buttons, tick)
+            x0, y0 = x, y
+
+    def require_released(self):
+        if self.held != (0, ()):
+            raise ScriptError("'release' the held keys first")
+
+    # ── Commands ──
+    def cmd_text(self, rest):
+        self.require_released()
+        self.type_text(unescape(rest))
+
+    def cmd_line(self, rest):
+        self.cmd_text(rest + "\\n")
+
+    def cmd_key(self, rest):
+        words = rest.split()
+        modifier, keys = self.chord(words[0])
+        held_mod, held_keys = self.held
+        hold_ms = int(words[1]) if len(words) > 1 else self.timing["press"]
+        self.keyboard(held_mod | modifier, held_keys + tuple(k for k in keys if k not in held_keys), hold_ms)
+        self.keyboard(held_mod, held_keys, self.timing["release"])
+
+    def cmd_hold(self, rest):
+        modifier, keys = self.chord(rest.strip())
+        held_mod, held_keys = self.held
+        self.held = (held_mod | modifier, held_keys + tuple(k for k in keys if k not in held_keys))
+        self.keyboard(*self.held, self.timing["release"])
+
+    def cmd_release(self, rest):
+        self.held = (0, ())
+        self.keyboard(0, (), self.timing["release"])
+
+    def cmd_wait(self, rest):
+        self.wait(int(rest))
+
+    def cmd_timing(self, rest):
+        for kv in rest.split():
+            name, _, value = kv.partition("=")
+            if name not in self.timing:
+                raise ScriptError(f"unknown timing '{name}', one of {', '.join(self.timing)}")
+            value = int(value)
+            lo, hi = (0 if name == "gap" else 1), (255 if name == "press" else 10000)
+            if not lo <= value <= hi:
+                raise ScriptError(f"{name}: {lo} to {hi} ms")
+            self.timing[name] = value
+
+    def cmd_move(self, rest):
+        dx, dy, *ms = (int(v) for v in rest.split())
+        if ms:
+            self.glide(lambda u: (dx * u, dy * u), ms[0])
+        else:
+            self.mouse(dx, dy, 0, self.timing["tick"])
+
+    def cmd_path(self, rest, buttons=0):
+        ms, *coords = (int(v) for v in rest.split())
+        if not coords or len(coords) % 2:
+            raise ScriptError("expected ms and x y pairs")
+        self.glide(polyline([(0, 0)] + list(zip(coords[::2], coords[1::2]))), ms, buttons)
+
+    def cmd_drag(self, rest):
+        self.mouse(0, 0, 1, self.timing["click"])
+        self.cmd_path(rest, buttons=1)
+        self.mouse(0, 0, 0, self.timing["tick"])
+
+    def cmd_bezier(self, rest):
+        ms, cx1, cy1, cx2, cy2, x, y = (int(v) for v in rest.split())
+
+        def curve(u):
+            a, b, c = 3 * (1 - u) ** 2 * u, 3 * (1 - u) * u ** 2, u ** 3
+            return a * cx1 + b * cx2 + c * x, a * cy1 + b * cy2 + c * y
+        self.glide(curve, ms)
+
+    def cmd_click(self, rest):
+        button = MOUSE_BUTTONS.get(rest.strip() or "left")
+        if button is None:
+            raise ScriptError(f"unknown button '{rest.strip()}'")
+        self.mouse(0, 0, button, self.timing["click"])
+        self.mouse(0, 0, 0, self.timing["release"])
+
+    def cmd_pos(self, rest):
+        x, y = (int(v) for v in rest.split())
+        if not (0 <= x <= 32767 and 0 <= y <= 32767):
+            raise ScriptError("position 0..32767 per axis")
+        self.emit(STEP_ABS, self.timing["tick"], x.to_bytes(2, "little") + y.to_bytes(2, "little") + b"\x00")
+
+    def cmd_media(self, rest):
+        for name in rest.split():
+            usage = MEDIA_NAMES.get(name)
+            if usage is None:
+                usage = int(name, 16)
+                if not 0 < usage <= 0x3FF:
+                    raise ScriptError(f"unknown media key '{name}'")
+            if usage in CONSUMER_BITS:
+                self.emit(STEP_CONSUMER_BITS, self.timing["media"], bytes((1 << CONSUMER_BITS.index(usage),)))
+                self.emit(STEP_CONSUMER_BITS, self.timing["release"], b"\x00")
+            else:
+                self.emit(STEP_CONSUMER, self.timing["media"], usage.to_bytes(2, "little"))
+                self.emit(STEP_CONSUMER, self.timing["release"], b"\x00\x00")
+
+    def cmd_layout(self, rest):
+        self.set_layout(rest.strip())
+
+    def cmd_unimode(self, rest):
+        self.set_unimode(rest.strip())
+
+    # ── Keys ──
+    def chord(self, text):
+        modifier, keys = 0, []
+        for part in text.lower().split("+") if text != "+" else ["+"]:
+            if part in MODIFIERS:
+                modifier |= MODIFIERS[part]
+            elif part in NAMED_KEYS:
+                keys.append(NAMED_KEYS[part])
+            elif part in self.keys:
+                mod, key = self.keys[part]
+                modifier |= mod
+                keys.append(key)
+            elif part.startswith("0x"):
+                keys.append(int(part, 16))
+            else:
+                raise ScriptError(f"unknown key '{part}'")
+        if not keys and not modifier:
+            raise ScriptError("empty chord")
+        return modifier, tuple(keys)
+
+    def type_text(self, text):
+        for ch in text:
+            if ch in self.keys:
+                self.tap(*self.keys[ch])
+            elif ord(ch) >= 0x80:
+                self.type_code_point(ord(ch))
+            # other control characters have no key, as on the device
+
+    def type_code_point(self, cp):
+        """What main/hid_unicode.c sends for cp with the host's input method."""
+        t = self.timing
+        hex_key = lambda digit: self.keys["0123456789abcdef"[digit]][1]
+        if self.unimode == "linux":
+            self.tap(MOD_CTRL | MOD_SHIFT, KEY_U)
+            for digit in f"{cp:x}":
+                self.tap(0, hex_key(int(digit, 16)))
+            self.tap(0, KEY_ENTER)
+            return
+        if self.unimode == "windows":
+            # Hex numpad entry (EnableHexNumpad), which stops at U+FFFF
+            if cp > 0xFFFF:
+                raise ScriptError(f"U+{cp:X} cannot be typed with unimode windows")
+            digits = [int(d, 16) for d in f"{cp:x}"]
+            keys = [KP_PLUS] + [KP_DIGITS[d] if d < 10 else hex_key(d) for d in digits]
+        else:
+            units = [cp] if cp <= 0xFFFF else \
+                [0xD800 | (cp - 0x10000) >> 10, 0xDC00 | (cp - 0x10000) & 0x3FF]
+            keys = [hex_key(u >> shift & 0xF) for u in units for shift in (12, 8, 4, 0)]
+        self.keyboard(MOD_ALT, (), t["release"])
+        for key in keys:
+            self.keyboard(MOD_ALT, (key,), t["press"])
+            self.keyboard(MOD_ALT, (), t["release"])
+        self.keyboard(0, (), t["release"] + t["gap"])
+
+
+def unescape(text):
+    out, i = [], 0
+    while i < len(text):
+        if text[i] == "\\" and i + 1 < len(text):
+            out.append({"n": "\n", "t": "\t"}.get(text[i + 1], text[i + 1]))
+            i += 2
+        else:
+            out.append(text[i])
+            i += 1
+    return "".join(out)
+
+
+def polyline(points):
+    """curve(u) walking points at constant speed."""
+    lengths = [((x1 - x0) ** 2 + (y1 - y0) ** 2) ** 0.5 for (x0, y0), (x1, y1) in zip(points, points[1:])]
+    total = sum(lengths) or 1.0
+
+    def curve(u):
+        d = u * total
+        for (x0, y0), (x1, y1), n in zip(points, points[1:], lengths):
+            if d <= n and n:
+                return x0 + (x1 - x0) * d / n, y0 + (y1 - y0) * d / n
+            d -= n
+        return points[-1]
+    return curve
+
+
+def parse(source):
+    """Lines into (line, command, rest) nodes; repeat blocks become
+    (line, 'repeat', count, nodes)."""
+    stack = [[]]
+    opened = []
+    for number, raw in enumerate(source.splitlines(), 1):
+        line = raw.strip()
+        if not line or line.startswith("#"):
+            continue
+        word, _, rest = line.partition(" ")
+        word = word.lower()
+        if word in ("text", "line"):
+            rest = raw.lstrip()[len(word) + 1:]  # spaces in text are kept
+        if word == "repeat":
+            if not rest.strip().isdigit():
+                raise ScriptError(f"line {number}: repeat <count>")
+            opened.append((number, int(rest)))
+            stack.append([])
+        elif word == "end":
+            if not opened:
+                raise ScriptError(f"line {number}: 'end' without 'repeat'")
+            start, count = opened.pop()
+            body = stack.pop()
+            stack[-1].append((start, "repeat", count, body))
+        elif hasattr(Compiler, "cmd_" + word):
+            stack[-1].append((number, word, rest))
+        else:
+            raise ScriptError(f"line {number}: unknown command '{word}'")
+    if opened:
+        raise ScriptError(f"line {opened[-1][0]}: 'repeat' without 'end'")
+    return stack[0]
+
+
+def compile_source(source, layout="us", unimode="linux"):
+    return Compiler(layout, unimode).compile(source)
+
+
+def compile_file(path, layout="us", unimode="linux"):
+    """Compiled steps of a script file, from the cache when the source is unchanged."""
+    with open(path, "rb") as f:
+        source = f.read()
+    key = hashlib.sha256(b"%d\0%s\0%s\0" % (VERSION, layout.encode(), unimode.encode()) + source).hexdigest()
+    cached = os.path.join(transport.cache_dir(), "scripts", key[:32] + ".hids")
+    try:
+        with open(cached, "rb") as f:
+            return f.read()
+    except OSError:
+        pass
+    steps = compile_source(source.decode("utf-8"), layout, unimode)
+    os.makedirs(os.path.dirname(cached), exist_ok=True)
+    with open(cached + ".tmp", "wb") as f:
+        f.write(steps)
+    os.replace(cached + ".tmp", cached)
+    return steps
+
+
+# ───────────────────────── Prediction ─────────────────────────
+DEVICE_TICK_MS = 10  # CONFIG_FREERTOS_HZ=100 in sdkconfig
+UNICODE_TAPS = 10  # HID_UNICODE_MAX_REPORTS / 2, the longest input method sequence
+# Bytes per input report in report protocol (main/hid_report_map.h)
+KEYBOARD_REPORT = {"6kro": 8, "nkro": 14}
+REPORT_LEN = {STEP_MOUSE: 3, STEP_CONSUMER: 6, STEP_CONSUMER_BITS: 1, STEP_ABS: 5}
+
+
+def timeline(steps, tick_ms=DEVICE_TICK_MS):
+    """(start ms, step, reports) for every step and the total run time, from
+    the delays alone; the device waits in whole ticks, so each rounds up."""
+    out, t = [], 0
+    pacing = (DEFAULT_TIMING["press"], DEFAULT_TIMING["release"])  # what a START frame sets
+    for step in hid_proto.split_steps(steps):
+        code, reports, took = step[0], 1, 0
+        if code == STEP_TAP:
+            reports, took = 2, sum(-(-d // tick_ms) * tick_ms for d in pacing)  # press and release wait apart
+        elif code == STEP_TIMING:
+            pacing, reports = (step[1], step[2]), 0
+        elif code == STEP_WAIT:
+            reports, took = 0, step[1] | step[2] << 8
+        else:
+            took = step[1]
+        out.append((t, step, reports))
+        t += -(-took // tick_ms) * tick_ms
+    return out, t
+
+
+def chunk_starts(steps, writes, tick_ms=DEVICE_TICK_MS):
+    """Start ms of the first step of each script write."""
+    starts, (line, _) = [], timeline(steps, tick_ms)
+    i = 0
+    for w in writes:
+        starts.append(line[i][0])
+        body = w[hid_proto.FRAME_HDR_LEN + 1:]
+        i += len(hid_proto.split_steps(body))
+    return starts
+
+
+def text_starts(raw, offsets, press, release, gap, tick_ms=DEVICE_TICK_MS):
+    """Start ms of each text write, offsets being where in raw (UTF-8) each
+    begins. An ASCII character is one tap, any other one UNICODE_TAPS taps
+    through the host input method, each followed by the character gap."""
+    def wait(ms):
+        return -(-ms // tick_ms) * tick_ms
+    ascii_ms = wait(press) + wait(release + gap)
+    unicode_ms = UNICODE_TAPS * (wait(press) + wait(release)) + wait(gap)
+    starts, t, i = [], 0, 0
+    for off in offsets:
+        for b in raw[i:off]:
+            # Continuation bytes cost nothing, the lead byte stands for the character
+            t += ascii_ms if b < 0x80 else unicode_ms if b >= 0xC0 else 0
+        i = max(i, off)
+        starts.append(t)
+    return starts
+
+
+# One LL data PDU adds preamble, access address, header, MIC and CRC; the
+# peer acknowledges it with an empty PDU (no MIC) after 150 us each way
+LL_OVERHEAD = {1: 1 + 4 + 2 + 4 + 3, 2: 2 + 4 + 2 + 4 + 3}
+LL_EMPTY = {1: 1 + 4 + 2 + 3, 2: 2 + 4 + 2 + 3}
+T_IFS_US = 150
+L2CAP_HDR = 4
+ATT_HDR = 3
+
+
+def packet_us(value_len, phy, ll_payload):
+    """Air time of one ATT write or notification carrying value_len bytes."""
+    data = L2CAP_HDR + ATT_HDR + value_len
+    pdus = -(-data // ll_payload)
+    byte_us = 8 / phy
+    return data * byte_us + pdus * ((LL_OVERHEAD[phy] + LL_EMPTY[phy]) * byte_us + 2 * T_IFS_US)
+
+
+def report(steps, mtu=247, phy=1, ll_payload=251, interval_ms=15.0, per_event=4, kbdmode="6kro",
+           tick_ms=DEVICE_TICK_MS):
+    line, duration = timeline(steps, tick_ms)
+    writes = hid_proto.script_writes(steps, mtu - ATT_HDR)
+    write_us = sum(packet_us(len(w), phy, ll_payload) for w in writes)
+    events = -(-len(writes) // per_event)
+    notifies = 0
+    notify_us = 0.0
+    for _, step, reports in line:
+        size = KEYBOARD_REPORT[kbdmode] if step[0] in (STEP_KEYS, STEP_TAP) else REPORT_LEN.get(step[0], 0)
+        notifies += reports
+        notify_us += reports * packet_us(size, phy, ll_payload)
+    return {
+        "steps": len(line), "bytes": len(steps), "duration_ms": duration,
+        "writes": len(writes), "write_bytes": sum(len(w) for w in writes), "write_air_ms": write_us / 1000,
+        "events": events, "upload_ms": events * interval_ms,
+        "reports": notifies, "report_air_ms": notify_us / 1000,
+        "fits_macro": len(steps) <= hid_proto.MACRO_MAX,
+    }
+
+
+def describe(step):
+    code = step[0]
+    signed = lambda b: b - 256 if b > 127 else b
+    if code == STEP_KEYS:
+        return f"keys    mod {step[2]:02x} {' '.join(f'{k:02x}' for k in step[4:]) or ('(up)' if not step[2] else '-')}  +{step[1]} ms"
+    if code == STEP_TAP:
+        return f"tap     mod {step[1]:02x} {step[2]:02x}"
+    if code == STEP_TIMING:
+        return f"timing  press {step[1]} ms release {step[2]} ms"
+    if code == STEP_MOUSE:
+        return f"mouse   {signed(step[2])} {signed(step[3])} buttons {step[4]}  +{step[1]} ms"
+    if code == STEP_CONSUMER:
+        return f"media   {step[2] | step[3] << 8:03x}  +{step[1]} ms"
+    if code == STEP_CONSUMER_BITS:
+        return f"media   bits {step[2]:02x}  +{step[1]} ms"
+    if code == STEP_ABS:
+        return f"pos     {step[2] | step[3] << 8} {step[4] | step[5] << 8}  +{step[1]} ms"
+    return f"wait    {step[1] | step[2] << 8} ms"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("script")
+    parser.add_argument("--layout", default="us", choices=sorted(LAYOUTS), help="until the script says otherwise")
+    parser.add_argument("--unimode", default="linux", choices=("linux", "windows", "mac"))
+    parser.add_argument("--mtu", type=int, default=247, help="ATT MTU the writes are sized for")
+    parser.add_argument("--phy", type=int, default=1, choices=(1, 2), help="LE PHY in Mbit/s")
+    parser.add_argument("--no-dle", action="store_true", help="27-byte link layer packets")
+    parser.add_argument("--interval", type=float, default=15.0, metavar="MS", help="connection interval")
+    parser.add_argument("--per-event", type=int, default=4, help="writes the host sends per connection event")
+    parser.add_argument("--kbdmode", default="6kro", choices=("6kro", "nkro"))
+    parser.add_argument("--tick", type=int, default=DEVICE_TICK_MS, metavar="MS", help="device FreeRTOS tick")
+    parser.add_argument("--steps", action="store_true", help="list the compiled steps")
+    args = parser.parse_args()
+
+    try:
+        steps = compile_file(args.script, args.layout, args.unimode)
+    except ScriptError as e:
+        raise SystemExit(f"{args.script}: {e}")
+    if args.steps:
+        for t, step, _ in timeline(steps, args.tick)[0]:
+            print(f"{t / 1000:9.3f} s  {describe(step)}")
+    r = report(steps, args.mtu, args.phy, 27 if args.no_dle else 251, args.interval, args.per_event,
+               args.kbdmode, args.tick)
+    print(f"{args.script}: {r['steps']} steps in {r['bytes']} bytes, runs {r['duration_ms'] / 1000:.2f} s, "
+          f"{r['reports']} reports")
+    print(f"  replay: {r['writes']} writes, {r['write_bytes']} bytes at MTU {args.mtu}, "
+          f"{r['write_air_ms']:.1f} ms on air, at least {r['events']} connection events "
+          f"({r['upload_ms']:.0f} ms at {args.interval:g} ms)")
+    print(f"  reports: {r['report_air_ms']:.1f} ms on air at {args.phy}M PHY")
+    print(f"  macro: " + (f"fits a slot ({r['bytes']} of {hid_proto.MACRO_MAX} bytes)" if r["fits_macro"]
+                          else f"too big for a slot ({hid_proto.MACRO_MAX} bytes), replay it instead"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+"""Counts the keyboard reports the device needs to type a text file.
+
+Mirrors the typing planner in main/hid_output.c without a device attached:
+the 6-key report takes a press and a release per character, the NKRO report
+rolls from key to key and releases only when the next character needs a
+different modifier, repeats the key or is a Unicode sequence.
+
+    python kbd_bench.py notes.txt [--unimode linux|windows|mac]
+"""
+import argparse
+
+# US layout: shifted symbol -> key it shares with the unshifted one
+_SHIFTED = dict(zip('~!@#$%^&*()_+{}|:"<>?', "`1234567890-=[]\\;',./"))
+_PLAIN = set("abcdefghijklmnopqrstuvwxyz0123456789 \n\r\t-=[]\\;',./`")
+
+
+def ascii_key(ch):
+    """(shift, key) for a character of the keymap, None if it has none."""
+    if ch.isascii() and ch.isupper():
+        return True, ch.lower()
+    if ch in _SHIFTED:
+        return True, _SHIFTED[ch]
+    if ch in _PLAIN:
+        return False, "\n" if ch == "\r" else ch
+    return None
+
+
+def unicode_reports(cp, mode):
+    """Length of the input method sequence hid_unicode.c builds for cp, None if it has none."""
+    if mode == "windows":
+        return 2 + 2 * (1 + len("%x" % cp)) if cp <= 0xFFFF else None
+    if mode == "mac":
+        units = 2 if cp > 0xFFFF else 1
+        return 2 + 8 * units
+    return 4 + 2 * len("%x" % cp)
+
+
+def count_reports(text, nkro, mode="linux"):
+    """(characters typed, keyboard reports sent) for text."""
+    chars = reports = 0
+    held = None  # (shift, key) still down after a rolled character
+
+    for ch in text:
+        key = ascii_key(ch) if ord(ch) < 0x80 else None
+        if key is None and (ord(ch) < 0x80 or unicode_reports(ord(ch), mode) is None):
+            continue  # the device skips it as well
+        chars += 1
+        if held is not None and (key is None or key[0] != held[0] or key[1] == held[1]):
+            reports += 1  # release before the next press
+            held = None
+        if key is None:
+            reports += unicode_reports(ord(ch), mode)
+        elif nkro:
+            reports += 1  # the press also releases the previous key
+            held = key
+        else:
+            reports += 2
+    if held is not None:
+        reports += 1
+    return chars, reports
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("path")
+    parser.add_argument("--unimode", default="linux", choices=("linux", "windows", "mac"))
+    args = parser.parse_args()
+
+    with open(args.path, encoding="utf-8") as f:
+        text = f.read()
+
+    for name, nkro in (("6kro", False), ("nkro", True)):
+        chars, reports = count_reports(text, nkro, args.unimode)
+        per_char = reports / chars if chars else 0.0
+        print(f"{name}: {chars} chars, {reports} reports, {per_char:.2f} per char")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+"""LZSS encoder producing the heatshrink bitstream the device decodes.
+
+Format (MSB first): tag 1 + 8-bit literal, or tag 0 + WINDOW_BITS bits of
+(offset - 1) + LOOKAHEAD_BITS bits of (count - 1). Matches main/hid_lzss.h.
+"""
+
+WINDOW_BITS = 8
+LOOKAHEAD_BITS = 4
+
+_WINDOW = 1 << WINDOW_BITS
+_MAX_MATCH = 1 << LOOKAHEAD_BITS
+# A back-reference costs 1 + W + L bits, a literal 9: only worth it from 2 bytes on
+_MIN_MATCH = 2
+
+
+class _BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.cur = 0
+        self.nbits = 0
+
+    def put(self, value, nbits):
+        for shift in range(nbits - 1, -1, -1):
+            self.cur = (self.cur << 1) | ((value >> shift) & 1)
+            self.nbits += 1
+            if self.nbits == 8:
+                self.out.append(self.cur)
+                self.cur = 0
+                self.nbits = 0
+
+    def finish(self):
+        if self.nbits:
+            self.out.append(self.cur << (8 - self.nbits))
+        return bytes(self.out)
+
+
+def compress(data: bytes) -> bytes:
+    """Greedy LZSS over a 2**WINDOW_BITS byte window."""
+    w = _BitWriter()
+    heads = {}  # 2-byte prefix -> recent positions (newest last)
+    i = 0
+    n = len(data)
+    while i < n:
+        best_len, best_off = 0, 0
+        if i + _MIN_MATCH <= n:
+            for pos in reversed(heads.get(data[i:i + 2], ())):
+                off = i - pos
+                if off > _WINDOW:
+                    break
+                length = 0
+                limit = min(_MAX_MATCH, n - i)
+                while length < limit and data[pos + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_off = length, off
+                    if length == limit:
+                        break
+
+        step = best_len if best_len >= _MIN_MATCH else 1
+        if step > 1:
+            w.put(0, 1)
+            w.put(best_off - 1, WINDOW_BITS)
+            w.put(best_len - 1, LOOKAHEAD_BITS)
+        else:
+            w.put(1, 1)
+            w.put(data[i], 8)
+
+        for p in range(i, i + step):
+            chain = heads.setdefault(data[p:p + 2], [])
+            chain.append(p)
+            if len(chain) > 32:
+                del chain[0]
+        i += step
+    return w.finish()
+
+
+def _decode(data: bytes, out: bytearray):
+    """Decodes data into out, yielding the bits taken after every token."""
+    bits = ((byte >> (7 - k)) & 1 for byte in data for k in range(8))
+    taken = 0
+
+    def take(n):
+        nonlocal taken
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | next(bits)
+        taken += n
+        return v
+
+    try:
+        while True:
+            if take(1):
+                out.append(take(8))
+            else:
+                off = take(WINDOW_BITS) + 1
+                cnt = take(LOOKAHEAD_BITS) + 1
+                for _ in range(cnt):
+                    out.append(out[-off] if off <= len(out) else 0)
+            yield taken
+    except StopIteration:
+        pass
+
+
+def decompress(data: bytes) -> bytes:
+    """Reference decoder, mirrors main/hid_lzss.c."""
+    out = bytearray()
+    for _ in _decode(data, out):
+        pass
+    return bytes(out)
+
+
+def chunk_starts(data: bytes, chunk: int) -> list:
+    """Decoded length at the start of each chunk-byte slice of data; a token
+    split over two slices counts for the second, where it completes."""
+    out, starts, before = bytearray(), [0], 0
+    for taken in _decode(data, out):
+        while len(starts) * chunk < len(data) and len(starts) * chunk * 8 < taken:
+            starts.append(before)
+        before = len(out)
+    while len(starts) * chunk < len(data):
+        starts.append(before)
+    return starts
@@ -0,0 +1,76 @@
+"""Measures LZSS compression ratio and decode cost on prose and source code.
+
+Compresses each corpus with lzss.compress, decodes it with the firmware's
+own decoder (main/hid_lzss.c, built by host_sim as lzss_decode) and checks
+the round trip. The decode cost is host time per KB of decoded text, fed one
+byte at a time as the typing engine does; the device's 'stats' command
+reports the same figure measured on the chip.
+
+    cmake -S host_sim -B host_sim/build && cmake --build host_sim/build
+    python lzss_bench.py --decoder ../host_sim/build/lzss_decode [--prose a.txt] [--code b.c]
+
+Without --prose or --code the README and the firmware sources are used.
+Exits with status 1 when a corpus does not decode to itself.
+"""
+import argparse
+import glob
+import os
+import subprocess
+import sys
+import time
+
+import lzss
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+DEFAULT_DECODER = os.path.join(ROOT, "host_sim", "build", "lzss_decode")
+DEFAULT_PROSE = [os.path.join(ROOT, "README.md")]
+DEFAULT_CODE = sorted(glob.glob(os.path.join(ROOT, "main", "*.[ch]")))
+
+
+def read_corpus(paths):
+    data = b""
+    for path in paths:
+        with open(path, "rb") as f:
+            data += f.read()
+    return data
+
+
+def decode(decoder, stream, rounds):
+    """(decoded bytes, fastest decode in ns) from the C decoder."""
+    proc = subprocess.run([decoder, str(rounds)], input=stream, capture_output=True, check=True)
+    _, ns = proc.stderr.split()
+    return proc.stdout, int(ns)
+
+
+def bench(label, data, decoder, rounds):
+    start = time.perf_counter()
+    stream = lzss.compress(data)
+    compress_s = time.perf_counter() - start
+    text, ns = decode(decoder, stream, rounds)
+    kb = len(data) / 1024
+    print(f"{label}: {len(data)} -> {len(stream)} bytes, ratio {len(stream) / len(data):.1%}, "
+          f"compress {compress_s * 1000 / kb:.1f} ms/KB, decode {ns / 1000 / kb:.1f} us/KB")
+    return text == data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--decoder", default=DEFAULT_DECODER, help="lzss_decode binary from host_sim")
+    parser.add_argument("--prose", nargs="+", default=DEFAULT_PROSE)
+    parser.add_argument("--code", nargs="+", default=DEFAULT_CODE)
+    parser.add_argument("--rounds", type=int, default=20, help="decode rounds, the fastest counts")
+    args = parser.parse_args()
+
+    ok = True
+    for label, paths in (("prose", args.prose), ("code", args.code)):
+        data = read_corpus(paths)
+        if not data:
+            continue
+        if not bench(label, data, args.decoder, args.rounds):
+            print(f"{label}: decoded text differs from the input")
+            ok = False
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,15 @@
+import argparse
 import asyncio
-from bleak import BleakClient, BleakScanner
+import time
+
+import hid_proto
+import hid_script
+import transport
+from hid_proto import CLOCK_CHAR_UUID, CONFIG_CHAR_UUID, STATS_CHAR_UUID, STATUS_CHAR_UUID, WRITE_CHAR_UUID
 
 DEVICE_NAME = "Azmuth"
-WRITE_CHAR_UUID = "00000000-0000-0000-0000-0000000000A1"  # Replace with your actual UUID
+REPLAY_WINDOW = 4   # script or text writes sent ahead of the one the device is running
+REPLAY_SLACK = 1.1  # the device runs a little behind the predicted timeline
 
 COMMANDS_HELP = """
 Available Commands:
@@ -13,42 +20,266 @@ Available Commands:
   next          - Next Track
   prev          - Previous Track
   stop          - Stop Playback
+  media k ...   - Media keys as one batch, names above or hex usages (e.g., media mute 192)
   move x y      - Move mouse by x and y (e.g., move 10 0)
+  moveto x y ms - Glide the mouse by x and y over ms milliseconds
+  path ms x1 y1 [x2 y2 ...]  - Follow a polyline (points relative to the start)
+  drag ms x1 y1 [x2 y2 ...]  - Same as path with the left button held
+  bezier ms cx1 cy1 cx2 cy2 x y - Follow a cubic Bezier curve
+  pos x y       - Put the cursor at an absolute position (0..32767 per axis)
   click         - Left click
   rightclick    - Right Click
+  typefile path - Type the contents of a text file (compressed when it pays off)
+  script path   - Compile a script (hid_script.py) and replay it
+  macro store n path - Compile a script and save it to macro slot n (0..3)
+  macro n       - Run the macro in slot n (also works behind 'at')
+  unimode os    - Host input method for non-ASCII text: linux, windows or mac
+  kbdmode m     - Keyboard report: 6kro, or nkro (rolling text, any chord size)
+  chord mod k.. - Press keys together, hex usages (e.g., chord 05 4c for Ctrl+Alt+Del)
+  sync          - Estimate the device clock offset (needed for absolute 'at' times)
+  at t cmd      - Run cmd at t: Unix time in ms on this PC, or +ms from now
+  abort         - Cancel the text being typed and release all keys
+  stats         - Log per-lane latency and per-transport bytes/s on the device console
+  boot          - Show how long each boot phase of the device took
+  config        - Show the device settings (pairs and asks for encryption)
+  config k=v .. - Change settings in one go (e.g., config key_press_ms=15 char_gap_ms=60)
+  config reset  - Restore the default settings
   exit / quit   - Exit the program
 """
 
 async def main():
-    print(f"Scanning for BLE devices named '{DEVICE_NAME}'...")
-    devices = await BleakScanner.discover(timeout=5.0)
-
-    target = None
-    for d in devices:
-        if d.name and DEVICE_NAME.lower() in d.name.lower():
-            target = d
-            print(f"Found device: {d.name} ({d.address})") #print the device name and MAC address
+    parser = argparse.ArgumentParser(
+        description="Interactive client for the BLE HID device",
+        epilog="With a command, runs just that and exits; start daemon.py to keep the link between runs.")
+    transport.add_arguments(parser)
+    parser.add_argument("command", nargs="*", help="command to run instead of the prompt")
+    args = parser.parse_args()
+
+    started = time.perf_counter()
+    try:
+        async with transport.from_arguments(args, DEVICE_NAME) as client:
+            print(f"Connected to {client.description} in {time.perf_counter() - started:.2f} s.")
+            if args.command:
+                await run_command(client, ClockSync(client), " ".join(args.command))
+            else:
+                await session(client)
+    except (transport.TransportError, OSError) as e:
+        print(f"Connection failed: {e}")
+
+
+async def session(client):
+    print(COMMANDS_HELP)
+    print_status(await client.read_gatt_char(STATUS_CHAR_UUID))
+    await client.start_notify(STATUS_CHAR_UUID, lambda _, data: print_status(data))
+    clock = ClockSync(client)
+    await clock.start()
+
+    while True:
+        # Read input off the event loop so status notifications get through
+        cmd = (await asyncio.to_thread(input, "Enter command: ")).strip()
+        if cmd.lower() in ["exit", "quit"]:
+            print("Exiting.")
             break
+        await run_command(client, clock, cmd)
+
+
+async def run_command(client, clock, cmd):
+    try:
+        if cmd.lower() == "sync":
+            offset, rtt = await clock.sync()
+            print(f"Clock offset {offset} us, round trip {rtt} us")
+            return
+        if cmd.lower() == "boot":
+            print_boot(await client.read_gatt_char(STATS_CHAR_UUID))
+            return
+        if cmd.lower() == "config" or cmd.lower().startswith("config "):
+            await config_command(client, cmd.split()[1:])
+            return
+        if cmd.lower().startswith("script "):
+            await replay_script(client, hid_script.compile_file(cmd[7:].strip()))
+        elif cmd.lower().startswith("macro store "):
+            slot, path = cmd[12:].split(None, 1)
+            await store_macro(client, int(slot), hid_script.compile_file(path.strip()))
+        elif cmd.lower().startswith("typefile "):
+            with open(cmd[9:].strip(), encoding="utf-8") as f:
+                await send_text(client, f.read())
+        elif hid_proto.is_command(cmd):
+            await client.write_gatt_char(WRITE_CHAR_UUID, cmd.encode(), response=False)
+        else:
+            await send_text(client, cmd)
+        print("Command sent.")
+    except Exception as e:
+        print(f"Failed to send command: {e}")
+
+
+def now_us():
+    return time.time_ns() // 1000
 
-    if not target:
-        print("Device not found.")
-        return
 
-    async with BleakClient(target.address) as client:
-        print("Connected to ESP32 BLE device.")
-        print(COMMANDS_HELP)
+class ClockSync:
+    """Client side of the device time sync (see main/hid_sched.h).
 
-        while True:
-            cmd = input("Enter command: ").strip()
-            if cmd.lower() in ["exit", "quit"]:
-                print("Exiting.")
-                break
+    Several round trips are timed and the one with the shortest round trip
+    wins, since it bounds the offset error most tightly.
+    """
 
+    def __init__(self, client, on_exec=None):
+        self.client = client
+        self.on_exec = on_exec or print_exec
+        self.seq = 0
+        self.pending = {}
+        self.subscribed = False
+
+    def on_notify(self, data):
+        msg = hid_proto.parse_clock(data)
+        if msg["type"] == "sync":
+            fut = self.pending.pop(msg["seq"], None)
+            if fut and not fut.done():
+                fut.set_result((msg, now_us()))
+        else:
+            self.on_exec(msg)
+
+    async def start(self):
+        """Subscribes to sync replies and scheduled command reports."""
+        if not self.subscribed:
+            await self.client.start_notify(CLOCK_CHAR_UUID, lambda _, data: self.on_notify(data))
+            self.subscribed = True
+
+    async def sync(self, rounds=8):
+        await self.start()
+        best = None
+        for _ in range(rounds):
+            self.seq = (self.seq + 1) & 0xFF
+            fut = asyncio.get_running_loop().create_future()
+            self.pending[self.seq] = fut
+            await self.client.write_gatt_char(WRITE_CHAR_UUID, hid_proto.time_sync(self.seq, now_us()),
+                                              response=False)
             try:
-                await client.write_gatt_char(WRITE_CHAR_UUID, cmd.encode(), response=False)
-                print("Command sent.")
-            except Exception as e:
-                print(f"Failed to send command: {e}")
+                msg, t4 = await asyncio.wait_for(fut, 1.0)
+            except asyncio.TimeoutError:
+                self.pending.pop(self.seq, None)
+                continue
+            offset, rtt = hid_proto.clock_offset(msg["t1"], msg["t2"], msg["t3"], t4)
+            if best is None or rtt < best[1]:
+                best = (offset, rtt)
+        if best is None:
+            raise RuntimeError("no time sync reply")
+        await self.client.write_gatt_char(WRITE_CHAR_UUID, hid_proto.clock_set(*best), response=False)
+        return best
+
+
+def print_exec(msg):
+    if msg["uncertainty"] == hid_proto.UNSYNCED:
+        print(f"[clock] scheduled command ran {msg['late']} us late (clock not synced)")
+        return
+    if msg["late"] == hid_proto.LATE_MAX:
+        print(f"[clock] scheduled command ran over {msg['late'] // 60000000} minutes late")
+        return
+    ran_ms = (msg["due"] + msg["late"]) / 1000
+    print(f"[clock] scheduled command ran at {ran_ms:.3f} ms, {msg['late']} us late, "
+          f"+/-{msg['uncertainty']} us")
+
+
+def print_boot(data):
+    prev = 0
+    for name, t in hid_proto.parse_stats(data).items():
+        if t is None:
+            print(f"[boot] {name:<11} not reached")
+            continue
+        print(f"[boot] {name:<11} {t / 1000:8.1f} ms  (+{(t - prev) / 1000:.1f} ms)")
+        prev = t
+
+
+async def read_config(client):
+    """(schema by name, values by key); the schema is read page by page."""
+    schema, start = {}, 0
+    while True:
+        await client.write_gatt_char(CONFIG_CHAR_UUID, hid_proto.config_view(hid_proto.CFG_VIEW_SCHEMA, start))
+        _, start, count, entries = hid_proto.parse_config(await client.read_gatt_char(CONFIG_CHAR_UUID))
+        for key, typ, flags, lo, hi, name in entries:
+            schema[name] = (key, typ, flags, lo, hi)
+        start += len(entries)
+        if start >= count or not entries:
+            break
+    await client.write_gatt_char(CONFIG_CHAR_UUID, hid_proto.config_view(hid_proto.CFG_VIEW_VALUES))
+    _, _, _, values = hid_proto.parse_config(await client.read_gatt_char(CONFIG_CHAR_UUID))
+    return schema, dict(values)
+
+
+async def config_command(client, args):
+    if args == ["reset"]:
+        await client.write_gatt_char(CONFIG_CHAR_UUID, hid_proto.config_reset())
+        print("Defaults restored.")
+        return
+    schema, values = await read_config(client)
+    if not args:
+        for name, (key, typ, flags, lo, hi) in schema.items():
+            value = "(secret)" if flags & hid_proto.CFG_F_SECRET else \
+                hid_proto.config_decode(typ, values.get(key, b""))
+            note = "  [next boot]" if flags & hid_proto.CFG_F_REBOOT else ""
+            print(f"[config] {name:<20} {value!s:<12} ({lo}..{hi}){note}")
+        return
+    changes = dict(arg.split("=", 1) for arg in args)
+    await client.write_gatt_char(CONFIG_CHAR_UUID, hid_proto.config_set(schema, changes))
+    print(f"Config updated: {', '.join(changes)}")
+
+
+def print_status(data):
+    st = hid_proto.parse_status(data)
+    locks = [name for name in ("num_lock", "caps_lock", "scroll_lock") if st[name]]
+    print(f"[status] LEDs: {', '.join(locks) or 'none'}, protocol: {st['protocol']}")
+
+
+async def typing_timing(client):
+    """(press, release, gap) ms the device types text with, from its config."""
+    schema, values = await read_config(client)
+    return tuple(hid_proto.config_decode(schema[name][1], values[schema[name][0]])
+                 for name in ("key_press_ms", "key_release_ms", "char_gap_ms"))
+
+
+async def write_text(client, text):
+    """Sends text to be typed; returns (bytes written, compressed).
+
+    Texts of more than REPLAY_WINDOW writes are paced like replay_script by
+    the predicted typing time, so the device's bulk buffer never overflows."""
+    writes, starts, compressed = hid_proto.text_writes(text, max(client.mtu_size - 3, 20))
+    if len(writes) > REPLAY_WINDOW:
+        starts = hid_script.text_starts(text.encode("utf-8"), starts, *await typing_timing(client))
+    t0 = time.perf_counter()
+    for i, w in enumerate(writes):
+        if i >= REPLAY_WINDOW:
+            # Write i - REPLAY_WINDOW is being typed by now
+            await asyncio.sleep(max(0.0, t0 + starts[i - REPLAY_WINDOW] * REPLAY_SLACK / 1000 - time.perf_counter()))
+        await client.write_gatt_char(WRITE_CHAR_UUID, w, response=False)
+    return sum(len(w) for w in writes), compressed
+
+
+async def replay_script(client, steps):
+    """Sends compiled steps as script writes, paced by the predicted run time
+    so only a few writes wait in the device's bulk buffer at any time."""
+    writes = hid_proto.script_writes(steps, max(client.mtu_size - 3, 20))
+    starts = hid_script.chunk_starts(steps, writes)
+    _, duration = hid_script.timeline(steps)
+    print(f"Script: {len(steps)} bytes in {len(writes)} writes, runs {duration / 1000:.2f} s")
+    t0 = time.perf_counter()
+    for i, w in enumerate(writes):
+        if i >= REPLAY_WINDOW:
+            # Write i - REPLAY_WINDOW is running by now
+            await asyncio.sleep(max(0.0, t0 + starts[i - REPLAY_WINDOW] * REPLAY_SLACK / 1000 - time.perf_counter()))
+        await client.write_gatt_char(WRITE_CHAR_UUID, w, response=False)
+
+
+async def store_macro(client, slot, steps):
+    writes = hid_proto.macro_writes(slot, steps, max(client.mtu_size - 3, 20))
+    for w in writes:
+        await client.write_gatt_char(WRITE_CHAR_UUID, w, response=False)
+    print(f"Macro {slot}: {len(steps)} bytes in {len(writes)} writes")
+
+
+async def send_text(client, text):
+    sent, compressed = await write_text(client, text)
+    if compressed:
+        print(f"Compressed {len(text)} -> {sent} bytes ({100 * sent // max(len(text), 1)}%)")
 
 if __name__ == "__main__":
     asyncio.run(main())
\ No newline at end of file
@@ -0,0 +1,186 @@
+"""Types text through the host-simulated firmware and checks what the host got.
+
+Sends the text the way the interactive client does (compressed when it pays
+off), decodes the keyboard reports the firmware hands the host back into
+characters, and compares. Reports characters per second from the first
+write to the last report, and the link retries behind it, so pacing and
+flow control changes can be measured end to end without a device:
+
+    cmake -S host_sim -B host_sim/build && cmake --build host_sim/build
+    python sim_bench.py --firmware ../host_sim/build/hid_sim --interval 15 --loss 0.02 \
+        --config char_gap_ms=0
+
+Exits with status 1 when any round typed something else than was sent.
+Non-ASCII text is decoded for the linux input method only.
+"""
+import argparse
+import asyncio
+import os
+import subprocess
+import time
+
+import hid_proto
+import transport
+from main import read_config, send_text
+
+SAMPLE = ("The quick brown fox jumps over the lazy dog. "
+          "PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS! 0123456789 "
+          "(a+b)*c = {x: [1, 2]} <tag/> \"quoted\" 'single' `tick` ~_|\\^%$#@&?;:\n")
+
+REPORT_KEYBOARD = 3  # HID_RPT_ID_KEYBOARD in main/hid_report_map.h
+REPORT_NKRO = 5      # HID_RPT_ID_NKRO
+
+MOD_CTRL = 0x11
+MOD_SHIFT = 0x22
+KEY_U = 0x18
+KEY_ENTER = 0x28
+
+# US layout, usage -> (plain, shifted); main/hid_keymap.c types the same
+KEYS = {0x04 + i: (c, c.upper()) for i, c in enumerate("abcdefghijklmnopqrstuvwxyz")}
+KEYS.update({0x1E + i: (c, s) for i, (c, s) in enumerate(zip("1234567890", "!@#$%^&*()"))})
+KEYS.update({KEY_ENTER: ("\n", "\n"), 0x2B: ("\t", "\t"), 0x2C: (" ", " "), 0x2D: ("-", "_"),
+             0x2E: ("=", "+"), 0x2F: ("[", "{"), 0x30: ("]", "}"), 0x31: ("\\", "|"), 0x33: (";", ":"),
+             0x34: ("'", '"'), 0x35: ("`", "~"), 0x36: (",", "<"), 0x37: (".", ">"), 0x38: ("/", "?")})
+
+
+class HostKeyboard:
+    """What a host makes of the keyboard reports: characters on key down."""
+
+    def __init__(self):
+        self.text = []
+        self.reports = 0
+        self.last_at = None
+        self._held = set()
+        self._unicode = None  # hex digits of a ctrl+shift+u sequence
+
+    def on_report(self, report_id, data):
+        if report_id == REPORT_KEYBOARD:
+            modifier, keys = data[0], [k for k in data[2:8] if k]
+        elif report_id == REPORT_NKRO:
+            modifier = data[0]
+            keys = [i * 8 + b for i, byte in enumerate(data[1:]) for b in range(8) if byte >> b & 1]
+        else:
+            return
+        self.reports += 1
+        self.last_at = time.perf_counter()
+        for key in keys:
+            if key not in self._held:
+                self._key_down(modifier, key)
+        self._held = set(keys)
+
+    def _key_down(self, modifier, key):
+        if modifier & MOD_CTRL and modifier & MOD_SHIFT and key == KEY_U:
+            self._unicode = ""
+            return
+        chars = KEYS.get(key)
+        if chars is None:
+            return
+        ch = chars[1 if modifier & MOD_SHIFT else 0]
+        if self._unicode is None:
+            self.text.append(ch)
+        elif key == KEY_ENTER:
+            self.text.append(chr(int(self._unicode or "0", 16)))
+            self._unicode = None
+        else:
+            self._unicode += ch
+
+
+def expected(text):
+    """The characters the device types for text: \\r becomes Enter, other
+    control characters without a key are skipped."""
+    text = text.replace("\r\n", "\n").replace("\r", "\n")
+    return "".join(ch for ch in text if ch in "\n\t" or ord(ch) >= 0x20 and ch != "\x7f")
+
+
+async def run_round(args, text):
+    host = HostKeyboard()
+    want = expected(text)
+    async with transport.from_arguments(args, None, host.on_report) as client:
+        if args.config:
+            schema, _ = await read_config(client)
+            changes = dict(kv.split("=", 1) for kv in args.config)
+            await client.write_gatt_char(hid_proto.CONFIG_CHAR_UUID, hid_proto.config_set(schema, changes))
+        if args.kbdmode:
+            await client.write_gatt_char(hid_proto.WRITE_CHAR_UUID, f"kbdmode {args.kbdmode}".encode(),
+                                         response=False)
+        start = time.perf_counter()
+        await send_text(client, text)
+        sent_at = time.perf_counter()
+        # Done once everything arrived or the reports stop coming
+        while len(host.text) < len(want):
+            idle_from = host.last_at or sent_at
+            if time.perf_counter() - idle_from > args.idle:
+                break
+            await asyncio.sleep(0.05)
+        await asyncio.sleep(0.2)  # the final release
+        stats = client.stats
+    got = "".join(host.text)
+    elapsed = (host.last_at or start) - start
+    mismatch = next((i for i, (a, b) in enumerate(zip(got, want)) if a != b), None)
+    if mismatch is None and len(got) != len(want):
+        mismatch = min(len(got), len(want))
+    return {
+        "chars": len(want), "typed": len(got), "reports": host.reports, "elapsed": elapsed,
+        "retries": stats["retries"], "events": stats["events"], "mismatch": mismatch, "got": got, "want": want,
+    }
+
+
+def start_firmware(path, sock):
+    proc = subprocess.Popen([path, sock], stderr=subprocess.DEVNULL)
+    deadline = time.monotonic() + 5
+    while not os.path.exists(sock):
+        if time.monotonic() > deadline or proc.poll() is not None:
+            proc.kill()
+            raise RuntimeError(f"{path} did not come up")
+        time.sleep(0.05)
+    return proc
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    transport.add_arguments(parser)
+    parser.add_argument("--firmware", help="hid_sim binary to start for the run")
+    parser.add_argument("--file", help="text to type (default: a symbol-heavy sample)")
+    parser.add_argument("--repeat", type=int, default=1, help="copies of the sample text")
+    parser.add_argument("--rounds", type=int, default=1)
+    parser.add_argument("--config", nargs="+", metavar="KEY=VALUE",
+                        help="settings to write first, e.g. char_gap_ms=0 key_press_ms=5")
+    parser.add_argument("--kbdmode", choices=("6kro", "nkro"))
+    parser.add_argument("--idle", type=float, default=3.0, help="seconds without reports that end a round")
+    args = parser.parse_args()
+    args.sim = args.sim or transport.SIM_SOCKET
+
+    if args.file:
+        with open(args.file, encoding="utf-8") as f:
+            text = f.read()
+    else:
+        text = SAMPLE * args.repeat
+
+    proc = None
+    if args.firmware:
+        if os.path.exists(args.sim):
+            os.unlink(args.sim)
+        proc = start_firmware(args.firmware, args.sim)
+    failed = False
+    try:
+        for i in range(args.rounds):
+            r = await run_round(args, text)
+            rate = r["typed"] / r["elapsed"] if r["elapsed"] > 0 else 0.0
+            status = "ok" if r["mismatch"] is None else f"MISMATCH at {r['mismatch']}"
+            print(f"round {i + 1}: {r['typed']}/{r['chars']} chars, {r['reports']} reports, "
+                  f"{r['elapsed']:.2f} s, {rate:.0f} chars/s, {r['retries']} retries in {r['events']} events, "
+                  f"{status}")
+            if r["mismatch"] is not None:
+                failed = True
+                at = r["mismatch"]
+                print(f"  want {r['want'][at:at + 30]!r}")
+                print(f"  got  {r['got'][at:at + 30]!r}")
+    finally:
+        if proc:
+            proc.terminate()
+            proc.wait()
+    raise SystemExit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,470 @@
+"""Links between the client and the device.
+
+BleakTransport drives real hardware over BLE. SimTransport connects to the
+firmware built as a Linux process (host_sim/), over a Unix socket carrying
+one GATT operation per packet (host_sim/sim_link.h). It can hold packets for
+emulated connection events and lose some to link-layer retries, so pacing
+and flow control meet a link shaped like the air one. DaemonTransport
+borrows the connection daemon.py holds open, with the same packets over a
+loopback stream.
+
+All offer the BleakClient calls the client relies on: write_gatt_char,
+read_gatt_char, start_notify and mtu_size, and work as async context
+managers.
+"""
+import asyncio
+import collections
+import json
+import os
+import random
+import socket
+import struct
+import time
+
+import hid_proto
+
+# host_sim/sim_link.h
+MSG_WRITE = 0x01
+MSG_WRITE_CMD = 0x02
+MSG_READ = 0x03
+MSG_SUBSCRIBE = 0x04
+MSG_MTU = 0x05
+MSG_HOST_OUTPUT = 0x10
+MSG_HOST_PROTOCOL = 0x11
+MSG_WRITE_RSP = 0x81
+MSG_READ_RSP = 0x83
+MSG_NOTIFY = 0x84
+MSG_MTU_RSP = 0x85
+MSG_REPORT = 0x90
+MSG_HELLO = 0x20  # daemon only: the token from daemon.json, first on a stream
+
+SIM_CHARS = {
+    hid_proto.WRITE_CHAR_UUID: 1,
+    hid_proto.STATUS_CHAR_UUID: 2,
+    hid_proto.CLOCK_CHAR_UUID: 3,
+    hid_proto.STATS_CHAR_UUID: 4,
+    hid_proto.CONFIG_CHAR_UUID: 5,
+}
+SIM_UUIDS = {chr_id: uuid for uuid, chr_id in SIM_CHARS.items()}
+SIM_SOCKET = "/tmp/hid_sim.sock"
+PACKET_MAX = 512
+ATT_ERR_UNLIKELY = 0x0E
+
+
+class TransportError(Exception):
+    """A refused GATT operation; att_error carries the ATT error code."""
+
+    def __init__(self, message, att_error=None):
+        super().__init__(message)
+        self.att_error = att_error
+
+
+def cache_dir():
+    base = os.environ.get("XDG_CACHE_HOME") or os.environ.get("LOCALAPPDATA") or \
+        os.path.join(os.path.expanduser("~"), ".cache")
+    return os.path.join(base, "blehid")
+
+
+def write_private(path, data):
+    """Writes a JSON file only the current user can read, replacing it whole."""
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    tmp = path + ".tmp"
+    fd = os.open(tmp, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o600)
+    with os.fdopen(fd, "w") as f:
+        json.dump(data, f)
+    os.replace(tmp, path)
+
+
+def read_json(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {}
+
+
+class DeviceCache:
+    """The last device connected to: its address and characteristic handles."""
+
+    def __init__(self, path=None):
+        self.path = path or os.path.join(cache_dir(), "device.json")
+
+    def load(self, name):
+        entry = read_json(self.path)
+        return entry if entry.get("name") == name else {}
+
+    def save(self, name, address, handles):
+        write_private(self.path, {"name": name, "address": address, "handles": handles})
+
+    def forget(self):
+        try:
+            os.remove(self.path)
+        except OSError:
+            pass
+
+
+class BleakTransport:
+    """A BLE device.
+
+    Connects straight to the given address, or the one that worked last
+    time, and scans only when that fails. The scan ends at the first
+    advertisement carrying the custom service UUID, or the name for scan
+    responses without room for the UUID. Service discovery is limited to
+    the custom service, and with the handles cached, the system's copy of
+    the GATT table is used where the backend keeps one (WinRT); the handles
+    found are checked against the cached ones so a reflashed device is
+    discovered afresh.
+    """
+
+    def __init__(self, address=None, name=None, scan_timeout=5.0, connect_timeout=4.0, cache=None):
+        self.address = address
+        self.name = name
+        self.scan_timeout = scan_timeout
+        self.connect_timeout = connect_timeout
+        self.cache = cache or DeviceCache()
+        self.description = "ESP32 BLE device"
+        self.disconnected = None
+        self._client = None
+        self._chars = {}
+
+    async def __aenter__(self):
+        from bleak import BleakScanner
+        from bleak.exc import BleakError
+
+        self.disconnected = asyncio.Event()
+        cached = self.cache.load(self.name)
+        target = self.address or cached.get("address")
+        if target:
+            try:
+                await self._connect(target, None if self.address else cached.get("handles"))
+                return self
+            except (BleakError, asyncio.TimeoutError, OSError) as e:
+                if self.address:
+                    raise TransportError(f"cannot connect to {target}: {e}") from e
+                print(f"Last device {target} did not answer ({e or type(e).__name__}), scanning...")
+        print(f"Scanning for '{self.name}'...")
+        device = await BleakScanner.find_device_by_filter(self._matches, timeout=self.scan_timeout)
+        if device is None:
+            raise TransportError(f"no device named '{self.name}' found")
+        print(f"Found device: {device.name or self.name} ({device.address})")
+        await self._connect(device, None)
+        return self
+
+    async def __aexit__(self, *exc):
+        await self._client.disconnect()
+
+    def _matches(self, device, adv):
+        if hid_proto.SERVICE_UUID in adv.service_uuids:
+            return True
+        name = adv.local_name or device.name
+        return bool(self.name and name and self.name.lower() in name.lower())
+
+    async def _connect(self, target, handles):
+        from bleak import BleakClient
+
+        client = BleakClient(target, lambda _: self.disconnected.set(), services=[hid_proto.SERVICE_UUID],
+                             timeout=self.connect_timeout, winrt={"use_cached_services": bool(handles)})
+        await client.connect()
+        chars = {uuid: client.services.get_characteristic(uuid) for uuid in hid_proto.CHAR_UUIDS}
+        found = {uuid: c.handle for uuid, c in chars.items() if c is not None}
+        if handles and found != handles:
+            print("Device GATT table changed, discovering again")
+            await client.disconnect()
+            self.cache.forget()
+            await self._connect(target, None)
+            return
+        self._client = client
+        self._chars = {uuid: c for uuid, c in chars.items() if c is not None}
+        self.description = f"ESP32 BLE device {client.address}"
+        self.cache.save(self.name, client.address, found)
+
+    @property
+    def mtu_size(self):
+        return self._client.mtu_size
+
+    async def write_gatt_char(self, uuid, data, response=True):
+        await self._client.write_gatt_char(self._chars.get(uuid, uuid), data, response=response)
+
+    async def read_gatt_char(self, uuid):
+        return await self._client.read_gatt_char(self._chars.get(uuid, uuid))
+
+    async def start_notify(self, uuid, callback):
+        await self._client.start_notify(self._chars.get(uuid, uuid), callback)
+
+
+class LinkModel:
+    """Connection events every interval_ms, each carrying up to per_event
+    packets per direction. A lost packet is sent again at the next event,
+    as the link layer would, holding back the ones behind it. tx_window is
+    how many writes without response may wait for the link before a writer
+    blocks, like the controller's buffers. interval_ms 0 passes packets on
+    at once."""
+
+    def __init__(self, interval_ms=0.0, loss=0.0, per_event=4, tx_window=8, seed=None):
+        self.interval = interval_ms / 1000.0
+        self.loss = loss
+        self.per_event = per_event
+        self.tx_window = tx_window
+        self.random = random.Random(seed)
+
+    def lost(self):
+        return self.loss > 0 and self.random.random() < self.loss
+
+
+class SimTransport:
+    """The host-simulated firmware on a Unix socket.
+
+    on_report(report_id, data) receives the input reports the firmware sends
+    the host; host_output() and host_protocol() play the host's side.
+    """
+
+    def __init__(self, path=SIM_SOCKET, link=None, mtu=247, on_report=None):
+        self.path = path
+        self.link = link or LinkModel()
+        self.requested_mtu = mtu
+        self.on_report = on_report
+        self.description = "host-simulated firmware"
+        self.disconnected = None
+        self.mtu_size = 23
+        self.stats = {"sent": 0, "received": 0, "retries": 0, "events": 0}
+        self._sock = None
+        self._tasks = []
+        self._tx = collections.deque()
+        self._rx = collections.deque()
+        self._tx_room = asyncio.Event()
+        self._notify = {}
+        self._pending = None  # (response type, future) of the ATT request in flight
+        self._att_lock = asyncio.Lock()
+
+    async def __aenter__(self):
+        self.disconnected = asyncio.Event()
+        await self._open()
+        try:
+            self._tasks.append(asyncio.create_task(self._reader()))
+            if self.link.interval > 0:
+                self._tasks.append(asyncio.create_task(self._events()))
+            rsp = await self._request(MSG_MTU, 0, struct.pack("<H", self.requested_mtu), MSG_MTU_RSP)
+        except BaseException:
+            await self.__aexit__()
+            raise
+        self.mtu_size = struct.unpack("<H", rsp)[0]
+        return self
+
+    async def __aexit__(self, *exc):
+        for task in self._tasks:
+            task.cancel()
+        self._close()
+
+    # ── Packets ──
+    async def _open(self):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+        self._sock.setblocking(False)
+        try:
+            await asyncio.get_running_loop().sock_connect(self._sock, self.path)
+        except OSError:
+            self._sock.close()
+            raise
+
+    def _close(self):
+        self._sock.close()
+
+    async def _write(self, pkt):
+        await asyncio.get_running_loop().sock_sendall(self._sock, pkt)
+
+    async def _read(self):
+        return await asyncio.get_running_loop().sock_recv(self._sock, PACKET_MAX)
+
+    # ── GATT ──
+    async def write_gatt_char(self, uuid, data, response=True):
+        data = bytes(data)
+        if len(data) > self.mtu_size - 3:
+            raise TransportError(f"write of {len(data)} bytes exceeds MTU {self.mtu_size}")
+        if response:
+            rsp = await self._request(MSG_WRITE, SIM_CHARS[uuid], data, MSG_WRITE_RSP)
+            if rsp[0]:
+                raise TransportError(f"write refused, ATT error 0x{rsp[0]:02x}", rsp[0])
+            return
+        await self._send(MSG_WRITE_CMD, SIM_CHARS[uuid], data)
+
+    async def read_gatt_char(self, uuid):
+        rsp = await self._request(MSG_READ, SIM_CHARS[uuid], b"", MSG_READ_RSP)
+        if rsp[0]:
+            raise TransportError(f"read refused, ATT error 0x{rsp[0]:02x}", rsp[0])
+        return bytearray(rsp[1:])
+
+    async def start_notify(self, uuid, callback):
+        chr_id = SIM_CHARS[uuid]
+        self._notify[chr_id] = lambda data: callback(uuid, bytearray(data))
+        await self._send(MSG_SUBSCRIBE, chr_id, b"\x01")
+
+    # ── Host side ──
+    async def host_output(self, leds):
+        await self._send(MSG_HOST_OUTPUT, 0, bytes((leds,)))
+
+    async def host_protocol(self, mode):
+        await self._send(MSG_HOST_PROTOCOL, 0, bytes((mode,)))
+
+    # ── Link ──
+    async def _request(self, msg, chr_id, data, rsp_type):
+        """One ATT request at a time, as ATT allows."""
+        async with self._att_lock:
+            fut = asyncio.get_running_loop().create_future()
+            self._pending = (rsp_type, fut)
+            await self._send(msg, chr_id, data)
+            try:
+                return await asyncio.wait_for(fut, 5.0)
+            finally:
+                self._pending = None
+
+    async def _send(self, msg, chr_id, data):
+        pkt = bytes((msg, chr_id)) + data
+        if self.link.interval <= 0:
+            await self._write(pkt)
+            self.stats["sent"] += 1
+            return
+        while len(self._tx) >= self.link.tx_window:
+            self._tx_room.clear()
+            await self._tx_room.wait()
+        self._tx.append(pkt)
+
+    async def _reader(self):
+        while True:
+            pkt = await self._read()
+            if not pkt:
+                if self._pending and not self._pending[1].done():
+                    self._pending[1].set_exception(TransportError("firmware closed the link"))
+                self.disconnected.set()
+                return
+            if self.link.interval > 0:
+                self._rx.append(pkt)
+            else:
+                self._dispatch(pkt)
+
+    def _dispatch(self, pkt):
+        self.stats["received"] += 1
+        msg, ident, data = pkt[0], pkt[1], pkt[2:]
+        if msg == MSG_NOTIFY:
+            cb = self._notify.get(ident)
+            if cb:
+                cb(data)
+        elif msg == MSG_REPORT:
+            if self.on_report:
+                self.on_report(ident, data)
+        elif self._pending and self._pending[0] == msg and not self._pending[1].done():
+            self._pending[1].set_result(data)
+
+    async def _events(self):
+        """Moves packets only at connection events, on a fixed schedule."""
+        next_event = time.monotonic()
+        while True:
+            next_event += self.link.interval
+            await asyncio.sleep(max(0.0, next_event - time.monotonic()))
+            self.stats["events"] += 1
+            for _ in range(self.link.per_event):
+                if not self._tx:
+                    break
+                if self.link.lost():
+                    self.stats["retries"] += 1
+                    break
+                await self._write(self._tx.popleft())
+                self.stats["sent"] += 1
+            self._tx_room.set()
+            for _ in range(self.link.per_event):
+                if not self._rx:
+                    break
+                if self.link.lost():
+                    self.stats["retries"] += 1
+                    break
+                self._dispatch(self._rx.popleft())
+
+
+def daemon_file():
+    return os.path.join(cache_dir(), "daemon.json")
+
+
+async def read_frame(reader):
+    """One packet off a daemon stream, b"" at its end."""
+    try:
+        size = struct.unpack("<H", await reader.readexactly(2))[0]
+        return await reader.readexactly(size)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        return b""
+
+
+def write_frame(writer, pkt):
+    writer.write(struct.pack("<H", len(pkt)) + pkt)
+
+
+class DaemonTransport(SimTransport):
+    """The device connection held by daemon.py, found through daemon.json.
+    Raises OSError when no daemon runs, so callers can fall back to BLE."""
+
+    def __init__(self, on_report=None):
+        super().__init__(on_report=on_report)
+        self.description = "ESP32 BLE device through the daemon"
+        self._in = None
+        self._out = None
+
+    async def _open(self):
+        info = read_json(daemon_file())
+        if "port" not in info:
+            raise ConnectionRefusedError("no daemon running")
+        self._in, self._out = await asyncio.open_connection("127.0.0.1", info["port"])
+        write_frame(self._out, bytes((MSG_HELLO, 0)) + info["token"].encode())
+
+    def _close(self):
+        self._out.close()
+
+    async def _write(self, pkt):
+        write_frame(self._out, pkt)
+        await self._out.drain()
+
+    async def _read(self):
+        return await read_frame(self._in)
+
+
+class FirstAvailable:
+    """Enters the first transport that connects, trying them in order."""
+
+    def __init__(self, *transports):
+        self.transports = transports
+        self.active = None
+
+    async def __aenter__(self):
+        for t in self.transports[:-1]:
+            try:
+                self.active = await t.__aenter__()
+                return self.active
+            except (OSError, TransportError, asyncio.TimeoutError):
+                continue
+        self.active = await self.transports[-1].__aenter__()
+        return self.active
+
+    async def __aexit__(self, *exc):
+        return await self.active.__aexit__(*exc)
+
+
+def add_arguments(parser):
+    """Command line options that select and shape the transport."""
+    parser.add_argument("--sim", nargs="?", const=SIM_SOCKET, metavar="SOCKET",
+                        help="use the host-simulated firmware instead of BLE")
+    parser.add_argument("--address", help="BLE address to connect to without scanning")
+    parser.add_argument("--interval", type=float, default=0.0, metavar="MS",
+                        help="simulated connection interval (--sim)")
+    parser.add_argument("--loss", type=float, default=0.0,
+                        help="simulated share of packets retried at the next event (--sim)")
+    parser.add_argument("--mtu", type=int, default=247, help="ATT MTU to request (--sim)")
+    parser.add_argument("--no-daemon", action="store_true",
+                        help="connect directly even when daemon.py holds the device")
+
+
+def from_arguments(args, name, on_report=None):
+    """The simulator with --sim; otherwise the running daemon, if any, then
+    BLE. An explicit --address always means a direct connection."""
+    if args.sim:
+        link = LinkModel(args.interval, args.loss)
+        return SimTransport(args.sim, link, args.mtu, on_report)
+    ble = BleakTransport(args.address, name)
+    if args.address or getattr(args, "no_daemon", False):
+        return ble
+    return FirstAvailable(DaemonTransport(on_report), ble)
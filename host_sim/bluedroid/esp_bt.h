@@ -0,0 +1,10 @@
+/*  esp_bt for the host build: only the standard headers it brings along,
+ *  which esp_hid_gap.h relies on
+ */
+#ifndef _SIM_ESP_BT_H_
+#define _SIM_ESP_BT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif /* _SIM_ESP_BT_H_ */
@@ -0,0 +1,39 @@
+/*  esp_bt_defs for the host build: the address and UUID types of a scan
+ *  result, laid out as in Bluedroid
+ */
+#ifndef _SIM_ESP_BT_DEFS_H_
+#define _SIM_ESP_BT_DEFS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+typedef struct
+{
+    uint16_t len;
+    union
+    {
+        uint16_t uuid16;
+        uint32_t uuid32;
+        uint8_t uuid128[16];
+    } uuid;
+} __attribute__((packed)) esp_bt_uuid_t;
+
+typedef enum
+{
+    BLE_ADDR_TYPE_PUBLIC = 0x00,
+    BLE_ADDR_TYPE_RANDOM = 0x01,
+    BLE_ADDR_TYPE_RPA_PUBLIC = 0x02,
+    BLE_ADDR_TYPE_RPA_RANDOM = 0x03,
+} esp_ble_addr_type_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_ESP_BT_DEFS_H_ */
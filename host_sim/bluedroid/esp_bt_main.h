@@ -0,0 +1,6 @@
+/*  esp_bt_main for the host build: nothing of it is used by the scan store
+ */
+#ifndef _SIM_ESP_BT_MAIN_H_
+#define _SIM_ESP_BT_MAIN_H_
+
+#endif /* _SIM_ESP_BT_MAIN_H_ */
@@ -0,0 +1,25 @@
+/*  esp_gap_bt_api for the host build: the class of device of a scan result
+ */
+#ifndef _SIM_ESP_GAP_BT_API_H_
+#define _SIM_ESP_GAP_BT_API_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint32_t reserved_2 : 2;
+    uint32_t minor : 6;
+    uint32_t major : 5;
+    uint32_t service : 11;
+    uint32_t reserved_8 : 8;
+} esp_bt_cod_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_ESP_GAP_BT_API_H_ */
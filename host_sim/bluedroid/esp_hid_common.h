@@ -0,0 +1,34 @@
+/*  esp_hid_common for the host build: the usage and transport of a scan result
+ */
+#ifndef _SIM_ESP_HID_COMMON_H_
+#define _SIM_ESP_HID_COMMON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    ESP_HID_USAGE_GENERIC = 0,
+    ESP_HID_USAGE_KEYBOARD = 1,
+    ESP_HID_USAGE_MOUSE = 2,
+    ESP_HID_USAGE_JOYSTICK = 4,
+    ESP_HID_USAGE_GAMEPAD = 8,
+    ESP_HID_USAGE_TABLET = 16,
+    ESP_HID_USAGE_CCONTROL = 32,
+    ESP_HID_USAGE_VENDOR = 64,
+} esp_hid_usage_t;
+
+typedef enum
+{
+    ESP_HID_TRANSPORT_BT,
+    ESP_HID_TRANSPORT_BLE,
+    ESP_HID_TRANSPORT_USB,
+    ESP_HID_TRANSPORT_MAX
+} esp_hid_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_ESP_HID_COMMON_H_ */
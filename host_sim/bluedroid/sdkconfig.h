@@ -0,0 +1,6 @@
+/*  Configuration of the Bluedroid build for scan_flood: the scan store only
+ *  exists without NimBLE
+ */
+#pragma once
+#define CONFIG_BT_ENABLED 1
+#define CONFIG_BT_BLUEDROID_ENABLED 1
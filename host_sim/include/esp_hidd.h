@@ -0,0 +1,34 @@
+/*  esp_hidd for the host build
+ *
+ *  Input reports go to the connected client as the host would receive
+ *  them (sim_link.h) instead of out over HID over GATT.
+ */
+#ifndef _SIM_ESP_HIDD_H_
+#define _SIM_ESP_HIDD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    ESP_HID_PROTOCOL_MODE_BOOT = 0x00,
+    ESP_HID_PROTOCOL_MODE_REPORT = 0x01,
+} esp_hid_protocol_mode_t;
+
+typedef struct esp_hidd_dev_s esp_hidd_dev_t;
+
+/* ESP_FAIL while no client is connected */
+esp_err_t esp_hidd_dev_input_set(esp_hidd_dev_t *dev, size_t map_index, size_t report_id, uint8_t *data,
+                                 size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_ESP_HIDD_H_ */
@@ -0,0 +1,48 @@
+/*  FreeRTOS for the host build
+ *
+ *  The subset of the FreeRTOS API the HID pipeline uses, on POSIX threads
+ *  (sim_rtos.c). Ticks follow CONFIG_FREERTOS_HZ, so waits round the way
+ *  they do on the device. Static creation takes the caller's storage for
+ *  the data; the control block is allocated, the Static*_t types only keep
+ *  the signatures.
+ */
+#ifndef _SIM_FREERTOS_H_
+#define _SIM_FREERTOS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS 2
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+typedef struct
+{
+    void *unused;
+} StaticTask_t, StaticQueue_t, StaticSemaphore_t, StaticStreamBuffer_t, StaticMessageBuffer_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_FREERTOS_H_ */
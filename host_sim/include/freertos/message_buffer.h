@@ -0,0 +1,23 @@
+#ifndef _SIM_MESSAGE_BUFFER_H_
+#define _SIM_MESSAGE_BUFFER_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A stream buffer whose writes carry a size_t length header */
+typedef StreamBufferHandle_t MessageBufferHandle_t;
+
+MessageBufferHandle_t xMessageBufferCreateStatic(size_t size, uint8_t *storage, StaticMessageBuffer_t *ctl);
+size_t xMessageBufferSend(MessageBufferHandle_t mb, const void *data, size_t len, TickType_t wait);
+size_t xMessageBufferReceive(MessageBufferHandle_t mb, void *buf, size_t len, TickType_t wait);
+size_t xMessageBufferSpacesAvailable(MessageBufferHandle_t mb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_MESSAGE_BUFFER_H_ */
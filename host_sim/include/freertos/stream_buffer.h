@@ -0,0 +1,24 @@
+#ifndef _SIM_STREAM_BUFFER_H_
+#define _SIM_STREAM_BUFFER_H_
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sim_stream *StreamBufferHandle_t;
+
+/* storage holds size + 1 bytes, as on FreeRTOS */
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size, size_t trigger, uint8_t *storage,
+                                               StaticStreamBuffer_t *ctl);
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t wait);
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *buf, size_t len, TickType_t wait);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t sb);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_STREAM_BUFFER_H_ */
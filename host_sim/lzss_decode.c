@@ -0,0 +1,85 @@
+/*  LZSS decode driver for PythonClient/lzss_bench.py
+ *
+ *  Runs main/hid_lzss.c the way the typing engine in hid_output.c does: one
+ *  character pulled at a time, input fed only when the decoder runs dry.
+ *  Reads a compressed stream on stdin, writes the decoded text to stdout and
+ *  "<bytes out> <ns>" to stderr, the fastest of the rounds.
+ *
+ *      lzss_decode [rounds] < text.lzss > text
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hid_lzss.h"
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Decodes in[0..len) into out, returns the bytes written */
+static size_t decode(hid_lzss_t *d, const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t pos = 0, n = 0;
+
+    hid_lzss_reset(d);
+    while (1)
+    {
+        if (hid_lzss_poll(d, &out[n]))
+        {
+            n++;
+            continue;
+        }
+        if (pos == len)
+        {
+            return n;
+        }
+        hid_lzss_feed(d, in[pos++]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 1;
+    size_t len = 0, cap = 4096;
+    uint8_t *in = malloc(cap);
+    size_t got;
+
+    while (in && (got = fread(in + len, 1, cap - len, stdin)) > 0)
+    {
+        len += got;
+        if (len == cap)
+        {
+            cap *= 2;
+            in = realloc(in, cap);
+        }
+    }
+    // A back-reference yields at most 16 bytes from 13 bits
+    uint8_t *out = malloc(len * 10 + 16);
+    if (!in || !out)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    hid_lzss_t d;
+    size_t n = 0;
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < (rounds > 0 ? rounds : 1); r++)
+    {
+        uint64_t start = now_ns();
+        n = decode(&d, in, len, out);
+        uint64_t ns = now_ns() - start;
+        best = ns < best ? ns : best;
+    }
+
+    fwrite(out, 1, n, stdout);
+    fprintf(stderr, "%zu %" PRIu64 "\n", n, best);
+    free(in);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*  Report map check
+ *
+ *  Walks the items of HID_REPORT_MAP the way a host's HID parser does,
+ *  sums Report Size x Report Count of every Input and Output item per
+ *  report ID, and compares the lengths with the packed structs the output
+ *  pipeline sends. Unlike the HID_CHECK_* asserts this reads the emitted
+ *  bytes, so a wrong item in a collection macro or a missing field list
+ *  expansion is caught as well. Exits with status 1 on any mismatch.
+ *
+ *      report_map_check
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hid_report_map.h"
+
+#define ITEM_TYPE_MAIN 0
+#define ITEM_TYPE_GLOBAL 1
+
+#define TAG_INPUT 0x8
+#define TAG_OUTPUT 0x9
+#define TAG_REPORT_SIZE 0x7
+#define TAG_REPORT_ID 0x8
+#define TAG_REPORT_COUNT 0x9
+
+typedef struct
+{
+    uint8_t id;
+    const char *name;
+    uint32_t in_bytes;
+    uint32_t out_bytes;
+} expected_t;
+
+static const uint8_t s_map[] = {HID_REPORT_MAP};
+
+static const expected_t s_expected[] = {
+    {HID_RPT_ID_CONSUMER, "consumer", sizeof(hid_consumer_report_t), 0},
+    {HID_RPT_ID_MOUSE, "mouse", sizeof(hid_mouse_report_t), 0},
+    {HID_RPT_ID_KEYBOARD, "keyboard", sizeof(hid_keyboard_report_t), sizeof(hid_keyboard_leds_t)},
+#if CONFIG_EXAMPLE_ABS_POINTER_ENABLE
+    {HID_RPT_ID_ABS_POINTER, "abs pointer", sizeof(hid_abs_pointer_report_t), 0},
+#endif
+#if CONFIG_EXAMPLE_NKRO_ENABLE
+    {HID_RPT_ID_NKRO, "nkro", sizeof(hid_nkro_report_t), 0},
+#endif
+    {HID_RPT_ID_CONSUMER_BITS, "consumer bits", sizeof(hid_consumer_bits_report_t), 0},
+};
+
+#define EXPECTED_COUNT (sizeof(s_expected) / sizeof(s_expected[0]))
+
+int main(void)
+{
+    uint32_t in_bits[256] = {0}, out_bits[256] = {0};
+    bool seen[256] = {false};
+    uint32_t size = 0, count = 0;
+    uint8_t id = 0;
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(s_map);)
+    {
+        uint8_t prefix = s_map[i];
+        size_t len = (prefix & 3) == 3 ? 4 : (prefix & 3);
+        uint32_t value = 0;
+
+        if (i + 1 + len > sizeof(s_map))
+        {
+            printf("item at %zu runs past the end of the map\n", i);
+            return 1;
+        }
+        for (size_t b = 0; b < len; b++)
+        {
+            value |= (uint32_t)s_map[i + 1 + b] << (8 * b);
+        }
+
+        uint8_t type = (prefix >> 2) & 3, tag = prefix >> 4;
+        if (type == ITEM_TYPE_GLOBAL && tag == TAG_REPORT_SIZE)
+        {
+            size = value;
+        }
+        else if (type == ITEM_TYPE_GLOBAL && tag == TAG_REPORT_COUNT)
+        {
+            count = value;
+        }
+        else if (type == ITEM_TYPE_GLOBAL && tag == TAG_REPORT_ID)
+        {
+            id = (uint8_t)value;
+            seen[id] = true;
+        }
+        else if (type == ITEM_TYPE_MAIN && tag == TAG_INPUT)
+        {
+            in_bits[id] += size * count;
+        }
+        else if (type == ITEM_TYPE_MAIN && tag == TAG_OUTPUT)
+        {
+            out_bits[id] += size * count;
+        }
+        i += 1 + len;
+    }
+
+    for (size_t e = 0; e < EXPECTED_COUNT; e++)
+    {
+        const expected_t *x = &s_expected[e];
+        bool match = seen[x->id] && in_bits[x->id] == 8 * x->in_bytes && out_bits[x->id] == 8 * x->out_bytes;
+
+        printf("%-14s id %u: map in %" PRIu32 " out %" PRIu32 " bits, struct in %" PRIu32 " out %" PRIu32
+               " bytes%s\n",
+               x->name, x->id, in_bits[x->id], out_bits[x->id], x->in_bytes, x->out_bytes,
+               match ? "" : "  MISMATCH");
+        ok &= match;
+        seen[x->id] = false;
+    }
+    for (int r = 0; r < 256; r++)
+    {
+        if (seen[r])
+        {
+            printf("report id %d is in the map but has no struct\n", r);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*  Advertising flood through the scan result store
+ *
+ *  Feeds main/hid_scan_store.c synthetic discovery reports the way
+ *  esp_hid_gap.c does (find, else add, plus a name), from crowds of 16 up
+ *  to 3000 advertisers on both transports, and prints the cost per report.
+ *  Every 1000 reports it checks that each result is still found at its pool
+ *  entry and that the result chain holds every entry in arrival order.
+ *  Exits with status 1 when a check fails.
+ *
+ *      scan_flood [reports per crowd]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hid_scan_store.h"
+
+#define CHECK_EVERY 1000
+
+static const char *const NAMES[] = {"Keyboard", "Mouse", "Azmuth", "LE-Headset", "Tag"};
+
+static uint32_t s_rand = 1;
+
+static uint32_t next_rand(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static void device_addr(uint32_t dev, esp_bd_addr_t bda)
+{
+    memset(bda, 0, sizeof(esp_bd_addr_t));
+    bda[0] = dev & 0xFF;
+    bda[1] = dev >> 8;
+    bda[5] = 0xC0;
+}
+
+/* Every entry findable, chain complete and ordered by arrival[] */
+static bool check(const uint32_t *arrival)
+{
+    size_t n = 0;
+    uint32_t last = 0;
+
+    for (esp_hid_scan_result_t *r = hid_scan_store_results(); r; r = r->next, n++)
+    {
+        uint32_t dev = r->bda[0] | (r->bda[1] << 8);
+        if (hid_scan_store_find(r->bda, r->transport) != r)
+        {
+            printf("device %u is not found at its entry\n", (unsigned)dev);
+            return false;
+        }
+        if (arrival[dev] <= last)
+        {
+            printf("device %u is out of arrival order\n", (unsigned)dev);
+            return false;
+        }
+        last = arrival[dev];
+    }
+    if (n != hid_scan_store_count())
+    {
+        printf("chain has %zu results, store %zu\n", n, hid_scan_store_count());
+        return false;
+    }
+    return true;
+}
+
+static bool flood(uint32_t devices, long reports)
+{
+    uint32_t *arrival = calloc(devices, sizeof(*arrival));
+    uint32_t arrivals = 0;
+    struct timespec t0, t1;
+    double ns = 0;
+
+    if (!arrival)
+    {
+        return false;
+    }
+    hid_scan_store_reset();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long k = 0; k < reports; k++)
+    {
+        uint32_t dev = next_rand() % devices;
+        esp_hid_transport_t transport = dev & 1 ? ESP_HID_TRANSPORT_BT : ESP_HID_TRANSPORT_BLE;
+        const char *name = NAMES[dev % 5];
+        int rssi = -40 - (int)(next_rand() % 50);
+        esp_bd_addr_t bda;
+        device_addr(dev, bda);
+
+        esp_hid_scan_result_t *r = hid_scan_store_find(bda, transport);
+        if (r)
+        {
+            hid_scan_store_heard(r, rssi);
+        }
+        else
+        {
+            r = hid_scan_store_add(bda, transport, rssi);
+            r->name = hid_scan_store_name((const uint8_t *)name, strlen(name));
+            arrival[dev] = ++arrivals;
+        }
+
+        if (k % CHECK_EVERY == CHECK_EVERY - 1 || k == reports - 1)
+        {
+            // The checks are not part of the cost
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+            if (!check(arrival))
+            {
+                free(arrival);
+                return false;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+        }
+    }
+
+    hid_scan_stats_t stats;
+    hid_scan_store_get_stats(&stats);
+    printf("%5u advertisers: %ld reports, %.0f ns/report, %zu kept, %u evicted, %u names dropped\n",
+           (unsigned)devices, reports, ns / reports, hid_scan_store_count(), (unsigned)stats.evicted,
+           (unsigned)stats.names_dropped);
+    free(arrival);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t crowds[] = {16, HID_SCAN_POOL_SIZE, 300, 3000};
+    long reports = argc > 1 ? atol(argv[1]) : 500000;
+
+    for (size_t i = 0; i < sizeof(crowds) / sizeof(crowds[0]); i++)
+    {
+        if (!flood(crowds[i], reports))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
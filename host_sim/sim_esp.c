@@ -0,0 +1,387 @@
+/*  esp_timer, esp_log, NVS and esp_err for the host build
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#define NVS_MAX_ENTRIES 16
+#define NVS_KEY_MAX 16
+#define NVS_VALUE_MAX 1024 // a full macro slot (hid_macro.h)
+
+/* ───────────────────────── esp_timer ────────────────────────────── */
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t due_us;
+    uint64_t period_us;
+    bool armed;
+    struct esp_timer *next; // every created timer
+};
+
+static pthread_mutex_t s_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_timer_cond;
+static pthread_once_t s_timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *s_timers;
+static struct timespec s_start;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_start.tv_sec) * 1000000 + (now.tv_nsec - s_start.tv_nsec) / 1000;
+}
+
+static struct esp_timer *next_due(void)
+{
+    struct esp_timer *first = NULL;
+
+    for (struct esp_timer *t = s_timers; t; t = t->next)
+    {
+        if (t->armed && (!first || t->due_us < first->due_us))
+        {
+            first = t;
+        }
+    }
+    return first;
+}
+
+/* The esp_timer task: runs callbacks in due order, without the lock held */
+static void *timer_thread(void *arg)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    while (1)
+    {
+        struct esp_timer *t = next_due();
+        int64_t now = esp_timer_get_time();
+
+        if (!t)
+        {
+            pthread_cond_wait(&s_timer_cond, &s_timer_lock);
+            continue;
+        }
+        if (t->due_us > now)
+        {
+            int64_t abs_us = t->due_us + (int64_t)s_start.tv_sec * 1000000 + s_start.tv_nsec / 1000;
+            struct timespec until = {.tv_sec = abs_us / 1000000, .tv_nsec = abs_us % 1000000 * 1000};
+            pthread_cond_timedwait(&s_timer_cond, &s_timer_lock, &until);
+            continue;
+        }
+        if (t->period_us)
+        {
+            t->due_us += t->period_us;
+        }
+        else
+        {
+            t->armed = false;
+        }
+        pthread_mutex_unlock(&s_timer_lock);
+        t->callback(t->arg);
+        pthread_mutex_lock(&s_timer_lock);
+    }
+    return NULL;
+}
+
+static void timer_start_thread(void)
+{
+    pthread_condattr_t attr;
+    pthread_t thread;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_create(&thread, NULL, timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    struct esp_timer *t = calloc(1, sizeof(*t));
+
+    if (!args || !args->callback || !out)
+    {
+        free(t);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!t)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_once(&s_timer_once, timer_start_thread);
+    t->callback = args->callback;
+    t->arg = args->arg;
+    pthread_mutex_lock(&s_timer_lock);
+    t->next = s_timers;
+    s_timers = t;
+    pthread_mutex_unlock(&s_timer_lock);
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&s_timer_lock);
+    if (t->armed)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        t->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+        t->period_us = period_us;
+        t->armed = true;
+        pthread_cond_signal(&s_timer_cond);
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&s_timer_lock);
+    if (!timer->armed)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    pthread_mutex_unlock(&s_timer_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    for (struct esp_timer **p = &s_timers; *p; p = &(*p)->next)
+    {
+        if (*p == timer)
+        {
+            *p = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+/* Time zero is process start, like esp_timer counting from reset */
+__attribute__((constructor)) static void timer_epoch(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_start);
+}
+
+/* ───────────────────────── esp_log ────────────────────────────── */
+static esp_log_level_t s_log_level = CONFIG_LOG_DEFAULT_LEVEL;
+static pthread_mutex_t s_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    if (strcmp(tag, "*") == 0)
+    {
+        s_log_level = level;
+    }
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list args;
+
+    if (level > s_log_level)
+    {
+        return;
+    }
+    pthread_mutex_lock(&s_log_lock);
+    fprintf(stderr, "%c (%" PRId64 ") %s: ", letters[level], esp_timer_get_time() / 1000, tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&s_log_lock);
+}
+
+/* ───────────────────────── esp_err ────────────────────────────── */
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+/* ───────────────────────── NVS ────────────────────────────── */
+typedef struct
+{
+    char ns[NVS_KEY_MAX];
+    char key[NVS_KEY_MAX];
+    uint8_t value[NVS_VALUE_MAX];
+    size_t len;
+    bool used;
+} nvs_entry_t;
+
+// Handles are namespace slots + 1
+static char s_namespaces[NVS_MAX_ENTRIES][NVS_KEY_MAX];
+static nvs_entry_t s_entries[NVS_MAX_ENTRIES];
+static pthread_mutex_t s_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key, bool create)
+{
+    const char *ns = s_namespaces[handle - 1];
+    nvs_entry_t *free_entry = NULL;
+
+    for (int i = 0; i < NVS_MAX_ENTRIES; i++)
+    {
+        nvs_entry_t *e = &s_entries[i];
+        if (e->used && strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0)
+        {
+            return e;
+        }
+        if (!e->used && !free_entry)
+        {
+            free_entry = e;
+        }
+    }
+    if (!create || !free_entry)
+    {
+        return NULL;
+    }
+    snprintf(free_entry->ns, sizeof(free_entry->ns), "%s", ns);
+    snprintf(free_entry->key, sizeof(free_entry->key), "%s", key);
+    free_entry->used = true;
+    return free_entry;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    pthread_mutex_lock(&s_nvs_lock);
+    for (int i = 0; i < NVS_MAX_ENTRIES; i++)
+    {
+        if (strcmp(s_namespaces[i], ns) == 0 || s_namespaces[i][0] == '\0')
+        {
+            if (s_namespaces[i][0] == '\0' && mode == NVS_READONLY)
+            {
+                err = ESP_ERR_NVS_NOT_FOUND; // a namespace exists once written to
+                break;
+            }
+            snprintf(s_namespaces[i], NVS_KEY_MAX, "%s", ns);
+            *out = i + 1;
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *len)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_entry_t *e = nvs_find(handle, key, false);
+    if (e && out && *len < e->len)
+    {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    else if (e)
+    {
+        if (out)
+        {
+            memcpy(out, e->value, e->len);
+        }
+        *len = e->len;
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t len)
+{
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    if (len > NVS_VALUE_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_entry_t *e = nvs_find(handle, key, true);
+    if (e)
+    {
+        memcpy(e->value, value, len);
+        e->len = len;
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out)
+{
+    size_t len = sizeof(*out);
+    return nvs_get_blob(handle, key, out, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
@@ -0,0 +1,73 @@
+/*  Client link of the host-simulated firmware
+ *
+ *  The firmware listens on a SOCK_SEQPACKET Unix socket, one client at a
+ *  time; the accepted connection stands for the BLE link. Every packet is
+ *  one GATT operation or event:
+ *
+ *      [u8 type][u8 id][payload]
+ *
+ *  with id a characteristic (SIM_CHR_*) or, for SIM_MSG_REPORT, a report ID.
+ *  Client to firmware:
+ *      WRITE / WRITE_CMD   data          write with / without response
+ *      READ                -             answered by READ_RSP
+ *      SUBSCRIBE           [u8 on]       notifications of one characteristic
+ *      MTU                 [u16 mtu]     exchange, answered by MTU_RSP
+ *      HOST_OUTPUT         [u8 leds]     keyboard LED output report of the host
+ *      HOST_PROTOCOL       [u8 mode]     protocol mode written by the host
+ *  Firmware to client:
+ *      WRITE_RSP           [u8 att err]
+ *      READ_RSP            [u8 att err][value]
+ *      NOTIFY              value         cut to MTU - 3 like an ATT notification
+ *      MTU_RSP             [u16 mtu]
+ *      REPORT              report        input report as the host receives it
+ *
+ *  Timing (connection interval, retries) is left to the client side, which
+ *  holds packets for its emulated connection events.
+ */
+#ifndef _SIM_LINK_H_
+#define _SIM_LINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MSG_WRITE 0x01
+#define SIM_MSG_WRITE_CMD 0x02
+#define SIM_MSG_READ 0x03
+#define SIM_MSG_SUBSCRIBE 0x04
+#define SIM_MSG_MTU 0x05
+#define SIM_MSG_HOST_OUTPUT 0x10
+#define SIM_MSG_HOST_PROTOCOL 0x11
+
+#define SIM_MSG_WRITE_RSP 0x81
+#define SIM_MSG_READ_RSP 0x83
+#define SIM_MSG_NOTIFY 0x84
+#define SIM_MSG_MTU_RSP 0x85
+#define SIM_MSG_REPORT 0x90
+
+/* Custom service characteristics of mainHid.c */
+#define SIM_CHR_WRITE 1
+#define SIM_CHR_STATUS 2
+#define SIM_CHR_CLOCK 3
+#define SIM_CHR_STATS 4
+#define SIM_CHR_CONFIG 5
+#define SIM_CHR_MAX 6
+
+#define SIM_LINK_HDR_LEN 2
+#define SIM_LINK_MTU_DEFAULT 23
+#define SIM_LINK_MTU_MAX 256 // CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU
+#define SIM_LINK_PACKET_MAX (SIM_LINK_HDR_LEN + 1 + SIM_LINK_MTU_MAX)
+
+#define SIM_ATT_ERR_READ_NOT_PERMITTED 0x02
+#define SIM_ATT_ERR_WRITE_NOT_PERMITTED 0x03
+#define SIM_ATT_ERR_INVALID_ATTR_VALUE_LEN 0x0D
+#define SIM_ATT_ERR_VALUE_NOT_ALLOWED 0x13
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_LINK_H_ */
@@ -0,0 +1,354 @@
+/*  Host-simulated firmware
+ *
+ *  The command and report pipeline of the device (hid_cmd, hid_output,
+ *  hid_sched, hid_config, ...) built unchanged as a Linux process. The BLE
+ *  side of mainHid.c is replaced by the socket link of sim_link.h: client
+ *  writes reach the same entry points as the custom characteristics, and
+ *  input reports go back to the client as the host would receive them.
+ *
+ *      hid_sim [socket path]
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "esp_hidd.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "hid_battery.h"
+#include "hid_boot.h"
+#include "hid_cmd.h"
+#include "hid_config.h"
+#include "hid_l2cap.h"
+#include "hid_output.h"
+#include "hid_proto.h"
+#include "hid_sched.h"
+#include "hid_sysmon.h"
+#include "hid_unicode.h"
+#include "sim_link.h"
+
+static const char *TAG = "HID_SIM";
+
+#define SOCKET_PATH_DEFAULT "/tmp/hid_sim.sock"
+
+/* ───────────────────────── Globals ─────────────────────────────── */
+// Link state is written by the accept loop and read by every sender
+static pthread_mutex_t s_link_lock = PTHREAD_MUTEX_INITIALIZER;
+static int s_conn = -1;
+static uint16_t s_mtu = SIM_LINK_MTU_DEFAULT;
+static bool s_subscribed[SIM_CHR_MAX];
+
+/* ───────────────────────── Link ────────────────────────────── */
+static bool link_send(uint8_t type, uint8_t id, const uint8_t *data, size_t len)
+{
+    uint8_t pkt[SIM_LINK_PACKET_MAX];
+    bool sent = false;
+
+    if (len > sizeof(pkt) - SIM_LINK_HDR_LEN)
+    {
+        return false;
+    }
+    pkt[0] = type;
+    pkt[1] = id;
+    memcpy(pkt + SIM_LINK_HDR_LEN, data, len);
+
+    pthread_mutex_lock(&s_link_lock);
+    if (s_conn >= 0)
+    {
+        sent = send(s_conn, pkt, SIM_LINK_HDR_LEN + len, MSG_NOSIGNAL) == (ssize_t)(SIM_LINK_HDR_LEN + len);
+    }
+    pthread_mutex_unlock(&s_link_lock);
+    return sent;
+}
+
+/* Like ble_gatts_notify_custom: dropped unless subscribed, cut to MTU - 3 */
+static void notify(uint8_t chr, const uint8_t *data, size_t len)
+{
+    pthread_mutex_lock(&s_link_lock);
+    bool subscribed = s_subscribed[chr];
+    size_t max = s_mtu - 3;
+    pthread_mutex_unlock(&s_link_lock);
+
+    if (subscribed)
+    {
+        link_send(SIM_MSG_NOTIFY, chr, data, len < max ? len : max);
+    }
+}
+
+esp_err_t esp_hidd_dev_input_set(esp_hidd_dev_t *dev, size_t map_index, size_t report_id, uint8_t *data,
+                                 size_t length)
+{
+    return link_send(SIM_MSG_REPORT, (uint8_t)report_id, data, length) ? ESP_OK : ESP_FAIL;
+}
+
+static void clock_notify(const uint8_t *msg, size_t len)
+{
+    notify(SIM_CHR_CLOCK, msg, len);
+}
+
+static void status_notify(void)
+{
+    uint8_t status[HID_STATUS_LEN] = {hid_output_get_leds(), hid_output_get_protocol()};
+    notify(SIM_CHR_STATUS, status, sizeof(status));
+}
+
+/* ───────────────────────── Characteristics ────────────────────────────── */
+/* Same paths as custom_write_cb / custom_config_cb in mainHid.c */
+static uint8_t chr_write(uint8_t chr, const uint8_t *data, size_t len)
+{
+    int64_t rx_us = esp_timer_get_time();
+
+    switch (chr)
+    {
+    case SIM_CHR_WRITE:
+        if (len == HID_PROTO_FRAME_HDR_LEN + HID_TIME_SYNC_LEN && data[0] == HID_PROTO_FRAME_MARKER &&
+            data[1] == HID_OP_TIME_SYNC)
+        {
+            hid_sched_sync_request(data + HID_PROTO_FRAME_HDR_LEN, HID_TIME_SYNC_LEN, rx_us);
+            return 0;
+        }
+        if (len)
+        {
+            hid_cmd_submit(HID_CMD_SRC_GATT, data, len);
+        }
+        return 0;
+    case SIM_CHR_CONFIG:
+    {
+        esp_err_t err = hid_config_write(data, len);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Config write refused (%s)", esp_err_to_name(err));
+            return err == ESP_ERR_INVALID_SIZE ? SIM_ATT_ERR_INVALID_ATTR_VALUE_LEN : SIM_ATT_ERR_VALUE_NOT_ALLOWED;
+        }
+        return 0;
+    }
+    default:
+        return SIM_ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+}
+
+/* Fills rsp after its error byte; returns the value length */
+static size_t chr_read(uint8_t chr, uint8_t *rsp, size_t max)
+{
+    switch (chr)
+    {
+    case SIM_CHR_STATUS:
+        rsp[0] = 0;
+        rsp[1] = hid_output_get_leds();
+        rsp[2] = hid_output_get_protocol();
+        return HID_STATUS_LEN;
+    case SIM_CHR_STATS:
+        rsp[0] = 0;
+        return hid_boot_encode(rsp + 1, max - 1);
+    case SIM_CHR_CONFIG:
+        rsp[0] = 0;
+        return hid_config_read(rsp + 1, max - 1);
+    default:
+        rsp[0] = SIM_ATT_ERR_READ_NOT_PERMITTED;
+        return 0;
+    }
+}
+
+static void handle_packet(const uint8_t *pkt, size_t len)
+{
+    uint8_t rsp[1 + HID_CONFIG_READ_MAX];
+
+    if (len < SIM_LINK_HDR_LEN)
+    {
+        return;
+    }
+    const uint8_t *data = pkt + SIM_LINK_HDR_LEN;
+    size_t data_len = len - SIM_LINK_HDR_LEN;
+    uint8_t id = pkt[1];
+
+    switch (pkt[0])
+    {
+    case SIM_MSG_WRITE:
+        rsp[0] = chr_write(id, data, data_len);
+        link_send(SIM_MSG_WRITE_RSP, id, rsp, 1);
+        break;
+    case SIM_MSG_WRITE_CMD:
+        chr_write(id, data, data_len);
+        break;
+    case SIM_MSG_READ:
+    {
+        size_t n = chr_read(id, rsp, sizeof(rsp));
+        link_send(SIM_MSG_READ_RSP, id, rsp, 1 + n);
+        break;
+    }
+    case SIM_MSG_SUBSCRIBE:
+        if (id < SIM_CHR_MAX && data_len >= 1)
+        {
+            pthread_mutex_lock(&s_link_lock);
+            s_subscribed[id] = data[0] != 0;
+            pthread_mutex_unlock(&s_link_lock);
+        }
+        break;
+    case SIM_MSG_MTU:
+        if (data_len >= 2)
+        {
+            uint16_t mtu = data[0] | data[1] << 8;
+            mtu = mtu < SIM_LINK_MTU_DEFAULT ? SIM_LINK_MTU_DEFAULT : mtu > SIM_LINK_MTU_MAX ? SIM_LINK_MTU_MAX : mtu;
+            pthread_mutex_lock(&s_link_lock);
+            s_mtu = mtu;
+            pthread_mutex_unlock(&s_link_lock);
+            uint8_t val[2] = {mtu & 0xff, mtu >> 8};
+            link_send(SIM_MSG_MTU_RSP, 0, val, sizeof(val));
+            ESP_LOGI(TAG, "MTU %u", mtu);
+        }
+        break;
+    case SIM_MSG_HOST_OUTPUT:
+        // As ESP_HIDD_OUTPUT_EVENT in mainHid.c
+        if (data_len >= 1 && data[0] != hid_output_get_leds())
+        {
+            ESP_LOGI(TAG, "LEDs: 0x%02x", data[0]);
+            hid_output_set_leds(data[0]);
+            status_notify();
+        }
+        break;
+    case SIM_MSG_HOST_PROTOCOL:
+        if (data_len >= 1)
+        {
+            hid_output_set_protocol(data[0] ? ESP_HID_PROTOCOL_MODE_REPORT : ESP_HID_PROTOCOL_MODE_BOOT);
+            status_notify();
+        }
+        break;
+    default:
+        ESP_LOGW(TAG, "Unknown packet 0x%02x", pkt[0]);
+        break;
+    }
+}
+
+/* ───────────────────────── Connection ────────────────────────────── */
+static void serve(int conn)
+{
+    uint8_t pkt[SIM_LINK_PACKET_MAX + 64];
+    ssize_t n;
+
+    pthread_mutex_lock(&s_link_lock);
+    s_conn = conn;
+    s_mtu = SIM_LINK_MTU_DEFAULT;
+    memset(s_subscribed, 0, sizeof(s_subscribed));
+    pthread_mutex_unlock(&s_link_lock);
+
+    // As ESP_HIDD_CONNECT_EVENT in mainHid.c
+    ESP_LOGI(TAG, "Client connected");
+    hid_output_set_protocol(ESP_HID_PROTOCOL_MODE_REPORT);
+    hid_output_resync();
+    hid_boot_mark(HID_BOOT_CONNECTED);
+
+    while ((n = recv(conn, pkt, sizeof(pkt), 0)) > 0)
+    {
+        handle_packet(pkt, n);
+    }
+
+    pthread_mutex_lock(&s_link_lock);
+    s_conn = -1;
+    pthread_mutex_unlock(&s_link_lock);
+    close(conn);
+    ESP_LOGI(TAG, "Client disconnected");
+}
+
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+
+    if (sock < 0 || strlen(path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, 1) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* ───────────────────────── Config ────────────────────────────── */
+/* The part of config_apply in mainHid.c that is not about the radio */
+static void config_apply(const hid_config_t *c, uint8_t key)
+{
+    if (key == 0 || key == HID_CFG_unicode_mode)
+    {
+        hid_unicode_set_mode((hid_unicode_mode_t)c->unicode_mode);
+    }
+    if (key == 0 || key == HID_CFG_nkro)
+    {
+        hid_output_set_nkro(c->nkro);
+    }
+    if (key == 0 || key == HID_CFG_log_level)
+    {
+        esp_log_level_set("*", (esp_log_level_t)c->log_level);
+    }
+}
+
+/* ───────────────────────── Not in the host build ────────────────────────────── */
+void hid_battery_log_stats(void)
+{
+}
+
+void hid_l2cap_resume(void)
+{
+}
+
+void hid_l2cap_log_stats(void)
+{
+}
+
+void hid_sysmon_register(TaskHandle_t task, uint32_t stack_size)
+{
+}
+
+void hid_sysmon_log(void)
+{
+}
+
+/* ───────────────────────── main ────────────────────────────── */
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : SOCKET_PATH_DEFAULT;
+
+    hid_boot_mark(HID_BOOT_APP_MAIN);
+    ESP_ERROR_CHECK(hid_config_init());
+    hid_boot_mark(HID_BOOT_NVS);
+
+    // esp_hidd_dev_input_set ignores the device, any non-NULL handle does
+    ESP_ERROR_CHECK(hid_output_init((esp_hidd_dev_t *)&s_conn));
+    hid_config_set_apply(config_apply);
+    ESP_ERROR_CHECK(hid_cmd_init());
+    ESP_ERROR_CHECK(hid_sched_init(clock_notify));
+    hid_boot_mark(HID_BOOT_SERVICES);
+
+    int sock = listen_on(path);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Cannot listen on %s (%s)", path, strerror(errno));
+        return 1;
+    }
+    ESP_LOGI(TAG, "Listening on %s", path);
+    hid_boot_mark(HID_BOOT_ADVERTISING);
+
+    while (1)
+    {
+        int conn = accept(sock, NULL, NULL);
+        if (conn < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ESP_LOGE(TAG, "accept failed (%s)", strerror(errno));
+            return 1;
+        }
+        serve(conn);
+    }
+}
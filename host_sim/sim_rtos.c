@@ -0,0 +1,450 @@
+/*  FreeRTOS primitives on POSIX threads
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/message_buffer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+
+#include "esp_timer.h"
+
+struct sim_task
+{
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+};
+
+struct sim_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // signalled on every send and receive
+    uint8_t *storage;
+    size_t item_size;
+    size_t len;
+    size_t head;
+    size_t count;
+};
+
+struct sim_mutex
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool taken;
+};
+
+struct sim_stream
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *storage;
+    size_t size;
+    size_t head;
+    size_t count;
+    bool message; // message buffer: every write is [size_t len][data]
+};
+
+static __thread struct sim_task *s_current;
+
+/* ───────────────────────── Time ────────────────────────────── */
+static void sim_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec deadline(TickType_t wait)
+{
+    struct timespec ts;
+    uint64_t us = (uint64_t)wait * 1000000 / configTICK_RATE_HZ;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += us / 1000000;
+    ts.tv_nsec += (us % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+/* Waits on cond until woken or the deadline passes; false on timeout.
+ * wait 0 never blocks, portMAX_DELAY never times out. */
+static bool wait_cond(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t wait, const struct timespec *until)
+{
+    if (wait == 0)
+    {
+        return false;
+    }
+    if (wait == portMAX_DELAY)
+    {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, until) != ETIMEDOUT;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() * configTICK_RATE_HZ / 1000000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = deadline(ticks);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+/* ───────────────────────── Tasks ────────────────────────────── */
+static void *task_main(void *arg)
+{
+    struct sim_task *task = arg;
+
+    s_current = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core)
+{
+    struct sim_task *task = calloc(1, sizeof(*task));
+
+    if (!task)
+    {
+        return NULL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    sim_cond_init(&task->cond);
+    if (pthread_create(&task->thread, NULL, task_main, task) != 0)
+    {
+        free(task);
+        return NULL;
+    }
+    pthread_detach(task->thread);
+    return task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    struct sim_task *task = s_current;
+    struct timespec until = deadline(wait);
+    uint32_t value;
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notify == 0 && wait_cond(&task->cond, &task->lock, wait, &until))
+    {
+    }
+    value = task->notify;
+    if (value)
+    {
+        task->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+/* ───────────────────────── Queues ────────────────────────────── */
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *ctl)
+{
+    struct sim_queue *q = calloc(1, sizeof(*q));
+
+    if (q)
+    {
+        pthread_mutex_init(&q->lock, NULL);
+        sim_cond_init(&q->cond);
+        q->storage = storage;
+        q->item_size = item_size;
+        q->len = len;
+    }
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+    BaseType_t ret = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->len && wait_cond(&q->cond, &q->lock, wait, &until))
+    {
+    }
+    if (q->count < q->len)
+    {
+        memcpy(q->storage + (q->head + q->count) % q->len * q->item_size, item, q->item_size);
+        q->count++;
+        pthread_cond_broadcast(&q->cond);
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+    BaseType_t ret = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && wait_cond(&q->cond, &q->lock, wait, &until))
+    {
+    }
+    if (q->count)
+    {
+        memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->len;
+        q->count--;
+        pthread_cond_broadcast(&q->cond);
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->len - q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+/* ───────────────────────── Mutexes ────────────────────────────── */
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *ctl)
+{
+    struct sim_mutex *m = calloc(1, sizeof(*m));
+
+    if (m)
+    {
+        pthread_mutex_init(&m->lock, NULL);
+        sim_cond_init(&m->cond);
+    }
+    return m;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+    BaseType_t ret = pdFALSE;
+
+    pthread_mutex_lock(&sem->lock);
+    while (sem->taken && wait_cond(&sem->cond, &sem->lock, wait, &until))
+    {
+    }
+    if (!sem->taken)
+    {
+        sem->taken = true;
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    sem->taken = false;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+}
+
+/* ───────────────────────── Stream / Message Buffers ────────────────────────────── */
+static struct sim_stream *stream_create(size_t size, uint8_t *storage, bool message)
+{
+    struct sim_stream *sb = calloc(1, sizeof(*sb));
+
+    if (sb)
+    {
+        pthread_mutex_init(&sb->lock, NULL);
+        sim_cond_init(&sb->cond);
+        sb->storage = storage;
+        sb->size = size;
+        sb->message = message;
+    }
+    return sb;
+}
+
+static void ring_put(struct sim_stream *sb, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        sb->storage[(sb->head + sb->count + i) % sb->size] = p[i];
+    }
+    sb->count += len;
+}
+
+static void ring_get(struct sim_stream *sb, void *buf, size_t len)
+{
+    uint8_t *p = buf;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        p[i] = sb->storage[(sb->head + i) % sb->size];
+    }
+    sb->head = (sb->head + len) % sb->size;
+    sb->count -= len;
+}
+
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size, size_t trigger, uint8_t *storage,
+                                               StaticStreamBuffer_t *ctl)
+{
+    return stream_create(size, storage, false);
+}
+
+MessageBufferHandle_t xMessageBufferCreateStatic(size_t size, uint8_t *storage, StaticMessageBuffer_t *ctl)
+{
+    return stream_create(size, storage, true);
+}
+
+static size_t stream_send(struct sim_stream *sb, const void *data, size_t len, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+    size_t need = sb->message ? len + sizeof(size_t) : 1;
+    size_t sent = 0;
+
+    pthread_mutex_lock(&sb->lock);
+    while (sb->size - sb->count < need && wait_cond(&sb->cond, &sb->lock, wait, &until))
+    {
+    }
+    if (sb->message && sb->size - sb->count >= need)
+    {
+        ring_put(sb, &len, sizeof(len));
+        ring_put(sb, data, len);
+        sent = len;
+    }
+    else if (!sb->message)
+    {
+        // Streams take what fits
+        sent = sb->size - sb->count < len ? sb->size - sb->count : len;
+        ring_put(sb, data, sent);
+    }
+    if (sent)
+    {
+        pthread_cond_broadcast(&sb->cond);
+    }
+    pthread_mutex_unlock(&sb->lock);
+    return sent;
+}
+
+static size_t stream_receive(struct sim_stream *sb, void *buf, size_t len, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+    size_t got = 0;
+
+    pthread_mutex_lock(&sb->lock);
+    while (sb->count == 0 && wait_cond(&sb->cond, &sb->lock, wait, &until))
+    {
+    }
+    if (sb->count && sb->message)
+    {
+        size_t n;
+        // Peek the length; a message larger than buf stays queued, as on FreeRTOS
+        size_t head = sb->head, count = sb->count;
+        ring_get(sb, &n, sizeof(n));
+        if (n <= len)
+        {
+            ring_get(sb, buf, n);
+            got = n;
+        }
+        else
+        {
+            sb->head = head;
+            sb->count = count;
+        }
+    }
+    else if (sb->count)
+    {
+        got = sb->count < len ? sb->count : len;
+        ring_get(sb, buf, got);
+    }
+    if (got)
+    {
+        pthread_cond_broadcast(&sb->cond);
+    }
+    pthread_mutex_unlock(&sb->lock);
+    return got;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t wait)
+{
+    return stream_send(sb, data, len, wait);
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *buf, size_t len, TickType_t wait)
+{
+    return stream_receive(sb, buf, len, wait);
+}
+
+size_t xMessageBufferSend(MessageBufferHandle_t mb, const void *data, size_t len, TickType_t wait)
+{
+    return stream_send(mb, data, len, wait);
+}
+
+size_t xMessageBufferReceive(MessageBufferHandle_t mb, void *buf, size_t len, TickType_t wait)
+{
+    return stream_receive(mb, buf, len, wait);
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->lock);
+    size_t n = sb->size - sb->count;
+    pthread_mutex_unlock(&sb->lock);
+    return n;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->lock);
+    size_t n = sb->count;
+    pthread_mutex_unlock(&sb->lock);
+    return n;
+}
+
+size_t xMessageBufferSpacesAvailable(MessageBufferHandle_t mb)
+{
+    return xStreamBufferSpacesAvailable(mb);
+}
@@ -14,6 +14,7 @@
 #include "freertos/semphr.h"
 
 #include "esp_hid_gap.h"
+#include "hid_scan_store.h"
 
 #if CONFIG_BT_NIMBLE_ENABLED
 #include "host/ble_hs.h"
@@ -22,6 +23,7 @@
 #include "host/ble_hs_adv.h"
 #include "nimble/ble.h"
 #include "host/ble_sm.h"
+#include "esp_timer.h"
 #else
 #include "esp_bt_device.h"
 #endif
@@ -33,11 +35,15 @@ static const char *TAG = "ESP_HID_GAP";
 //static const char * gap_bt_prop_type_names[5] = {"","BDNAME","COD","RSSI","EIR"};
 
 #if !CONFIG_BT_NIMBLE_ENABLED
-static esp_hid_scan_result_t *bt_scan_results = NULL;
-static size_t num_bt_scan_results = 0;
-
-static esp_hid_scan_result_t *ble_scan_results = NULL;
-static size_t num_ble_scan_results = 0;
+/*
+ * BLE and BR/EDR discovery run at the same time and share one result store
+ * (hid_scan_store.c), which esp_hid_scan_results_free() resets as a whole.
+ */
+static esp_hid_scan_match_t scan_match = NULL;
+static void *scan_match_arg = NULL;
+static bool scan_matched = false;
+static bool ble_scanning = false;
+static bool bt_scanning = false;
 #endif
 
 static SemaphoreHandle_t bt_hidh_cb_semaphore = NULL;
@@ -124,119 +130,87 @@ const char *esp_ble_key_type_str(esp_ble_key_type_t key_type)
 #if !CONFIG_BT_NIMBLE_ENABLED
 void esp_hid_scan_results_free(esp_hid_scan_result_t *results)
 {
-    esp_hid_scan_result_t *r = NULL;
-    while (results) {
-        r = results;
-        results = results->next;
-        if (r->name != NULL) {
-            free((char *)r->name);
-        }
-        free(r);
-    }
+    // Every result lives in the store, so releasing them is a reset
+    (void)results;
+    hid_scan_store_reset();
 }
 #endif
 
 #if (CONFIG_BT_HID_DEVICE_ENABLED || CONFIG_BT_BLE_ENABLED)
-static esp_hid_scan_result_t *find_scan_result(esp_bd_addr_t bda, esp_hid_scan_result_t *results)
+static void stop_scans(void)
 {
-    esp_hid_scan_result_t *r = results;
-    while (r) {
-        if (memcmp(bda, r->bda, sizeof(esp_bd_addr_t)) == 0) {
-            return r;
-        }
-        r = r->next;
+#if CONFIG_BT_BLE_ENABLED
+    if (ble_scanning) {
+        esp_ble_gap_stop_scanning();
+    }
+#endif
+#if CONFIG_BT_HID_DEVICE_ENABLED
+    if (bt_scanning) {
+        esp_bt_gap_cancel_discovery();
+    }
+#endif
+}
+
+/* Both discoveries report on the BTC task, so results never race each other */
+static void check_scan_match(esp_hid_scan_result_t *r)
+{
+    if (scan_match && !scan_matched && scan_match(r, scan_match_arg)) {
+        scan_matched = true;
+        stop_scans();
     }
-    return NULL;
 }
 #endif /* (CONFIG_BT_HID_DEVICE_ENABLED || CONFIG_BT_BLE_ENABLED) */
 
 #if CONFIG_BT_HID_DEVICE_ENABLED
 static void add_bt_scan_result(esp_bd_addr_t bda, esp_bt_cod_t *cod, esp_bt_uuid_t *uuid, uint8_t *name, uint8_t name_len, int rssi)
 {
-    esp_hid_scan_result_t *r = find_scan_result(bda, bt_scan_results);
+    esp_hid_scan_result_t *r = hid_scan_store_find(bda, ESP_HID_TRANSPORT_BT);
     if (r) {
         //Some info may come later
         if (r->name == NULL && name && name_len) {
-            char *name_s = (char *)malloc(name_len + 1);
-            if (name_s == NULL) {
-                ESP_LOGE(TAG, "Malloc result name failed!");
-                return;
-            }
-            memcpy(name_s, name, name_len);
-            name_s[name_len] = 0;
-            r->name = (const char *)name_s;
+            r->name = hid_scan_store_name(name, name_len);
         }
         if (r->bt.uuid.len == 0 && uuid->len) {
             memcpy(&r->bt.uuid, uuid, sizeof(esp_bt_uuid_t));
         }
-        if (rssi != 0) {
-            r->rssi = rssi;
-        }
+        hid_scan_store_heard(r, rssi);
+        check_scan_match(r);
         return;
     }
 
-    r = (esp_hid_scan_result_t *)malloc(sizeof(esp_hid_scan_result_t));
-    if (r == NULL) {
-        ESP_LOGE(TAG, "Malloc bt_hidh_scan_result_t failed!");
-        return;
-    }
-    r->transport = ESP_HID_TRANSPORT_BT;
-    memcpy(r->bda, bda, sizeof(esp_bd_addr_t));
+    r = hid_scan_store_add(bda, ESP_HID_TRANSPORT_BT, rssi);
     memcpy(&r->bt.cod, cod, sizeof(esp_bt_cod_t));
     memcpy(&r->bt.uuid, uuid, sizeof(esp_bt_uuid_t));
     r->usage = esp_hid_usage_from_cod((uint32_t)cod);
-    r->rssi = rssi;
-    r->name = NULL;
     if (name_len && name) {
-        char *name_s = (char *)malloc(name_len + 1);
-        if (name_s == NULL) {
-            free(r);
-            ESP_LOGE(TAG, "Malloc result name failed!");
-            return;
-        }
-        memcpy(name_s, name, name_len);
-        name_s[name_len] = 0;
-        r->name = (const char *)name_s;
+        r->name = hid_scan_store_name(name, name_len);
     }
-    r->next = bt_scan_results;
-    bt_scan_results = r;
-    num_bt_scan_results++;
+    check_scan_match(r);
 }
 #endif
 
 #if CONFIG_BT_BLE_ENABLED
 static void add_ble_scan_result(esp_bd_addr_t bda, esp_ble_addr_type_t addr_type, uint16_t appearance, uint8_t *name, uint8_t name_len, int rssi)
 {
-    if (find_scan_result(bda, ble_scan_results)) {
-        ESP_LOGW(TAG, "Result already exists!");
-        return;
-    }
-    esp_hid_scan_result_t *r = (esp_hid_scan_result_t *)malloc(sizeof(esp_hid_scan_result_t));
-    if (r == NULL) {
-        ESP_LOGE(TAG, "Malloc ble_hidh_scan_result_t failed!");
+    esp_hid_scan_result_t *r = hid_scan_store_find(bda, ESP_HID_TRANSPORT_BLE);
+    if (r) {
+        // Advertisements repeat; only the name (from a scan response) can be new
+        if (r->name == NULL && name && name_len) {
+            r->name = hid_scan_store_name(name, name_len);
+        }
+        hid_scan_store_heard(r, rssi);
+        check_scan_match(r);
         return;
     }
-    r->transport = ESP_HID_TRANSPORT_BLE;
-    memcpy(r->bda, bda, sizeof(esp_bd_addr_t));
+
+    r = hid_scan_store_add(bda, ESP_HID_TRANSPORT_BLE, rssi);
     r->ble.appearance = appearance;
     r->ble.addr_type = addr_type;
     r->usage = esp_hid_usage_from_appearance(appearance);
-    r->rssi = rssi;
-    r->name = NULL;
     if (name_len && name) {
-        char *name_s = (char *)malloc(name_len + 1);
-        if (name_s == NULL) {
-            free(r);
-            ESP_LOGE(TAG, "Malloc result name failed!");
-            return;
-        }
-        memcpy(name_s, name, name_len);
-        name_s[name_len] = 0;
-        r->name = (const char *)name_s;
+        r->name = hid_scan_store_name(name, name_len);
     }
-    r->next = ble_scan_results;
-    ble_scan_results = r;
-    num_ble_scan_results++;
+    check_scan_match(r);
 }
 #endif /* CONFIG_BT_BLE_ENABLED */
 
@@ -343,7 +317,7 @@ static void handle_bt_device_result(struct disc_res_param *disc_res)
     }
     GAP_DBG_PRINTF("\n");
 
-    if (cod->major == ESP_BT_COD_MAJOR_DEV_PERIPHERAL || (find_scan_result(disc_res->bda, bt_scan_results) != NULL)) {
+    if (cod->major == ESP_BT_COD_MAJOR_DEV_PERIPHERAL || (hid_scan_store_find(disc_res->bda, ESP_HID_TRANSPORT_BT) != NULL)) {
         add_bt_scan_result(disc_res->bda, cod, &uuid, name, name_len, rssi);
     }
 }
@@ -419,7 +393,8 @@ static void bt_gap_event_handler(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_para
     switch (event) {
     case ESP_BT_GAP_DISC_STATE_CHANGED_EVT: {
         ESP_LOGV(TAG, "BT GAP DISC_STATE %s", (param->disc_st_chg.state == ESP_BT_GAP_DISCOVERY_STARTED) ? "START" : "STOP");
-        if (param->disc_st_chg.state == ESP_BT_GAP_DISCOVERY_STOPPED) {
+        if (param->disc_st_chg.state == ESP_BT_GAP_DISCOVERY_STOPPED && bt_scanning) {
+            bt_scanning = false;
             SEND_BT_CB();
         }
         break;
@@ -505,8 +480,10 @@ static esp_err_t init_bt_gap(void)
 static esp_err_t start_bt_scan(uint32_t seconds)
 {
     esp_err_t ret = ESP_OK;
+    bt_scanning = true;
     if ((ret = esp_bt_gap_start_discovery(ESP_BT_INQ_MODE_GENERAL_INQUIRY, (int)(seconds / 1.28), 0)) != ESP_OK) {
         ESP_LOGE(TAG, "esp_bt_gap_start_discovery failed: %d", ret);
+        bt_scanning = false;
         return ret;
     }
     return ret;
@@ -517,7 +494,6 @@ static esp_err_t start_bt_scan(uint32_t seconds)
 /*
  * BLE GAP
  * */
-extern void ble_hid_task_start_up(void);
 static void ble_gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
     switch (event) {
@@ -538,7 +514,10 @@ static void ble_gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_p
         }
         case ESP_GAP_SEARCH_INQ_CMPL_EVT:
             ESP_LOGV(TAG, "BLE GAP EVENT SCAN DONE: %d", scan_result->scan_rst.num_resps);
-            SEND_BLE_CB();
+            if (ble_scanning) {
+                ble_scanning = false;
+                SEND_BLE_CB();
+            }
             break;
         default:
             break;
@@ -547,6 +526,11 @@ static void ble_gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_p
     }
     case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT: {
         ESP_LOGV(TAG, "BLE GAP EVENT SCAN CANCELED");
+        // Stopped early by a match; the window's INQ_CMPL will not come
+        if (ble_scanning) {
+            ble_scanning = false;
+            SEND_BLE_CB();
+        }
         break;
     }
 
@@ -571,7 +555,6 @@ static void ble_gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_p
         } else {
             ESP_LOGI(TAG, "BLE GAP AUTH SUCCESS");
         }
-        ble_hid_task_start_up();
         break;
 
     case ESP_GAP_BLE_KEY_EVT: //shows the ble key info share with peer device to the user.
@@ -640,8 +623,10 @@ static esp_err_t start_ble_scan(uint32_t seconds)
     }
     WAIT_BLE_CB();
 
+    ble_scanning = true;
     if ((ret = esp_ble_gap_start_scanning(seconds)) != ESP_OK) {
         ESP_LOGE(TAG, "esp_ble_gap_start_scanning failed: %d", ret);
+        ble_scanning = false;
         return ret;
     }
     return ret;
@@ -742,53 +727,105 @@ esp_err_t esp_hid_ble_gap_adv_start(void)
 
 #if CONFIG_BT_NIMBLE_ENABLED
 #define GATT_SVR_SVC_HID_UUID 0x1812
+#define HID_ADV_INSTANCE 0
+/* maximum possible duration for hid device(180s) */
+#define HID_ADV_DURATION_MS 180000
+#define HID_PASSKEY_DEFAULT 123456
+
+static int nimble_hid_gap_event(struct ble_gap_event *event, void *arg);
 
-extern void ble_hid_task_start_up(void);
-static struct ble_hs_adv_fields fields;
+/*
+ * Connect to first subscription, i.e. until reports reach the host. A host
+ * that cached the database has its subscriptions restored on encryption;
+ * one that has not spends the gap on service discovery.
+ */
+static struct {
+    uint16_t conn_handle;
+    int64_t connect_us;
+    int32_t enc_ms;
+    bool pending;
+} link_timing;
 
+/*
+ * The advertisement carries what centrals filter on (flags, appearance,
+ * TX power, HID UUID), the scan response carries the name and, when set,
+ * the 128-bit UUID of the application service so a client can scan for
+ * exactly this device; a name that no longer fits is shortened. Both are encoded
+ * once, on the first start since the TX power field needs a synced host, and
+ * stay in the controller; later restarts only re-enable advertising.
+ */
+static const ble_uuid16_t hid_uuid16 = BLE_UUID16_INIT(GATT_SVR_SVC_HID_UUID);
+static struct ble_hs_adv_fields adv_fields;
+static struct ble_hs_adv_fields rsp_fields;
+static ble_uuid128_t rsp_uuid128;
+static bool rsp_uuid128_set;
+static uint8_t adv_data[BLE_HS_ADV_MAX_SZ];
+static uint8_t adv_len;
+static uint8_t rsp_data[BLE_HS_ADV_MAX_SZ];
+static uint8_t rsp_len;
+static bool adv_configured;
+
+/* Runtime settings (esp_hid_ble_gap_set_*), picked up on the next start */
+static uint32_t sm_passkey = HID_PASSKEY_DEFAULT;
+static uint16_t adv_itvl_min = BLE_GAP_ADV_ITVL_MS(30); /* Recommended interval 30ms to 50ms */
+static uint16_t adv_itvl_max = BLE_GAP_ADV_ITVL_MS(50);
+static int32_t adv_duration_ms = HID_ADV_DURATION_MS;
+static struct ble_gap_upd_params conn_params; /* itvl_min 0: leave the central's */
+
+/* Controller state is gone after a host reset, payloads included */
+static void nimble_hid_on_reset(int reason)
+{
+    ESP_LOGW(TAG, "host reset; reason=%d", reason);
+    adv_configured = false;
+}
 
 esp_err_t esp_hid_ble_gap_adv_init(uint16_t appearance, const char *device_name)
 {
-    ble_uuid16_t *uuid16, *uuid16_1;
-    /**
-     *  Set the advertisement data included in our advertisements:
-     *     o Flags (indicates advertisement type and other general info).
-     *     o Advertising tx power.
-     *     o Device name.
-     *     o 16-bit service UUIDs (HID).
-     */
+    size_t name_len = strlen(device_name);
+    size_t name_room = BLE_HS_ADV_MAX_SZ - 2 - (rsp_uuid128_set ? 2 + 16 : 0);
 
-    memset(&fields, 0, sizeof fields);
+    if (name_len == 0) {
+        ESP_LOGE(TAG, "Device name is empty");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&adv_fields, 0, sizeof adv_fields);
+    memset(&rsp_fields, 0, sizeof rsp_fields);
 
     /* Advertise two flags:
      *     o Discoverability in forthcoming advertisement (general)
      *     o BLE-only (BR/EDR unsupported).
      */
-    fields.flags = BLE_HS_ADV_F_DISC_GEN |
-                   BLE_HS_ADV_F_BREDR_UNSUP;
+    adv_fields.flags = BLE_HS_ADV_F_DISC_GEN |
+                       BLE_HS_ADV_F_BREDR_UNSUP;
 
-    fields.appearance = ESP_HID_APPEARANCE_GENERIC;
-    fields.appearance_is_present = 1;
+    adv_fields.appearance = appearance;
+    adv_fields.appearance_is_present = 1;
 
     /* Indicate that the TX power level field should be included; have the
      * stack fill this value automatically.  This is done by assigning the
      * special value BLE_HS_ADV_TX_PWR_LVL_AUTO.
      */
-    fields.tx_pwr_lvl_is_present = 1;
-    fields.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
+    adv_fields.tx_pwr_lvl_is_present = 1;
+    adv_fields.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
 
-    fields.name = (uint8_t *)device_name;
-    fields.name_len = strlen(device_name);
-    fields.name_is_complete = 1;
+    adv_fields.uuids16 = &hid_uuid16;
+    adv_fields.num_uuids16 = 1;
+    adv_fields.uuids16_is_complete = 1;
 
-    uuid16 = (ble_uuid16_t *)malloc(sizeof(ble_uuid16_t));
-    uuid16_1 = (ble_uuid16_t[]) {
-        BLE_UUID16_INIT(GATT_SVR_SVC_HID_UUID)
-    };
-    memcpy(uuid16, uuid16_1, sizeof(ble_uuid16_t));
-    fields.uuids16 = uuid16;
-    fields.num_uuids16 = 1;
-    fields.uuids16_is_complete = 1;
+    if (rsp_uuid128_set) {
+        rsp_fields.uuids128 = &rsp_uuid128;
+        rsp_fields.num_uuids128 = 1;
+        rsp_fields.uuids128_is_complete = 1;
+    }
+
+    /* The full name stays readable in the GAP service */
+    rsp_fields.name = (uint8_t *)device_name;
+    rsp_fields.name_len = name_len > name_room ? name_room : name_len;
+    rsp_fields.name_is_complete = name_len <= name_room;
+
+    adv_configured = false;
+    ble_hs_cfg.reset_cb = nimble_hid_on_reset;
 
     /* Initialize the security configuration */
     ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_DISP_ONLY;
@@ -802,6 +839,105 @@ esp_err_t esp_hid_ble_gap_adv_init(uint16_t appearance, const char *device_name)
 
 }
 
+static int adv_encode(void)
+{
+    int rc = ble_hs_adv_set_fields(&adv_fields, adv_data, &adv_len, sizeof(adv_data));
+    if (rc == 0) {
+        rc = ble_hs_adv_set_fields(&rsp_fields, rsp_data, &rsp_len, sizeof(rsp_data));
+    }
+    return rc;
+}
+
+#if CONFIG_BT_NIMBLE_EXT_ADV
+static struct os_mbuf *adv_mbuf(const uint8_t *data, uint8_t len, const uint8_t *more, uint8_t more_len)
+{
+    struct os_mbuf *om = os_msys_get_pkthdr(len + more_len, 0);
+
+    if (om && (os_mbuf_append(om, data, len) != 0 || os_mbuf_append(om, more, more_len) != 0)) {
+        os_mbuf_free_chain(om);
+        om = NULL;
+    }
+    return om;
+}
+
+/* Extended PDUs (legacy == false) or legacy ones through the extended API */
+static int adv_configure_set(bool legacy)
+{
+    struct ble_gap_ext_adv_params params;
+    struct os_mbuf *om;
+    int rc;
+
+    memset(&params, 0, sizeof params);
+    params.connectable = 1;
+    params.own_addr_type = BLE_OWN_ADDR_PUBLIC;
+    params.itvl_min = adv_itvl_min;
+    params.itvl_max = adv_itvl_max;
+    params.tx_power = 127; /* no preference */
+    params.sid = HID_ADV_INSTANCE;
+    if (legacy) {
+        params.legacy_pdu = 1;
+        params.scannable = 1;
+        params.primary_phy = BLE_HCI_LE_PHY_1M;
+        params.secondary_phy = BLE_HCI_LE_PHY_1M;
+    } else {
+#if CONFIG_EXAMPLE_EXT_ADV_CODED
+        params.primary_phy = BLE_HCI_LE_PHY_CODED;
+        params.secondary_phy = BLE_HCI_LE_PHY_CODED;
+#else
+        params.primary_phy = BLE_HCI_LE_PHY_1M;
+        params.secondary_phy = BLE_HCI_LE_PHY_2M;
+#endif
+    }
+
+    rc = ble_gap_ext_adv_configure(HID_ADV_INSTANCE, &params, NULL, nimble_hid_gap_event, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+    if (!legacy) {
+        /* Connectable extended advertising has no scan response: send it all */
+        om = adv_mbuf(adv_data, adv_len, rsp_data, rsp_len);
+        return om ? ble_gap_ext_adv_set_data(HID_ADV_INSTANCE, om) : BLE_HS_ENOMEM;
+    }
+    om = adv_mbuf(adv_data, adv_len, NULL, 0);
+    rc = om ? ble_gap_ext_adv_set_data(HID_ADV_INSTANCE, om) : BLE_HS_ENOMEM;
+    if (rc == 0) {
+        om = adv_mbuf(rsp_data, rsp_len, NULL, 0);
+        rc = om ? ble_gap_ext_adv_rsp_set_data(HID_ADV_INSTANCE, om) : BLE_HS_ENOMEM;
+    }
+    return rc;
+}
+#endif /* CONFIG_BT_NIMBLE_EXT_ADV */
+
+static int adv_configure(void)
+{
+    int rc = adv_encode();
+    if (rc != 0) {
+        return rc;
+    }
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    /* A running instance cannot be reconfigured */
+    if (ble_gap_ext_adv_active(HID_ADV_INSTANCE)) {
+        ble_gap_ext_adv_stop(HID_ADV_INSTANCE);
+    }
+#if CONFIG_EXAMPLE_EXT_ADV
+    rc = adv_configure_set(false);
+    if (rc == 0) {
+        ESP_LOGI(TAG, "Extended advertising, %d bytes", adv_len + rsp_len);
+        return 0;
+    }
+    ESP_LOGW(TAG, "Extended advertising refused (rc=%d), using legacy PDUs", rc);
+    ble_gap_ext_adv_remove(HID_ADV_INSTANCE);
+#endif
+    return adv_configure_set(true);
+#else
+    rc = ble_gap_adv_set_data(adv_data, adv_len);
+    if (rc == 0) {
+        rc = ble_gap_adv_rsp_set_data(rsp_data, rsp_len);
+    }
+    return rc;
+#endif
+}
+
 static int
 nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
 {
@@ -814,6 +950,18 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
         ESP_LOGI(TAG, "connection %s; status=%d",
                 event->connect.status == 0 ? "established" : "failed",
                 event->connect.status);
+        if (event->connect.status == 0) {
+            link_timing.conn_handle = event->connect.conn_handle;
+            link_timing.connect_us = esp_timer_get_time();
+            link_timing.enc_ms = -1;
+            link_timing.pending = true;
+            if (conn_params.itvl_min) {
+                rc = ble_gap_update_params(event->connect.conn_handle, &conn_params);
+                if (rc != 0) {
+                    ESP_LOGW(TAG, "connection parameter request failed; rc=%d", rc);
+                }
+            }
+        }
         return 0;
         break;
     case BLE_GAP_EVENT_DISCONNECT:
@@ -841,6 +989,13 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
                 event->subscribe.cur_notify,
                 event->subscribe.prev_indicate,
                 event->subscribe.cur_indicate);
+        if (link_timing.pending && event->subscribe.conn_handle == link_timing.conn_handle &&
+                event->subscribe.cur_notify) {
+            link_timing.pending = false;
+            ESP_LOGI(TAG, "reports flow %d ms after connect (encrypted at %d ms, subscription %s)",
+                     (int)((esp_timer_get_time() - link_timing.connect_us) / 1000), (int)link_timing.enc_ms,
+                     event->subscribe.reason == BLE_GAP_SUBSCRIBE_REASON_RESTORE ? "restored" : "written");
+        }
         return 0;
 
     case BLE_GAP_EVENT_MTU:
@@ -856,7 +1011,9 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
                 event->enc_change.status);
         rc = ble_gap_conn_find(event->enc_change.conn_handle, &desc);
         assert(rc == 0);
-        ble_hid_task_start_up();
+        if (event->enc_change.conn_handle == link_timing.conn_handle) {
+            link_timing.enc_ms = (esp_timer_get_time() - link_timing.connect_us) / 1000;
+        }
         return 0;
 
     case BLE_GAP_EVENT_NOTIFY_TX:
@@ -891,7 +1048,7 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
 
         if (event->passkey.params.action == BLE_SM_IOACT_DISP) {
             pkey.action = event->passkey.params.action;
-            pkey.passkey = 123456; // This is the passkey to be entered on peer
+            pkey.passkey = sm_passkey; // This is the passkey to be entered on peer
             ESP_LOGI(TAG, "Enter passkey %" PRIu32 "on the peer side", pkey.passkey);
             rc = ble_sm_inject_io(event->passkey.conn_handle, &pkey);
             ESP_LOGI(TAG, "ble_sm_inject_io result: %d", rc);
@@ -910,9 +1067,9 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
             rc = ble_sm_inject_io(event->passkey.conn_handle, &pkey);
             ESP_LOGI(TAG, "ble_sm_inject_io result: %d", rc);
         } else if (event->passkey.params.action == BLE_SM_IOACT_INPUT) {
-            ESP_LOGI(TAG, "Input not supported passing -> 123456");
+            ESP_LOGI(TAG, "Input not supported passing -> %06" PRIu32, sm_passkey);
             pkey.action = event->passkey.params.action;
-            pkey.passkey = 123456;
+            pkey.passkey = sm_passkey;
             rc = ble_sm_inject_io(event->passkey.conn_handle, &pkey);
             ESP_LOGI(TAG, "ble_sm_inject_io result: %d", rc);
         }
@@ -923,28 +1080,70 @@ nimble_hid_gap_event(struct ble_gap_event *event, void *arg)
 esp_err_t esp_hid_ble_gap_adv_start(void)
 {
     int rc;
-    struct ble_gap_adv_params adv_params;
-    /* maximum possible duration for hid device(180s) */
-    int32_t adv_duration_ms = 180000;
 
-    rc = ble_gap_adv_set_fields(&fields);
-    if (rc != 0) {
-        MODLOG_DFLT(ERROR, "error setting advertisement data; rc=%d\n", rc);
-        return rc;
+    if (!adv_configured) {
+        rc = adv_configure();
+        if (rc != 0) {
+            MODLOG_DFLT(ERROR, "error setting advertisement data; rc=%d\n", rc);
+            return rc;
+        }
+        adv_configured = true;
     }
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    rc = ble_gap_ext_adv_start(HID_ADV_INSTANCE,
+                               adv_duration_ms == BLE_HS_FOREVER ? 0 : adv_duration_ms / 10, 0);
+#else
+    struct ble_gap_adv_params adv_params;
+
     /* Begin advertising. */
     memset(&adv_params, 0, sizeof adv_params);
     adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
     adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    adv_params.itvl_min = BLE_GAP_ADV_ITVL_MS(30);/* Recommended interval 30ms to 50ms */
-    adv_params.itvl_max = BLE_GAP_ADV_ITVL_MS(50);
+    adv_params.itvl_min = adv_itvl_min;
+    adv_params.itvl_max = adv_itvl_max;
     rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, adv_duration_ms,
                            &adv_params, nimble_hid_gap_event, NULL);
-    if (rc != 0) {
+#endif
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
         MODLOG_DFLT(ERROR, "error enabling advertisement; rc=%d\n", rc);
         return rc;
     }
-    return rc;
+    return 0;
+}
+
+void esp_hid_ble_gap_set_passkey(uint32_t passkey)
+{
+    sm_passkey = passkey;
+}
+
+void esp_hid_ble_gap_set_adv_params(uint16_t itvl_min_ms, uint16_t itvl_max_ms, uint32_t duration_ms)
+{
+    adv_itvl_min = BLE_GAP_ADV_ITVL_MS(itvl_min_ms);
+    adv_itvl_max = BLE_GAP_ADV_ITVL_MS(itvl_max_ms);
+    adv_duration_ms = duration_ms ? (int32_t)duration_ms : BLE_HS_FOREVER;
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    /* Intervals are part of the extended instance configuration */
+    adv_configured = false;
+#endif
+}
+
+void esp_hid_ble_gap_set_adv_uuid128(const uint8_t uuid[16])
+{
+    rsp_uuid128.u.type = BLE_UUID_TYPE_128;
+    memcpy(rsp_uuid128.value, uuid, sizeof rsp_uuid128.value);
+    rsp_uuid128_set = true;
+}
+
+void esp_hid_ble_gap_set_conn_params(uint16_t itvl_min, uint16_t itvl_max, uint16_t latency, uint16_t timeout)
+{
+    memset(&conn_params, 0, sizeof conn_params);
+    if (itvl_min == 0) {
+        return;
+    }
+    conn_params.itvl_min = itvl_min;
+    conn_params.itvl_max = itvl_max;
+    conn_params.latency = latency;
+    conn_params.supervision_timeout = timeout;
 }
 #endif
 
@@ -1097,44 +1296,70 @@ esp_err_t esp_hid_gap_init(uint8_t mode)
 }
 
 #if !CONFIG_BT_NIMBLE_ENABLED
-esp_err_t esp_hid_scan(uint32_t seconds, size_t *num_results, esp_hid_scan_result_t **results)
+bool esp_hid_scan_match_name(const esp_hid_scan_result_t *result, void *name_prefix)
+{
+    const char *prefix = (const char *)name_prefix;
+    return result->name && strncmp(result->name, prefix, strlen(prefix)) == 0;
+}
+
+esp_err_t esp_hid_scan_until(uint32_t seconds, esp_hid_scan_match_t match, void *arg,
+                             size_t *num_results, esp_hid_scan_result_t **results)
 {
-    if (num_bt_scan_results || bt_scan_results || num_ble_scan_results || ble_scan_results) {
+    bool ble_started = false;
+    bool bt_started = false;
+    TickType_t start = xTaskGetTickCount();
+
+    if (hid_scan_store_count()) {
         ESP_LOGE(TAG, "There are old scan results. Free them first!");
         return ESP_FAIL;
     }
+    esp_hid_scan_results_free(NULL);
+    scan_match = match;
+    scan_match_arg = arg;
+    scan_matched = false;
 
+    // Both discoveries share the window; results are merged as they arrive
 #if CONFIG_BT_BLE_ENABLED
-    if (start_ble_scan(seconds) == ESP_OK) {
-        WAIT_BLE_CB();
-    } else {
+    if (start_ble_scan(seconds) != ESP_OK) {
         return ESP_FAIL;
     }
+    ble_started = true;
 #endif /* CONFIG_BT_BLE_ENABLED */
 
 #if CONFIG_BT_HID_DEVICE_ENABLED
-    if (start_bt_scan(seconds) == ESP_OK) {
-        WAIT_BT_CB();
-    } else {
+    bt_started = start_bt_scan(seconds) == ESP_OK;
+    if (!bt_started) {
+        stop_scans();
+        if (ble_started) {
+            WAIT_BLE_CB();
+        }
+        esp_hid_scan_results_free(NULL);
         return ESP_FAIL;
     }
 #endif
 
-    *num_results = num_bt_scan_results + num_ble_scan_results;
-    *results = bt_scan_results;
-    if (num_bt_scan_results) {
-        while (bt_scan_results->next != NULL) {
-            bt_scan_results = bt_scan_results->next;
-        }
-        bt_scan_results->next = ble_scan_results;
-    } else {
-        *results = ble_scan_results;
+    if (ble_started) {
+        WAIT_BLE_CB();
     }
-
-    num_bt_scan_results = 0;
-    bt_scan_results = NULL;
-    num_ble_scan_results = 0;
-    ble_scan_results = NULL;
+    if (bt_started) {
+        WAIT_BT_CB();
+    }
+    hid_scan_stats_t stats;
+    hid_scan_store_get_stats(&stats);
+    ESP_LOGI(TAG, "Scan done in %" PRIu32 " ms, %u results%s", (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount() - start),
+             (unsigned)hid_scan_store_count(), scan_matched ? " (stopped at match)" : "");
+    ESP_LOGD(TAG, "reports=%" PRIu32 " evicted=%" PRIu32 " names dropped=%" PRIu32, stats.reports,
+             stats.evicted, stats.names_dropped);
+
+    // The results stay owned by the store until freed
+    *results = hid_scan_store_results();
+    *num_results = hid_scan_store_count();
+    scan_match = NULL;
     return ESP_OK;
 }
+
+esp_err_t esp_hid_scan(uint32_t seconds, size_t *num_results, esp_hid_scan_result_t **results)
+{
+    return esp_hid_scan_until(seconds, NULL, NULL, num_results, results);
+}
 #endif
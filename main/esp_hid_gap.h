@@ -67,7 +67,18 @@ typedef struct esp_hidh_scan_result_s {
     };
 } esp_hid_scan_result_t;
 
+/* Called on the BTC task for every new or updated result (result is only
+ * valid during the call); returns true when it is the device looked for */
+typedef bool (*esp_hid_scan_match_t)(const esp_hid_scan_result_t *result, void *arg);
+
+/* Runs BLE and BR/EDR discovery side by side for up to seconds */
 esp_err_t esp_hid_scan(uint32_t seconds, size_t *num_results, esp_hid_scan_result_t **results);
+/* Same, but stops both as soon as match accepts a result (match may be NULL) */
+esp_err_t esp_hid_scan_until(uint32_t seconds, esp_hid_scan_match_t match, void *arg,
+                             size_t *num_results, esp_hid_scan_result_t **results);
+/* Match helper: arg is a name prefix (const char *) */
+bool esp_hid_scan_match_name(const esp_hid_scan_result_t *result, void *name_prefix);
+/* Releases all results of the last scan at once; required before the next */
 void esp_hid_scan_results_free(esp_hid_scan_result_t *results);
 const char *ble_addr_type_str(esp_ble_addr_type_t ble_addr_type);
 void print_uuid(esp_bt_uuid_t *uuid);
@@ -78,6 +89,19 @@ esp_err_t esp_hid_gap_init(uint8_t mode);
 esp_err_t esp_hid_ble_gap_adv_init(uint16_t appearance, const char *device_name);
 esp_err_t esp_hid_ble_gap_adv_start(void);
 
+#if CONFIG_BT_NIMBLE_ENABLED
+/* Runtime settings; they apply from the next pairing, advertising start or
+ * connection. Interval units are ms for advertising, 1.25 ms for the
+ * connection (timeout: 10 ms); duration 0 advertises until connected and
+ * itvl_min 0 leaves the connection parameters to the central. */
+void esp_hid_ble_gap_set_passkey(uint32_t passkey);
+void esp_hid_ble_gap_set_adv_params(uint16_t itvl_min_ms, uint16_t itvl_max_ms, uint32_t duration_ms);
+/* Service UUID (little endian, as in NimBLE) for the scan response; takes
+ * effect at the next esp_hid_ble_gap_adv_init */
+void esp_hid_ble_gap_set_adv_uuid128(const uint8_t uuid[16]);
+void esp_hid_ble_gap_set_conn_params(uint16_t itvl_min, uint16_t itvl_max, uint16_t latency, uint16_t timeout);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
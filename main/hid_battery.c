@@ -0,0 +1,188 @@
+/*  Battery Service level updates
+ */
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_EXAMPLE_BATTERY_ADC
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+#include "hid_battery.h"
+#include "hid_output.h"
+
+static const char *TAG = "HID_BAT";
+
+#define SAMPLES_PER_READING 8
+#define IDLE_AFTER_US (2 * 60 * 1000000LL) // no report for this long counts as idle
+
+static esp_hidd_dev_t *s_dev;
+static hid_battery_source_t s_src;
+static hid_battery_filter_t s_filter;
+static esp_timer_handle_t s_timer;
+static int64_t s_last_active_us;
+static uint32_t s_last_reports;
+static uint32_t s_readings;
+static uint32_t s_notifications;
+
+/* ───────────────────────── ADC Source ────────────────────────────── */
+#if CONFIG_EXAMPLE_BATTERY_ADC
+static adc_oneshot_unit_handle_t s_adc;
+static adc_cali_handle_t s_cali;
+
+static bool adc_read_mv(void *ctx, uint32_t *mv)
+{
+    int raw, v;
+
+    if (adc_oneshot_read(s_adc, CONFIG_EXAMPLE_BATTERY_ADC_CHANNEL, &raw) != ESP_OK)
+    {
+        return false;
+    }
+    if (!s_cali || adc_cali_raw_to_voltage(s_cali, raw, &v) != ESP_OK)
+    {
+        v = raw * 3100 / 4095; // uncalibrated, full scale at 12 dB
+    }
+    // Undo the external divider feeding the pin
+    *mv = (uint32_t)v * CONFIG_EXAMPLE_BATTERY_DIVIDER_X100 / 100;
+    return true;
+}
+
+static esp_err_t adc_source_init(hid_battery_source_t *src)
+{
+    adc_oneshot_unit_init_cfg_t unit_cfg = {.unit_id = ADC_UNIT_1};
+    adc_oneshot_chan_cfg_t chan_cfg = {.atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_DEFAULT};
+
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &s_adc);
+    if (err == ESP_OK)
+    {
+        err = adc_oneshot_config_channel(s_adc, CONFIG_EXAMPLE_BATTERY_ADC_CHANNEL, &chan_cfg);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ADC init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_cfg = {
+        .unit_id = ADC_UNIT_1,
+        .chan = CONFIG_EXAMPLE_BATTERY_ADC_CHANNEL,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &s_cali) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "ADC calibration unavailable, using raw readings");
+        s_cali = NULL;
+    }
+#endif
+
+    src->read_mv = adc_read_mv;
+    src->ctx = NULL;
+    return ESP_OK;
+}
+#endif
+
+/* ───────────────────────── Sampling ────────────────────────────── */
+/* Idle means no HID report went out since the last reading for a while */
+static uint64_t next_interval_us(int64_t now)
+{
+    uint32_t reports = 0;
+
+    for (int id = 1; id <= HID_RPT_ID_MAX; id++)
+    {
+        hid_dedup_stats_t d;
+        hid_output_get_dedup_stats(id, &d);
+        reports += d.sent;
+    }
+    if (reports != s_last_reports)
+    {
+        s_last_reports = reports;
+        s_last_active_us = now;
+    }
+    if (now - s_last_active_us < IDLE_AFTER_US)
+    {
+        return CONFIG_EXAMPLE_BATTERY_ACTIVE_INTERVAL_S * 1000000ULL;
+    }
+    return CONFIG_EXAMPLE_BATTERY_IDLE_INTERVAL_S * 1000000ULL;
+}
+
+static void battery_timer_cb(void *arg)
+{
+    uint32_t sum = 0, mv;
+    int n = 0;
+    uint8_t level;
+
+    for (int i = 0; i < SAMPLES_PER_READING; i++)
+    {
+        if (s_src.read_mv(s_src.ctx, &mv))
+        {
+            sum += mv;
+            n++;
+        }
+    }
+    if (n)
+    {
+        s_readings++;
+        if (hid_battery_filter_update(&s_filter, sum / n, &level))
+        {
+            s_notifications++;
+            esp_hidd_dev_battery_set(s_dev, level);
+        }
+    }
+    esp_timer_start_once(s_timer, next_interval_us(esp_timer_get_time()));
+}
+
+/* ───────────────────────── API ────────────────────────────── */
+esp_err_t hid_battery_init(esp_hidd_dev_t *dev, const hid_battery_source_t *src)
+{
+    if (s_timer)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_OK;
+
+    if (src)
+    {
+        s_src = *src;
+    }
+    else
+    {
+#if CONFIG_EXAMPLE_BATTERY_ADC
+        err = adc_source_init(&s_src);
+#else
+        err = ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    s_dev = dev;
+    hid_battery_filter_init(&s_filter, CONFIG_EXAMPLE_BATTERY_HYSTERESIS);
+
+    esp_timer_create_args_t args = {
+        .callback = battery_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "battery",
+        .skip_unhandled_events = true,
+    };
+    err = esp_timer_create(&args, &s_timer);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    // First reading right away so the host never sees a stale level
+    return esp_timer_start_once(s_timer, 0);
+}
+
+void hid_battery_log_stats(void)
+{
+    if (s_timer)
+    {
+        ESP_LOGI(TAG, "battery level=%u%% readings=%" PRIu32 " notifications=%" PRIu32,
+                 s_filter.level, s_readings, s_notifications);
+    }
+}
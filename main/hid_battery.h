@@ -0,0 +1,30 @@
+/*  Battery Service level updates
+ *
+ *  Sampling is driven by a one-shot esp_timer, so no task is woken between
+ *  readings. While reports are flowing the battery is read every
+ *  EXAMPLE_BATTERY_ACTIVE_INTERVAL_S; when the device sits idle the interval
+ *  stretches to EXAMPLE_BATTERY_IDLE_INTERVAL_S. The host is only notified
+ *  when the level moves by the configured hysteresis (hid_battery_filter.h).
+ */
+#ifndef _HID_BATTERY_H_
+#define _HID_BATTERY_H_
+
+#include "esp_err.h"
+#include "esp_hidd.h"
+#include "hid_battery_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Starts monitoring. With src NULL the ADC source from Kconfig is used;
+ * ESP_ERR_NOT_SUPPORTED when it is disabled. */
+esp_err_t hid_battery_init(esp_hidd_dev_t *dev, const hid_battery_source_t *src);
+
+void hid_battery_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_BATTERY_H_ */
@@ -0,0 +1,68 @@
+/*  Battery level filtering
+ */
+#include <stdlib.h>
+
+#include "hid_battery_filter.h"
+
+#define EMA_SHIFT 2 // each reading moves the average by 1/4
+
+// Resting voltage of a 1S Li-ion cell against remaining charge
+static const struct
+{
+    uint16_t mv;
+    uint8_t percent;
+} s_curve[] = {
+    {4200, 100}, {4100, 90}, {4000, 80}, {3900, 65}, {3800, 50}, {3750, 40},
+    {3700, 30},  {3650, 20}, {3600, 10}, {3500, 5},  {3300, 0},
+};
+
+uint8_t hid_battery_mv_to_percent(uint32_t mv)
+{
+    const int n = sizeof(s_curve) / sizeof(s_curve[0]);
+
+    if (mv >= s_curve[0].mv)
+    {
+        return 100;
+    }
+    for (int i = 1; i < n; i++)
+    {
+        if (mv >= s_curve[i].mv)
+        {
+            uint32_t span_mv = s_curve[i - 1].mv - s_curve[i].mv;
+            uint32_t span_pct = s_curve[i - 1].percent - s_curve[i].percent;
+            return s_curve[i].percent + (mv - s_curve[i].mv) * span_pct / span_mv;
+        }
+    }
+    return 0;
+}
+
+void hid_battery_filter_init(hid_battery_filter_t *f, uint8_t hysteresis)
+{
+    *f = (hid_battery_filter_t){.hysteresis = hysteresis};
+}
+
+bool hid_battery_filter_update(hid_battery_filter_t *f, uint32_t mv, uint8_t *level)
+{
+    if (!f->primed)
+    {
+        f->primed = true;
+        f->mv_q4 = mv << 4;
+    }
+    else
+    {
+        int32_t diff = (int32_t)(mv << 4) - (int32_t)f->mv_q4;
+        f->mv_q4 += diff / (1 << EMA_SHIFT);
+    }
+
+    uint8_t percent = hid_battery_mv_to_percent((f->mv_q4 + 8) >> 4);
+    // The end points are always reported, or a full or empty cell might never show
+    bool edge = (percent == 0 || percent == 100) && percent != f->level;
+    if (f->published && !edge && abs(percent - f->level) < f->hysteresis)
+    {
+        return false;
+    }
+    f->published = true;
+    f->level = percent;
+    *level = percent;
+    return true;
+}
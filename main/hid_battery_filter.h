@@ -0,0 +1,47 @@
+/*  Battery level filtering
+ *
+ *  Turns voltage readings into the percentage reported by the Battery
+ *  Service. Readings are smoothed with an exponential moving average and a
+ *  new level is only published once it moved by the hysteresis, so ADC noise
+ *  does not turn into a stream of notifications. Plain C with no ESP-IDF
+ *  dependency: a synthetic hid_battery_source_t can drive it on the host.
+ */
+#ifndef _HID_BATTERY_FILTER_H_
+#define _HID_BATTERY_FILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Where battery voltage readings come from */
+typedef struct
+{
+    bool (*read_mv)(void *ctx, uint32_t *mv); // false when the reading failed
+    void *ctx;
+} hid_battery_source_t;
+
+typedef struct
+{
+    uint8_t hysteresis; // percent
+    bool primed;        // a first reading has been taken
+    bool published;     // level holds a value the host has seen
+    uint8_t level;      // last published percentage
+    uint32_t mv_q4;     // smoothed voltage, mV * 16
+} hid_battery_filter_t;
+
+void hid_battery_filter_init(hid_battery_filter_t *f, uint8_t hysteresis);
+
+/* Feeds one (already averaged) reading; true when *level should be published */
+bool hid_battery_filter_update(hid_battery_filter_t *f, uint32_t mv, uint8_t *level);
+
+/* Single-cell Li-ion/LiPo discharge curve, 0..100 */
+uint8_t hid_battery_mv_to_percent(uint32_t mv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_BATTERY_FILTER_H_ */
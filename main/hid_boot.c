@@ -0,0 +1,67 @@
+/*  Boot phase timestamps
+ */
+#include <inttypes.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "hid_boot.h"
+#include "hid_proto.h"
+
+static const char *TAG = "HID_BOOT";
+
+_Static_assert(HID_BOOT_PHASE_MAX == HID_STATS_PHASES, "stats characteristic layout");
+
+static const char *const s_names[HID_BOOT_PHASE_MAX] = {
+    "app_main", "nvs", "controller", "services", "host start", "host sync", "advertising", "connected", "deferred",
+};
+
+// 0 = not reached; written once per phase, read by the stats callback
+static volatile uint32_t s_at_us[HID_BOOT_PHASE_MAX];
+
+void hid_boot_mark(hid_boot_phase_t phase)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    if (phase >= HID_BOOT_PHASE_MAX || s_at_us[phase])
+    {
+        return;
+    }
+    s_at_us[phase] = now ? now : 1;
+
+    // Step from the latest phase before this one that was reached
+    uint32_t prev = 0;
+    for (int i = phase - 1; i >= 0 && !prev; i--)
+    {
+        prev = s_at_us[i];
+    }
+    ESP_LOGI(TAG, "%-11s %6" PRIu32 " ms (+%" PRIu32 " ms)", s_names[phase], now / 1000,
+             prev ? (now - prev) / 1000 : now / 1000);
+}
+
+size_t hid_boot_encode(uint8_t *buf, size_t len)
+{
+    if (len < HID_STATS_LEN)
+    {
+        return 0;
+    }
+    buf[0] = HID_BOOT_PHASE_MAX;
+    for (int i = 0; i < HID_BOOT_PHASE_MAX; i++)
+    {
+        uint32_t t = s_at_us[i] ? s_at_us[i] : HID_STATS_NOT_REACHED;
+        memcpy(buf + 1 + i * sizeof(t), &t, sizeof(t));
+    }
+    return HID_STATS_LEN;
+}
+
+void hid_boot_log(void)
+{
+    for (int i = 0; i < HID_BOOT_PHASE_MAX; i++)
+    {
+        if (s_at_us[i])
+        {
+            ESP_LOGI(TAG, "%-11s %6" PRIu32 " ms", s_names[i], s_at_us[i] / 1000);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/*  Boot phase timestamps
+ *
+ *  app_main and the BLE callbacks mark each phase the first time it is
+ *  reached, in microseconds since reset (esp_timer). The profile is logged as
+ *  it builds up, again with 'stats', and can be read from the stats
+ *  characteristic (hid_proto.h), so the time until a bonded host can
+ *  reconnect after a power cycle is measured on every boot.
+ */
+#ifndef _HID_BOOT_H_
+#define _HID_BOOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    HID_BOOT_APP_MAIN,    // app_main entered
+    HID_BOOT_NVS,         // NVS ready
+    HID_BOOT_CONTROLLER,  // controller enabled, NimBLE port up
+    HID_BOOT_SERVICES,    // GATT services registered
+    HID_BOOT_HOST_START,  // host task started
+    HID_BOOT_HOST_SYNC,   // host synced with the controller
+    HID_BOOT_ADVERTISING, // first advertising enabled
+    HID_BOOT_CONNECTED,   // first connection
+    HID_BOOT_DEFERRED,    // lazy init after the first connection done
+    HID_BOOT_PHASE_MAX
+} hid_boot_phase_t;
+
+/* Records the phase unless it was reached before; safe from any task */
+void hid_boot_mark(hid_boot_phase_t phase);
+
+/* Stats characteristic value; returns the bytes written */
+size_t hid_boot_encode(uint8_t *buf, size_t len);
+
+void hid_boot_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_BOOT_H_ */
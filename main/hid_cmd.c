@@ -0,0 +1,681 @@
+/*  Command decoding for the custom GATT write characteristic
+ *
+ *  Writes are copied into a message buffer by the NimBLE host task and parsed
+ *  by a task on HID_TASK_CORE, which turns them into jobs on the HID output
+ *  lanes; nothing here waits for a report to be sent.
+ */
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/message_buffer.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "hid_battery.h"
+#include "hid_boot.h"
+#include "hid_cmd.h"
+#include "hid_config.h"
+#include "hid_keymap.h"
+#include "hid_l2cap.h"
+#include "hid_macro.h"
+#include "hid_output.h"
+#include "hid_proto.h"
+#include "hid_sched.h"
+#include "hid_sysmon.h"
+#include "hid_unicode.h"
+
+static const char *TAG = "HID_CMD";
+
+#define CMD_MAX_LEN 256
+#define CMD_QUEUE_SIZE 2048 // several full-MTU writes, each with a 4-byte length header
+#define CMD_TASK_STACK_SIZE 4096
+#define BURST_GAP_US 1000000 // a pause this long starts a new throughput burst
+
+typedef struct
+{
+    uint32_t writes;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t burst_bytes;
+    int64_t burst_start_us;
+    int64_t last_us;
+} src_stats_t;
+
+static MessageBufferHandle_t s_cmd_buf;
+static StaticMessageBuffer_t s_cmd_buf_ctl;
+static uint8_t s_cmd_buf_storage[CMD_QUEUE_SIZE + 1];
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[CMD_TASK_STACK_SIZE];
+static src_stats_t s_src_stats[HID_CMD_SRC_MAX];
+// A message buffer allows one writer at a time: the host task and the scheduler
+static SemaphoreHandle_t s_submit_lock;
+static StaticSemaphore_t s_submit_lock_buf;
+// A text chunk was dropped: the rest of that text is discarded up to the next
+// start, by the submitter (guarded by s_submit_lock) or by the command task
+static bool s_submit_text_cut;
+static bool s_text_cut;
+
+/* ───────────────────────── Text Commands ────────────────────────────── */
+/* A write is a command only when it is a keyword alone, or a keyword, a space
+ * and arguments its handler accepts; handlers return false, having done
+ * nothing, for anything else, and the write is typed as text instead.
+ * PythonClient/hid_proto.py is_command() applies the same rules. */
+
+/* The arguments when buffer is keyword, a space and more; NULL otherwise */
+static char *cmd_args(char *buffer, const char *keyword)
+{
+    size_t n = strlen(keyword);
+
+    if (strncmp(buffer, keyword, n) != 0 || buffer[n] != ' ' || buffer[n + 1] == '\0')
+    {
+        return NULL;
+    }
+    return buffer + n + 1;
+}
+
+/* Reads up to max integers separated by blanks; returns how many were found,
+ * or -1 when anything else follows them */
+static int parse_ints(const char *s, long *out, int max)
+{
+    int n = 0;
+    char *end;
+
+    while (n < max)
+    {
+        long v = strtol(s, &end, 10);
+        if (end == s)
+        {
+            break;
+        }
+        out[n++] = v;
+        s = end;
+    }
+    while (*s == ' ')
+    {
+        s++;
+    }
+    return *s == '\0' ? n : -1;
+}
+
+/* moveto <dx> <dy> <ms>
+ * path|drag <ms> <x1> <y1> [<x2> <y2> ...]
+ * bezier <ms> <cx1> <cy1> <cx2> <cy2> <x> <y>
+ * Points are relative to the cursor position when the motion starts and fit
+ * in int16; ms is at most HID_MOTION_MAX_DURATION_MS. */
+static bool handle_motion(const char *args, hid_motion_kind_t kind, uint8_t buttons, bool duration_last)
+{
+    long v[1 + 2 * HID_MOTION_MAX_POINTS];
+    int n = parse_ints(args, v, sizeof(v) / sizeof(v[0]));
+    hid_motion_path_t path = {.kind = kind, .buttons = buttons};
+
+    if (n < 3 || (n - 1) % 2 != 0 || (duration_last && n != 3) || (kind == HID_MOTION_BEZIER && n != 7))
+    {
+        return false;
+    }
+
+    long *pts = v + 1;
+    long duration = v[0];
+    if (duration_last)
+    {
+        // moveto keeps the natural "dx dy ms" order
+        duration = v[2];
+        pts = v;
+    }
+    if (duration < 0 || duration > HID_MOTION_MAX_DURATION_MS)
+    {
+        return false;
+    }
+    path.duration_ms = duration;
+    path.npoints = (n - 1) / 2;
+    for (int i = 0; i < 2 * path.npoints; i++)
+    {
+        if (pts[i] < INT16_MIN || pts[i] > INT16_MAX)
+        {
+            return false;
+        }
+        path.pts[i / 2][i % 2] = (int16_t)pts[i];
+    }
+    hid_output_motion(&path);
+    return true;
+}
+
+/* move <dx> <dy> */
+static bool handle_move(const char *args)
+{
+    long v[2];
+
+    if (parse_ints(args, v, 2) != 2)
+    {
+        return false;
+    }
+    hid_output_mouse((int8_t)v[0], (int8_t)v[1], 0);
+    return true;
+}
+
+/* at <ms> <command>: ms on the synced client clock (Unix time), or +ms from now */
+static bool handle_at(const char *args)
+{
+    bool relative = *args == '+';
+    char *end;
+    long long ms;
+
+    if (!isdigit((unsigned char)args[relative]))
+    {
+        return false;
+    }
+    ms = strtoll(args + relative, &end, 10);
+    if (*end != ' ' || ms > INT64_MAX / 1000)
+    {
+        return false;
+    }
+    while (*end == ' ')
+    {
+        end++;
+    }
+    if (*end == '\0')
+    {
+        return false;
+    }
+    if (hid_sched_at(ms * 1000, relative, end, strlen(end)) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "'at' command rejected");
+    }
+    return true;
+}
+
+static const struct
+{
+    const char *name;
+    uint16_t usage;
+} s_media_names[] = {
+    {"volup", VOLUME_UP},
+    {"voldown", VOLUME_DOWN},
+    {"mute", MUTE},
+    {"play", PLAY_PAUSE},
+    {"next", SCAN_NEXT},
+    {"prev", SCAN_PREVIOUS},
+    {"stop", STOP},
+};
+
+/* media <key> [<key> ...]: names above or hex usages, sent as one batch */
+static bool handle_media(const char *args)
+{
+    uint16_t usages[HID_CONSUMER_BATCH_MAX];
+    size_t n = 0;
+
+    while (*args)
+    {
+        size_t tok_len = strcspn(args, " ");
+        char *end;
+        unsigned long usage;
+
+        if (tok_len == 0)
+        {
+            args++;
+            continue;
+        }
+        if (n == HID_CONSUMER_BATCH_MAX)
+        {
+            return false;
+        }
+        usage = strtoul(args, &end, 16);
+        if (end != args + tok_len)
+        {
+            usage = 0;
+        }
+        for (size_t i = 0; i < sizeof(s_media_names) / sizeof(s_media_names[0]); i++)
+        {
+            if (strlen(s_media_names[i].name) == tok_len && strncmp(args, s_media_names[i].name, tok_len) == 0)
+            {
+                usage = s_media_names[i].usage;
+            }
+        }
+        if (usage == 0 || usage > 0x3FF)
+        {
+            return false;
+        }
+        usages[n++] = usage;
+        args += tok_len;
+    }
+    if (n == 0)
+    {
+        return false;
+    }
+    if (hid_output_consumer_batch(usages, n) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "'media' command rejected");
+    }
+    return true;
+}
+
+/* chord <mod> [<key> ...]: hex usages pressed together */
+static bool handle_chord(const char *args)
+{
+    uint8_t keys[HID_KEY_CHORD_MAX];
+    size_t n = 0;
+    char *end;
+    unsigned long mod = strtoul(args, &end, 16);
+
+    if (end == args || mod > 0xFF)
+    {
+        return false;
+    }
+    for (const char *p = end; n < HID_KEY_CHORD_MAX; p = end)
+    {
+        unsigned long key = strtoul(p, &end, 16);
+        if (end == p)
+        {
+            break;
+        }
+        keys[n++] = (uint8_t)key;
+    }
+    while (*end == ' ')
+    {
+        end++;
+    }
+    if (*end != '\0')
+    {
+        return false;
+    }
+    hid_output_key_chord((uint8_t)mod, keys, n);
+    return true;
+}
+
+/* ───────────────────────── Binary Frames ────────────────────────────── */
+static uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+static uint64_t get_le64(const uint8_t *p)
+{
+    return get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+static void handle_frame(uint8_t op, const uint8_t *payload, uint8_t len)
+{
+    switch (op)
+    {
+    case HID_OP_POS:
+        if (len < 4)
+        {
+            break;
+        }
+        if (hid_output_abs_pointer(get_le16(payload), get_le16(payload + 2),
+                                   len > 4 ? payload[4] : 0) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "POS rejected");
+        }
+        return;
+    case HID_OP_TIME_SYNC:
+        // Normally answered on the host task; this path only sees it via L2CAP
+        hid_sched_sync_request(payload, len, esp_timer_get_time());
+        return;
+    case HID_OP_CLOCK_SET:
+        if (len < 12)
+        {
+            break;
+        }
+        hid_sched_set_clock((int64_t)get_le64(payload), get_le32(payload + 8));
+        return;
+    case HID_OP_TEXT_Z:
+    {
+        esp_err_t err;
+
+        if (len < 1)
+        {
+            break;
+        }
+        if (payload[0] & HID_TEXT_Z_F_START)
+        {
+            s_text_cut = false;
+        }
+        if (s_text_cut)
+        {
+            return;
+        }
+        if (payload[0] & HID_TEXT_Z_F_STORED)
+        {
+            err = hid_output_text((const char *)payload + 1, len - 1);
+        }
+        else
+        {
+            err = hid_output_text_compressed(payload + 1, len - 1, payload[0] & HID_TEXT_Z_F_START);
+        }
+        if (err != ESP_OK)
+        {
+            // Decoding on after a gap would type garbage
+            ESP_LOGW(TAG, "Text chunk dropped, rest of the text discarded");
+            s_text_cut = true;
+        }
+        return;
+    }
+    case HID_OP_SCRIPT:
+        if (len < 1)
+        {
+            break;
+        }
+        hid_output_script(payload + 1, len - 1, payload[0] & HID_SCRIPT_F_START);
+        return;
+    case HID_OP_MACRO_STORE:
+        if (len < 2)
+        {
+            break;
+        }
+        hid_macro_store(payload[0], payload[1], payload + 2, len - 2);
+        return;
+    case HID_OP_MACRO_RUN:
+        if (len < 1)
+        {
+            break;
+        }
+        hid_macro_run(payload[0]);
+        return;
+    default:
+        ESP_LOGW(TAG, "Unknown opcode 0x%02x", op);
+        return;
+    }
+    ESP_LOGW(TAG, "Opcode 0x%02x: short payload (%u bytes)", op, len);
+}
+
+static void dispatch_frames(const uint8_t *data, size_t len)
+{
+    while (len >= HID_PROTO_FRAME_HDR_LEN && data[0] == HID_PROTO_FRAME_MARKER)
+    {
+        uint8_t op = data[1];
+        uint8_t plen = data[2];
+
+        if (len < (size_t)HID_PROTO_FRAME_HDR_LEN + plen)
+        {
+            ESP_LOGW(TAG, "Truncated frame (opcode 0x%02x)", op);
+            return;
+        }
+        handle_frame(op, data + HID_PROTO_FRAME_HDR_LEN, plen);
+        data += HID_PROTO_FRAME_HDR_LEN + plen;
+        len -= HID_PROTO_FRAME_HDR_LEN + plen;
+    }
+    if (len)
+    {
+        ESP_LOGW(TAG, "%u trailing bytes ignored", (unsigned)len);
+    }
+}
+
+/* ───────────────────────── Dispatch ────────────────────────────── */
+/* Runs buffer as a text command; false when it is none, see cmd_args() */
+static bool run_command(char *buffer)
+{
+    char *args;
+
+    if (strcmp(buffer, "volup") == 0)
+    {
+        hid_output_consumer(VOLUME_UP);
+    }
+    else if (strcmp(buffer, "voldown") == 0)
+    {
+        hid_output_consumer(VOLUME_DOWN);
+    }
+    else if (strcmp(buffer, "mute") == 0)
+    {
+        hid_output_consumer(MUTE);
+        hid_output_key_tap(KEY_MOD_NONE, KEY_ENTER); // Sends Enter key
+    }
+    else if (strcmp(buffer, "play") == 0)
+    {
+        hid_output_consumer(PLAY_PAUSE);
+    }
+    else if (strcmp(buffer, "next") == 0)
+    {
+        hid_output_consumer(SCAN_NEXT);
+    }
+    else if (strcmp(buffer, "prev") == 0)
+    {
+        hid_output_consumer(SCAN_PREVIOUS);
+    }
+    else if (strcmp(buffer, "stop") == 0)
+    {
+        hid_output_consumer(STOP);
+    }
+    else if (strcmp(buffer, "click") == 0)
+    {
+        hid_output_click(0x01); // Left click
+    }
+    else if (strcmp(buffer, "rightclick") == 0)
+    {
+        hid_output_click(0x02); // Right click
+    }
+    else if (strcmp(buffer, "abort") == 0)
+    {
+        hid_output_abort();
+    }
+    else if (strcmp(buffer, "stats") == 0)
+    {
+        hid_output_log_stats();
+        hid_cmd_log_stats();
+        hid_l2cap_log_stats();
+        hid_sched_log_stats();
+        hid_battery_log_stats();
+        hid_sysmon_log();
+        hid_boot_log();
+        hid_config_log_stats();
+        hid_macro_log_stats();
+    }
+    else if ((args = cmd_args(buffer, "unimode")))
+    {
+        hid_unicode_mode_t mode;
+        if (!hid_unicode_mode_from_str(args, &mode))
+        {
+            return false;
+        }
+        hid_unicode_set_mode(mode);
+    }
+    else if ((args = cmd_args(buffer, "kbdmode")))
+    {
+        bool nkro = strcmp(args, "nkro") == 0;
+        if (!nkro && strcmp(args, "6kro") != 0)
+        {
+            return false;
+        }
+        if (hid_output_set_nkro(nkro) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "'kbdmode' command rejected");
+        }
+    }
+    else if ((args = cmd_args(buffer, "macro")))
+    {
+        long slot;
+        if (!isdigit((unsigned char)args[0]) || parse_ints(args, &slot, 1) != 1 || slot >= HID_MACRO_SLOTS)
+        {
+            return false;
+        }
+        hid_macro_run((uint8_t)slot);
+    }
+    else if ((args = cmd_args(buffer, "pos")))
+    {
+        long v[2];
+        if (parse_ints(args, v, 2) != 2 || v[0] < 0 || v[0] > HID_ABS_POINTER_MAX || v[1] < 0 ||
+            v[1] > HID_ABS_POINTER_MAX)
+        {
+            return false;
+        }
+        if (hid_output_abs_pointer((uint16_t)v[0], (uint16_t)v[1], 0) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "'pos' command rejected");
+        }
+    }
+    else if ((args = cmd_args(buffer, "at")))
+    {
+        return handle_at(args);
+    }
+    else if ((args = cmd_args(buffer, "media")))
+    {
+        return handle_media(args);
+    }
+    else if ((args = cmd_args(buffer, "chord")))
+    {
+        return handle_chord(args);
+    }
+    else if ((args = cmd_args(buffer, "move")))
+    {
+        return handle_move(args);
+    }
+    else if ((args = cmd_args(buffer, "moveto")))
+    {
+        return handle_motion(args, HID_MOTION_POLYLINE, 0, true);
+    }
+    else if ((args = cmd_args(buffer, "path")))
+    {
+        return handle_motion(args, HID_MOTION_POLYLINE, 0, false);
+    }
+    else if ((args = cmd_args(buffer, "drag")))
+    {
+        return handle_motion(args, HID_MOTION_POLYLINE, 0x01, false);
+    }
+    else if ((args = cmd_args(buffer, "bezier")))
+    {
+        return handle_motion(args, HID_MOTION_BEZIER, 0, false);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void hid_cmd_dispatch(const uint8_t *data, size_t len)
+{
+    char buffer[CMD_MAX_LEN + 1];
+
+    if (len == 0)
+    {
+        return;
+    }
+    if (data[0] == HID_PROTO_FRAME_MARKER)
+    {
+        dispatch_frames(data, len);
+        return;
+    }
+    if (len > CMD_MAX_LEN)
+    {
+        ESP_LOGW(TAG, "Command truncated (%u bytes)", (unsigned)len);
+        len = CMD_MAX_LEN;
+    }
+
+    // Convert to null-terminated string
+    memcpy(buffer, data, len);
+    buffer[len] = '\0';
+
+    if (!run_command(buffer))
+    {
+        ESP_LOGI(TAG, "Typing string: %s", buffer);
+        hid_output_text(buffer, len);
+    }
+}
+
+/* ───────────────────────── Command Task ────────────────────────────── */
+static void hid_cmd_task(void *pvParameters)
+{
+    static uint8_t data[CMD_MAX_LEN];
+
+    while (1)
+    {
+        size_t len = xMessageBufferReceive(s_cmd_buf, data, sizeof(data), portMAX_DELAY);
+        hid_cmd_dispatch(data, len);
+        hid_l2cap_resume();
+    }
+}
+
+esp_err_t hid_cmd_submit(hid_cmd_src_t src, const uint8_t *data, size_t len)
+{
+    src_stats_t *st = &s_src_stats[src];
+    int64_t now = esp_timer_get_time();
+
+    if (len == 0)
+    {
+        return ESP_OK;
+    }
+    if (now - st->last_us > BURST_GAP_US)
+    {
+        st->burst_start_us = now;
+        st->burst_bytes = 0;
+    }
+    st->last_us = now;
+    st->writes++;
+    if (len > CMD_MAX_LEN)
+    {
+        ESP_LOGW(TAG, "Command truncated (%u bytes)", (unsigned)len);
+        len = CMD_MAX_LEN;
+    }
+    bool text = len > HID_PROTO_FRAME_HDR_LEN && data[0] == HID_PROTO_FRAME_MARKER && data[1] == HID_OP_TEXT_Z;
+    xSemaphoreTake(s_submit_lock, portMAX_DELAY);
+    if (text && (data[HID_PROTO_FRAME_HDR_LEN] & HID_TEXT_Z_F_START))
+    {
+        s_submit_text_cut = false;
+    }
+    size_t sent = text && s_submit_text_cut ? 0 : xMessageBufferSend(s_cmd_buf, data, len, 0);
+    s_submit_text_cut |= text && sent != len;
+    xSemaphoreGive(s_submit_lock);
+    if (sent != len)
+    {
+        ESP_LOGW(TAG, "Command queue full, %u bytes dropped", (unsigned)len);
+        st->dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+    st->bytes += len;
+    st->burst_bytes += len;
+    return ESP_OK;
+}
+
+bool hid_cmd_has_room(size_t len)
+{
+    // Every message costs its length plus a size_t header
+    return xMessageBufferSpacesAvailable(s_cmd_buf) >= len + sizeof(size_t);
+}
+
+void hid_cmd_log_stats(void)
+{
+    static const char *const names[HID_CMD_SRC_MAX] = {"gatt", "l2cap", "sched"};
+
+    for (int i = 0; i < HID_CMD_SRC_MAX; i++)
+    {
+        const src_stats_t *st = &s_src_stats[i];
+        int64_t span_us = st->last_us - st->burst_start_us;
+
+        if (st->writes == 0)
+        {
+            continue;
+        }
+        // Writes closer than BURST_GAP_US form a burst; its rate is what a stream achieved
+        ESP_LOGI(TAG, "%s writes=%" PRIu32 " bytes=%" PRIu32 " dropped=%" PRIu32, names[i], st->writes, st->bytes,
+                 st->dropped);
+        ESP_LOGI(TAG, "%s last burst %" PRIu32 " B in %" PRId64 " ms, %" PRId64 " B/s", names[i], st->burst_bytes,
+                 span_us / 1000, span_us > 0 ? (int64_t)st->burst_bytes * 1000000 / span_us : 0);
+    }
+}
+
+esp_err_t hid_cmd_init(void)
+{
+    if (s_cmd_buf)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_cmd_buf = xMessageBufferCreateStatic(CMD_QUEUE_SIZE, s_cmd_buf_storage, &s_cmd_buf_ctl);
+    s_submit_lock = xSemaphoreCreateMutexStatic(&s_submit_lock_buf);
+
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(hid_cmd_task, "hid_cmd", CMD_TASK_STACK_SIZE, NULL,
+                                                      configMAX_PRIORITIES - 3, s_task_stack, &s_task_tcb,
+                                                      HID_TASK_CORE);
+    hid_sysmon_register(task, CMD_TASK_STACK_SIZE);
+    return ESP_OK;
+}
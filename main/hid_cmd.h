@@ -0,0 +1,45 @@
+/*  Command decoding for the custom GATT write characteristic
+ */
+#ifndef _HID_CMD_H_
+#define _HID_CMD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Where a command arrived from, for the per-transport throughput stats */
+typedef enum
+{
+    HID_CMD_SRC_GATT = 0, // custom write characteristic
+    HID_CMD_SRC_L2CAP,    // L2CAP channel (hid_l2cap.h)
+    HID_CMD_SRC_SCHED,    // 'at' command coming due (hid_sched.h)
+    HID_CMD_SRC_MAX
+} hid_cmd_src_t;
+
+/* Starts the command task on HID_TASK_CORE (hid_sysmon.h) */
+esp_err_t hid_cmd_init(void);
+
+/* Copies one command write for the command task. Only waits for another
+ * writer to finish, so it is safe to call from the NimBLE host task. */
+esp_err_t hid_cmd_submit(hid_cmd_src_t src, const uint8_t *data, size_t len);
+
+/* True while a command of len bytes would fit in the queue */
+bool hid_cmd_has_room(size_t len);
+
+void hid_cmd_log_stats(void);
+
+/* Parses one command write and queues the resulting HID work; only called
+ * from the command task, which keeps it the single producer of bulk text. */
+void hid_cmd_dispatch(const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_CMD_H_ */
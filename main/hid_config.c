@@ -0,0 +1,435 @@
+/*  Runtime configuration record
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "hid_config.h"
+
+static const char *TAG = "HID_CFG";
+
+#define NVS_NAMESPACE "hid_cfg"
+#define NVS_KEY "record"
+
+#if CONFIG_EXAMPLE_NKRO_DEFAULT
+#define NKRO_DEFAULT 1
+#else
+#define NKRO_DEFAULT 0
+#endif
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t type;
+    uint8_t flags;
+    uint8_t size; // field size, for strings the buffer with its terminator
+    uint16_t offset;
+    uint32_t min;
+    uint32_t max;
+    const char *name;
+} key_def_t;
+
+#define FIELD_SIZE(field) sizeof(((hid_config_t *)0)->field)
+#define KEY_DEF(id, field, type, min, max, flags) \
+    {id, type, flags, FIELD_SIZE(field), offsetof(hid_config_t, field), min, max, #field},
+#define KEY_CHECK(id, field, type, min, max, flags)                                                       \
+    _Static_assert(type == HID_CFG_TYPE_STR ||                                                           \
+                       FIELD_SIZE(field) == (type == HID_CFG_TYPE_U8 ? 1 : type == HID_CFG_TYPE_U16 ? 2 : 4), \
+                   #field " does not match its type");
+
+static const key_def_t s_keys[] = {HID_CONFIG_KEYS(KEY_DEF)};
+HID_CONFIG_KEYS(KEY_CHECK)
+#define KEY_COUNT (sizeof(s_keys) / sizeof(s_keys[0]))
+
+// Every key at full size with its id and length, after the version byte
+#define BLOB_MAX (1 + sizeof(hid_config_t) + 2 * KEY_COUNT)
+_Static_assert(4 + BLOB_MAX <= HID_CONFIG_READ_MAX, "values must fit one read");
+
+// The former compile-time constants
+static const hid_config_t s_defaults = {
+    .key_press_ms = 20,
+    .key_release_ms = 10,
+    .char_gap_ms = 100,
+    .click_press_ms = 20,
+    .consumer_press_ms = 30,
+    .consumer_release_ms = 10,
+    .unicode_mode = CONFIG_EXAMPLE_UNICODE_MODE,
+    .nkro = NKRO_DEFAULT,
+    .name = "Azmuth",
+    .vendor_id = 0x16C0,
+    .product_id = 0x05DF,
+    .passkey = 123456,
+    .adv_itvl_min_ms = 30, // recommended 30 to 50 ms
+    .adv_itvl_max_ms = 50,
+    .adv_duration_s = 180,
+    .log_level = ESP_LOG_INFO,
+};
+
+// s_cfg is written under s_lock (host task, loader) and read without it:
+// every field is updated whole, which is all the readers rely on
+static hid_config_t s_cfg;
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+static esp_timer_handle_t s_save_timer;
+static hid_config_apply_t s_apply;
+static uint8_t s_view = HID_CFG_VIEW_VALUES;
+static uint8_t s_from;
+
+static struct
+{
+    uint32_t writes;
+    uint32_t refused;
+    uint32_t saves;
+    uint32_t save_errors;
+} s_stats;
+
+/* ───────────────────────── Keys ────────────────────────────── */
+static const key_def_t *find_key(uint8_t id)
+{
+    for (size_t i = 0; i < KEY_COUNT; i++)
+    {
+        if (s_keys[i].id == id)
+        {
+            return &s_keys[i];
+        }
+    }
+    return NULL;
+}
+
+static size_t value_len(const hid_config_t *c, const key_def_t *k)
+{
+    return k->type == HID_CFG_TYPE_STR ? strlen((const char *)c + k->offset) : k->size;
+}
+
+static esp_err_t set_value(hid_config_t *c, const key_def_t *k, const uint8_t *val, size_t n)
+{
+    uint8_t *field = (uint8_t *)c + k->offset;
+
+    if (k->type == HID_CFG_TYPE_STR)
+    {
+        if (n < k->min || n > k->max)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            if (val[i] < 0x20 || val[i] > 0x7e)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        memcpy(field, val, n);
+        field[n] = 0;
+        return ESP_OK;
+    }
+
+    uint32_t v = 0;
+    if (n != k->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&v, val, n);
+    if (v < k->min || v > k->max)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(field, &v, n);
+    return ESP_OK;
+}
+
+/* Rules that span keys; single-key ranges are in HID_CONFIG_KEYS */
+static bool record_valid(const hid_config_t *c)
+{
+    if (c->adv_itvl_min_ms > c->adv_itvl_max_ms)
+    {
+        return false;
+    }
+    if (c->conn_itvl_min || c->conn_itvl_max || c->conn_timeout)
+    {
+        // 7.5 ms minimum, and the timeout must outlast (1 + latency) * interval * 2
+        if (c->conn_itvl_min < 6 || c->conn_itvl_min > c->conn_itvl_max || c->conn_timeout < 10 ||
+            (uint32_t)c->conn_timeout * 4 <= (1u + c->conn_latency) * c->conn_itvl_max)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Applies a [key][len][value] list to c. Strict lists (writes) fail on the
+ * first bad entry; the stored blob skips keys this firmware does not know. */
+static esp_err_t apply_list(hid_config_t *c, const uint8_t *p, size_t len, bool strict)
+{
+    while (len)
+    {
+        if (len < 2 || len - 2 < p[1])
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const key_def_t *k = find_key(p[0]);
+        esp_err_t err = k ? set_value(c, k, p + 2, p[1]) : ESP_ERR_NOT_FOUND;
+        if (err != ESP_OK && strict)
+        {
+            return err;
+        }
+        len -= 2 + p[1];
+        p += 2 + p[1];
+    }
+    return ESP_OK;
+}
+
+static size_t put_value(uint8_t *buf, size_t len, const hid_config_t *c, const key_def_t *k)
+{
+    size_t n = value_len(c, k);
+
+    if (len < 2 + n)
+    {
+        return 0;
+    }
+    buf[0] = k->id;
+    buf[1] = n;
+    memcpy(buf + 2, (const uint8_t *)c + k->offset, n);
+    return 2 + n;
+}
+
+static size_t put_schema(uint8_t *buf, size_t len, const key_def_t *k)
+{
+    size_t n = strlen(k->name);
+
+    if (len < 12 + n)
+    {
+        return 0;
+    }
+    buf[0] = k->id;
+    buf[1] = k->type;
+    buf[2] = k->flags;
+    memcpy(buf + 3, &k->min, 4);
+    memcpy(buf + 7, &k->max, 4);
+    buf[11] = n;
+    memcpy(buf + 12, k->name, n);
+    return 12 + n;
+}
+
+/* ───────────────────────── Storage ────────────────────────────── */
+static void save_timer_cb(void *arg)
+{
+    uint8_t blob[BLOB_MAX];
+    size_t n = 0;
+    nvs_handle_t nvs;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    blob[n++] = HID_CONFIG_VERSION;
+    for (size_t i = 0; i < KEY_COUNT; i++)
+    {
+        n += put_value(blob + n, sizeof(blob) - n, &s_cfg, &s_keys[i]);
+    }
+    xSemaphoreGive(s_lock);
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs, NVS_KEY, blob, n);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        s_stats.save_errors++;
+        ESP_LOGE(TAG, "Saving the config failed (%s)", esp_err_to_name(err));
+        return;
+    }
+    s_stats.saves++;
+}
+
+/* A burst of writes ends up as one flash write */
+static void schedule_save(void)
+{
+    esp_timer_stop(s_save_timer);
+    esp_timer_start_once(s_save_timer, HID_CONFIG_SAVE_DELAY_MS * 1000);
+}
+
+static void load(void)
+{
+    uint8_t blob[BLOB_MAX];
+    size_t n = sizeof(blob);
+    nvs_handle_t nvs;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // nothing saved yet
+    }
+    esp_err_t err = nvs_get_blob(nvs, NVS_KEY, blob, &n);
+    nvs_close(nvs);
+    if (err != ESP_OK || n < 1)
+    {
+        return;
+    }
+
+    hid_config_t loaded = s_defaults;
+    if (apply_list(&loaded, blob + 1, n - 1, false) != ESP_OK || !record_valid(&loaded))
+    {
+        ESP_LOGW(TAG, "Saved config (version %u) unusable, using defaults", blob[0]);
+        return;
+    }
+    s_cfg = loaded;
+    ESP_LOGI(TAG, "Config loaded (version %u, %u bytes)", blob[0], (unsigned)n);
+}
+
+/* ───────────────────────── API ────────────────────────────── */
+static void notify_changes(const hid_config_t *old)
+{
+    if (!s_apply)
+    {
+        return;
+    }
+    for (size_t i = 0; i < KEY_COUNT; i++)
+    {
+        const key_def_t *k = &s_keys[i];
+        if (memcmp((const uint8_t *)old + k->offset, (const uint8_t *)&s_cfg + k->offset, k->size) != 0)
+        {
+            s_apply(&s_cfg, k->id);
+        }
+    }
+}
+
+esp_err_t hid_config_write(const uint8_t *data, size_t len)
+{
+    hid_config_t old;
+    hid_config_t next;
+    esp_err_t err = ESP_OK;
+
+    if (len < 1)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    switch (data[0])
+    {
+    case HID_CFG_OP_VIEW:
+        if (len < 2 || data[1] > HID_CFG_VIEW_SCHEMA)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_view = data[1];
+        s_from = len > 2 ? data[2] : 0;
+        return ESP_OK;
+
+    case HID_CFG_OP_SET:
+    case HID_CFG_OP_RESET:
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        old = s_cfg;
+        next = data[0] == HID_CFG_OP_RESET ? s_defaults : s_cfg;
+        if (data[0] == HID_CFG_OP_SET)
+        {
+            err = apply_list(&next, data + 1, len - 1, true);
+        }
+        if (err == ESP_OK && !record_valid(&next))
+        {
+            err = ESP_ERR_INVALID_ARG;
+        }
+        if (err == ESP_OK)
+        {
+            s_cfg = next;
+        }
+        xSemaphoreGive(s_lock);
+        break;
+
+    default:
+        err = ESP_ERR_NOT_FOUND;
+        break;
+    }
+
+    if (err != ESP_OK)
+    {
+        s_stats.refused++;
+        return err;
+    }
+    s_stats.writes++;
+    notify_changes(&old);
+    schedule_save();
+    return ESP_OK;
+}
+
+size_t hid_config_read(uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+
+    if (len < 4)
+    {
+        return 0;
+    }
+    buf[n++] = HID_CONFIG_VERSION;
+    buf[n++] = s_view;
+    buf[n++] = s_from;
+    buf[n++] = KEY_COUNT;
+    for (size_t i = s_from; i < KEY_COUNT; i++)
+    {
+        const key_def_t *k = &s_keys[i];
+        size_t m;
+        if (s_view == HID_CFG_VIEW_SCHEMA)
+        {
+            m = put_schema(buf + n, len - n, k);
+        }
+        else if (k->flags & HID_CFG_F_SECRET)
+        {
+            continue;
+        }
+        else
+        {
+            m = put_value(buf + n, len - n, &s_cfg, k);
+        }
+        if (m == 0)
+        {
+            break; // left for the next page
+        }
+        n += m;
+    }
+    return n;
+}
+
+const hid_config_t *hid_config_get(void)
+{
+    return &s_cfg;
+}
+
+void hid_config_set_apply(hid_config_apply_t apply)
+{
+    s_apply = apply;
+    if (apply)
+    {
+        apply(&s_cfg, 0);
+    }
+}
+
+void hid_config_log_stats(void)
+{
+    ESP_LOGI(TAG, "writes=%" PRIu32 " refused=%" PRIu32 " saves=%" PRIu32 " save errors=%" PRIu32, s_stats.writes,
+             s_stats.refused, s_stats.saves, s_stats.save_errors);
+}
+
+esp_err_t hid_config_init(void)
+{
+    if (s_lock)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    s_cfg = s_defaults;
+    load();
+
+    esp_timer_create_args_t args = {
+        .callback = save_timer_cb,
+        .name = "hid_cfg_save",
+    };
+    return esp_timer_create(&args, &s_save_timer);
+}
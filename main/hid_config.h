@@ -0,0 +1,117 @@
+/*  Runtime configuration record
+ *
+ *  Pacing, layout, identity, connection and advertising targets and the log
+ *  level live in one typed record, cached in RAM and read through
+ *  hid_config_get(). Every key has an id, a type and a range in
+ *  HID_CONFIG_KEYS; the config characteristic (hid_proto.h) sets keys and
+ *  dumps the values or the key schema. A change is validated before it
+ *  lands, handed to the apply callback and saved to NVS as one blob once
+ *  writes have been quiet for HID_CONFIG_SAVE_DELAY_MS.
+ *
+ *  The blob holds the same key/length/value list the characteristic reads
+ *  back, so records saved by an older firmware keep the keys both know.
+ */
+#ifndef _HID_CONFIG_H_
+#define _HID_CONFIG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "hid_proto.h"
+#include "hid_unicode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_CONFIG_VERSION 1
+#define HID_CONFIG_NAME_MAX 20 // leaves room in the scan response
+#define HID_CONFIG_SAVE_DELAY_MS 2000
+
+typedef struct
+{
+    // Report pacing, ms (hid_output.c)
+    uint8_t key_press_ms;
+    uint8_t key_release_ms;
+    uint8_t char_gap_ms;
+    uint8_t click_press_ms;
+    uint8_t consumer_press_ms;
+    uint8_t consumer_release_ms;
+    // Layout
+    uint8_t unicode_mode; // hid_unicode_mode_t
+    uint8_t nkro;         // keyboard report at boot
+    // Identity
+    char name[HID_CONFIG_NAME_MAX + 1];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t passkey;
+    // Connection parameters requested after connect; 0 leaves the host's
+    uint16_t conn_itvl_min; // 1.25 ms units
+    uint16_t conn_itvl_max;
+    uint16_t conn_latency;
+    uint16_t conn_timeout; // 10 ms units
+    // Advertising
+    uint16_t adv_itvl_min_ms;
+    uint16_t adv_itvl_max_ms;
+    uint16_t adv_duration_s; // 0 = until connected
+    uint8_t log_level;       // esp_log_level_t
+} hid_config_t;
+
+/* K(id, field, type, min, max, flags); ids are part of the protocol and are
+ * never reused. For strings min/max bound the length. Cross-key rules
+ * (min <= max, a usable connection timeout) are checked on every write, which
+ * is why one write may set several keys at once. */
+#define HID_CONFIG_KEYS(K)                                                      \
+    K(0x01, key_press_ms, HID_CFG_TYPE_U8, 1, 255, 0)                           \
+    K(0x02, key_release_ms, HID_CFG_TYPE_U8, 1, 255, 0)                         \
+    K(0x03, char_gap_ms, HID_CFG_TYPE_U8, 0, 255, 0)                            \
+    K(0x04, click_press_ms, HID_CFG_TYPE_U8, 1, 255, 0)                         \
+    K(0x05, consumer_press_ms, HID_CFG_TYPE_U8, 1, 255, 0)                      \
+    K(0x06, consumer_release_ms, HID_CFG_TYPE_U8, 1, 255, 0)                    \
+    K(0x10, unicode_mode, HID_CFG_TYPE_U8, 0, HID_UNICODE_MODE_MAX - 1, 0)      \
+    K(0x11, nkro, HID_CFG_TYPE_U8, 0, 1, 0)                                     \
+    K(0x20, name, HID_CFG_TYPE_STR, 1, HID_CONFIG_NAME_MAX, 0)                  \
+    K(0x21, vendor_id, HID_CFG_TYPE_U16, 0, 0xFFFF, HID_CFG_F_REBOOT)           \
+    K(0x22, product_id, HID_CFG_TYPE_U16, 0, 0xFFFF, HID_CFG_F_REBOOT)          \
+    K(0x23, passkey, HID_CFG_TYPE_U32, 0, 999999, HID_CFG_F_SECRET)             \
+    K(0x30, conn_itvl_min, HID_CFG_TYPE_U16, 0, 3200, 0)                        \
+    K(0x31, conn_itvl_max, HID_CFG_TYPE_U16, 0, 3200, 0)                        \
+    K(0x32, conn_latency, HID_CFG_TYPE_U16, 0, 499, 0)                          \
+    K(0x33, conn_timeout, HID_CFG_TYPE_U16, 0, 3200, 0)                         \
+    K(0x40, adv_itvl_min_ms, HID_CFG_TYPE_U16, 20, 10240, 0)                    \
+    K(0x41, adv_itvl_max_ms, HID_CFG_TYPE_U16, 20, 10240, 0)                    \
+    K(0x42, adv_duration_s, HID_CFG_TYPE_U16, 0, 3600, 0)                       \
+    K(0x50, log_level, HID_CFG_TYPE_U8, 0, 5, 0)
+
+#define HID_CONFIG_KEY_ID(id, field, type, min, max, flags) HID_CFG_##field = id,
+enum
+{
+    HID_CONFIG_KEYS(HID_CONFIG_KEY_ID)
+};
+
+/* Called after a key changed (key 0: the whole record, at registration) */
+typedef void (*hid_config_apply_t)(const hid_config_t *cfg, uint8_t key);
+
+/* Loads the record from NVS over the defaults; nvs_flash_init() first */
+esp_err_t hid_config_init(void);
+
+/* Registers the apply callback and calls it once with key 0 */
+void hid_config_set_apply(hid_config_apply_t apply);
+
+const hid_config_t *hid_config_get(void);
+
+/* One config characteristic write; ESP_ERR_INVALID_ARG / _SIZE / NOT_FOUND
+ * when refused, with the record unchanged */
+esp_err_t hid_config_write(const uint8_t *data, size_t len);
+
+/* Config characteristic read for the selected view; returns the length */
+size_t hid_config_read(uint8_t *buf, size_t len);
+
+void hid_config_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_CONFIG_H_ */
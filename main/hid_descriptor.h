@@ -0,0 +1,76 @@
+/*  HID report descriptor building blocks
+ *
+ *  Every item expands to its bytes followed by a comma, so a descriptor is a
+ *  plain sequence of macros inside an array initialiser. Report fields are
+ *  written once as X-macro lists of
+ *
+ *      F(items, report size, report count, main item, flags)
+ *
+ *  and expanded twice: into descriptor bytes (HID_FIELD_ITEMS) and into the
+ *  report length in bits (HID_REPORT_IN_BITS / HID_REPORT_OUT_BITS). The
+ *  packed report structs are checked against those lengths at compile time.
+ */
+#ifndef _HID_DESCRIPTOR_H_
+#define _HID_DESCRIPTOR_H_
+
+#define HID_LE16(v) ((v) & 0xFF), (((v) >> 8) & 0xFF)
+
+/* Usage pages */
+#define HID_PAGE_GENERIC_DESKTOP 0x01
+#define HID_PAGE_KEYBOARD 0x07
+#define HID_PAGE_LEDS 0x08
+#define HID_PAGE_BUTTON 0x09
+#define HID_PAGE_CONSUMER 0x0C
+
+/* Generic Desktop usages */
+#define HID_GD_POINTER 0x01
+#define HID_GD_MOUSE 0x02
+#define HID_GD_KEYBOARD 0x06
+#define HID_GD_X 0x30
+#define HID_GD_Y 0x31
+
+#define HID_CONSUMER_CONTROL 0x01
+
+/* Main items and their flags */
+#define HID_MAIN_INPUT 0x81
+#define HID_MAIN_OUTPUT 0x91
+
+#define HID_DATA_ARRAY 0x00
+#define HID_DATA_VAR_ABS 0x02
+#define HID_CONST_VAR_ABS 0x03 // padding
+#define HID_DATA_VAR_REL 0x06
+
+#define HID_COLLECTION_PHYSICAL 0x00
+#define HID_COLLECTION_APPLICATION 0x01
+
+/* Short items; values above 127 need the 16-bit variants */
+#define HID_USAGE_PAGE(page) 0x05, (page),
+#define HID_LOGICAL_MIN(v) 0x15, ((v) & 0xFF),
+#define HID_LOGICAL_MAX(v) 0x25, ((v) & 0xFF),
+#define HID_LOGICAL_MAX16(v) 0x26, HID_LE16(v),
+#define HID_REPORT_SIZE(bits) 0x75, (bits),
+#define HID_REPORT_ID(id) 0x85, (id),
+#define HID_REPORT_COUNT(n) 0x95, (n),
+#define HID_USAGE(u) 0x09, (u),
+#define HID_USAGE_MIN(u) 0x19, (u),
+#define HID_USAGE_MAX(u) 0x29, (u),
+#define HID_USAGE_MAX16(u) 0x2A, HID_LE16(u),
+#define HID_COLLECTION(kind) 0xA1, (kind),
+#define HID_END_COLLECTION 0xC0,
+
+/* Field list expanders */
+#define HID_FIELD_ITEMS(items, size, count, main, flags) \
+    items HID_REPORT_SIZE(size) HID_REPORT_COUNT(count) (main), (flags),
+#define HID_FIELD_IN_BITS(items, size, count, main, flags) +((main) == HID_MAIN_INPUT ? (size) * (count) : 0)
+#define HID_FIELD_OUT_BITS(items, size, count, main, flags) +((main) == HID_MAIN_OUTPUT ? (size) * (count) : 0)
+
+#define HID_REPORT_IN_BITS(fields) (0 fields(HID_FIELD_IN_BITS))
+#define HID_REPORT_OUT_BITS(fields) (0 fields(HID_FIELD_OUT_BITS))
+
+/* Fails the build when a report struct and its field list disagree */
+#define HID_CHECK_INPUT(type, fields) \
+    _Static_assert(HID_REPORT_IN_BITS(fields) == 8 * sizeof(type), #type " does not match " #fields)
+#define HID_CHECK_OUTPUT(type, fields) \
+    _Static_assert(HID_REPORT_OUT_BITS(fields) == 8 * sizeof(type), #type " does not match " #fields)
+
+#endif /* _HID_DESCRIPTOR_H_ */
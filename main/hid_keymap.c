@@ -0,0 +1,206 @@
+/*  ASCII → HID usage mapping for the typing engine (US layout)
+ */
+#include "hid_keymap.h"
+
+/* ───────────────────────── ASCII Lookup ────────────────────────────── */
+bool keymap_ascii_lookup(char ch, uint8_t *modifier, uint8_t *keycode)
+{
+    *keycode = 0;
+    *modifier = KEY_MOD_NONE;
+
+    if (ch >= 'A' && ch <= 'Z')
+    {
+        *keycode = KEY_A + (ch - 'A');
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch >= 'a' && ch <= 'z')
+    {
+        *keycode = KEY_A + (ch - 'a');
+    }
+    else if (ch >= '1' && ch <= '9')
+    {
+        *keycode = KEY_1 + (ch - '1');
+    }
+    else if (ch == '0')
+    {
+        *keycode = KEY_0;
+    }
+    else if (ch == ' ')
+    {
+        *keycode = KEY_SPACE;
+    }
+    else if (ch == '\n' || ch == '\r')
+    {
+        *keycode = KEY_ENTER;
+    }
+    else if (ch == '\t')
+    {
+        *keycode = KEY_TAB;
+    }
+    // Punctuation & Symbols
+    else if (ch == '!')
+    {
+        *keycode = KEY_1;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '@')
+    {
+        *keycode = KEY_2;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '#')
+    {
+        *keycode = KEY_3;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '$')
+    {
+        *keycode = KEY_4;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '%')
+    {
+        *keycode = KEY_5;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '^')
+    {
+        *keycode = KEY_6;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '&')
+    {
+        *keycode = KEY_7;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '*')
+    {
+        *keycode = KEY_8;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '(')
+    {
+        *keycode = KEY_9;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == ')')
+    {
+        *keycode = KEY_0;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '-')
+    {
+        *keycode = KEY_MINUS;
+    }
+    else if (ch == '_')
+    {
+        *keycode = KEY_MINUS;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '=')
+    {
+        *keycode = KEY_EQUAL;
+    }
+    else if (ch == '+')
+    {
+        *keycode = KEY_EQUAL;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '[')
+    {
+        *keycode = KEY_LEFTBRACE;
+    }
+    else if (ch == '{')
+    {
+        *keycode = KEY_LEFTBRACE;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == ']')
+    {
+        *keycode = KEY_RIGHTBRACE;
+    }
+    else if (ch == '}')
+    {
+        *keycode = KEY_RIGHTBRACE;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '\\')
+    {
+        *keycode = KEY_BACKSLASH;
+    }
+    else if (ch == '|')
+    {
+        *keycode = KEY_BACKSLASH;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == ';')
+    {
+        *keycode = KEY_SEMICOLON;
+    }
+    else if (ch == ':')
+    {
+        *keycode = KEY_SEMICOLON;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '\'')
+    {
+        *keycode = KEY_APOSTROPHE;
+    }
+    else if (ch == '"')
+    {
+        *keycode = KEY_APOSTROPHE;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == ',')
+    {
+        *keycode = KEY_COMMA;
+    }
+    else if (ch == '<')
+    {
+        *keycode = KEY_COMMA;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '.')
+    {
+        *keycode = KEY_DOT;
+    }
+    else if (ch == '>')
+    {
+        *keycode = KEY_DOT;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '/')
+    {
+        *keycode = KEY_SLASH;
+    }
+    else if (ch == '?')
+    {
+        *keycode = KEY_SLASH;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else if (ch == '`')
+    {
+        *keycode = KEY_GRAVE;
+    }
+    else if (ch == '~')
+    {
+        *keycode = KEY_GRAVE;
+        *modifier = KEY_MOD_LSHIFT;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t keymap_apply_leds(uint8_t keycode, uint8_t modifier, uint8_t leds)
+{
+    // Caps Lock inverts Shift on letters only
+    if ((leds & HID_LED_CAPS_LOCK) && keycode >= KEY_A && keycode <= KEY_Z)
+    {
+        modifier ^= KEY_MOD_LSHIFT;
+    }
+    return modifier;
+}
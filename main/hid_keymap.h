@@ -0,0 +1,142 @@
+/*  Keyboard / Consumer usage definitions and ASCII → HID key mapping
+ */
+#ifndef _HID_KEYMAP_H_
+#define _HID_KEYMAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VOLUME_UP (0x00E9)     // Volume Up
+#define VOLUME_DOWN (0x00EA)   // Volume Down
+#define MUTE (0x00E2)          // Mute
+#define PLAY_PAUSE (0x00CD)    // Play/Pause
+#define SCAN_NEXT (0x00B5)     // Scan Next Track
+#define SCAN_PREVIOUS (0x00B6) // Scan Previous Track
+#define STOP (0x00B7)          // Stop
+
+// Modifier Keys
+#define KEY_MOD_NONE 0x00
+#define KEY_MOD_LCTRL 0x01
+#define KEY_MOD_LSHIFT 0x02
+#define KEY_MOD_LALT 0x04
+#define KEY_MOD_LGUI 0x08
+#define KEY_MOD_RCTRL 0x10
+#define KEY_MOD_RSHIFT 0x20
+#define KEY_MOD_RALT 0x40
+#define KEY_MOD_RGUI 0x80
+
+// Reported in every key slot when more keys are down than the report holds
+#define KEY_ERR_ROLLOVER 0x01
+
+// Letters
+#define KEY_A 0x04
+#define KEY_B 0x05
+#define KEY_C 0x06
+#define KEY_D 0x07
+#define KEY_E 0x08
+#define KEY_F 0x09
+#define KEY_G 0x0A
+#define KEY_H 0x0B
+#define KEY_I 0x0C
+#define KEY_J 0x0D
+#define KEY_K 0x0E
+#define KEY_L 0x0F
+#define KEY_M 0x10
+#define KEY_N 0x11
+#define KEY_O 0x12
+#define KEY_P 0x13
+#define KEY_Q 0x14
+#define KEY_R 0x15
+#define KEY_S 0x16
+#define KEY_T 0x17
+#define KEY_U 0x18
+#define KEY_V 0x19
+#define KEY_W 0x1A
+#define KEY_X 0x1B
+#define KEY_Y 0x1C
+#define KEY_Z 0x1D
+
+// Numbers
+#define KEY_1 0x1E
+#define KEY_2 0x1F
+#define KEY_3 0x20
+#define KEY_4 0x21
+#define KEY_5 0x22
+#define KEY_6 0x23
+#define KEY_7 0x24
+#define KEY_8 0x25
+#define KEY_9 0x26
+#define KEY_0 0x27
+
+// Special Characters
+#define KEY_ENTER 0x28
+#define KEY_ESC 0x29
+#define KEY_BACKSPACE 0x2A
+#define KEY_TAB 0x2B
+#define KEY_SPACE 0x2C
+#define KEY_MINUS 0x2D
+#define KEY_EQUAL 0x2E
+#define KEY_LEFTBRACE 0x2F
+#define KEY_RIGHTBRACE 0x30
+#define KEY_BACKSLASH 0x31
+#define KEY_SEMICOLON 0x33
+#define KEY_APOSTROPHE 0x34
+#define KEY_GRAVE 0x35
+#define KEY_COMMA 0x36
+#define KEY_DOT 0x37
+#define KEY_SLASH 0x38
+
+// Arrow Keys
+#define KEY_RIGHT 0x4F
+#define KEY_LEFT 0x50
+#define KEY_DOWN 0x51
+#define KEY_UP 0x52
+
+// Function Keys
+#define KEY_F1 0x3A
+#define KEY_F2 0x3B
+#define KEY_F3 0x3C
+#define KEY_F4 0x3D
+#define KEY_F5 0x3E
+#define KEY_F6 0x3F
+#define KEY_F7 0x40
+#define KEY_F8 0x41
+#define KEY_F9 0x42
+#define KEY_F10 0x43
+#define KEY_F11 0x44
+#define KEY_F12 0x45
+
+// Other useful keys
+#define KEY_DELETE 0x4C
+#define KEY_HOME 0x4A
+#define KEY_END 0x4D
+#define KEY_PAGEUP 0x4B
+#define KEY_PAGEDOWN 0x4E
+
+// Keypad
+#define KEY_NUMLOCK 0x53
+#define KEY_KP_PLUS 0x57
+#define KEY_KP_1 0x59
+#define KEY_KP_0 0x62
+
+// Keyboard LED output report bits
+#define HID_LED_NUM_LOCK 0x01
+#define HID_LED_CAPS_LOCK 0x02
+#define HID_LED_SCROLL_LOCK 0x04
+
+/* One keyboard report of a precomputed key sequence; all-zero is a release */
+typedef struct
+{
+    uint8_t modifier;
+    uint8_t keycode;
+} hid_key_report_t;
+
+/* Maps one ASCII character onto a modifier + keycode pair (US layout).
+ * Returns false for characters the keyboard cannot produce. */
+bool keymap_ascii_lookup(char ch, uint8_t *modifier, uint8_t *keycode);
+
+/* Adjusts the modifier of a looked-up letter for the host's Caps Lock state,
+ * so the character comes out as asked for. */
+uint8_t keymap_apply_leds(uint8_t keycode, uint8_t modifier, uint8_t leds);
+
+#endif /* _HID_KEYMAP_H_ */
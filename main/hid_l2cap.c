@@ -0,0 +1,190 @@
+/*  L2CAP connection-oriented channel for bulk command streams
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+
+#include "sdkconfig.h"
+#include "hid_l2cap.h"
+
+#if CONFIG_EXAMPLE_L2CAP_COC
+#include "host/ble_hs.h"
+#include "host/ble_l2cap.h"
+#include "nimble/nimble_port.h"
+
+#include "hid_cmd.h"
+
+static const char *TAG = "HID_L2CAP";
+
+// Enough blocks for one SDU being reassembled plus the one handed to the stack
+#define SDU_BUF_COUNT 4
+
+static os_membuf_t s_sdu_mem[OS_MEMPOOL_SIZE(SDU_BUF_COUNT, HID_L2CAP_SDU_MAX)];
+static struct os_mempool s_sdu_mempool;
+static struct os_mbuf_pool s_sdu_mbuf_pool;
+
+static struct ble_l2cap_chan *s_chan;
+static volatile bool s_stalled; // no receive buffer given, the peer is out of credits
+static struct ble_npl_event s_resume_ev;
+
+static struct
+{
+    uint32_t channels;
+    uint32_t sdus;
+    uint32_t stalls;
+    uint32_t dropped;
+} s_stats;
+
+/* Hands the stack a buffer for the next SDU, which also returns credits */
+static void rx_ready(struct ble_l2cap_chan *chan)
+{
+    struct os_mbuf *sdu = os_mbuf_get_pkthdr(&s_sdu_mbuf_pool, 0);
+
+    if (sdu == NULL || ble_l2cap_recv_ready(chan, sdu) != 0)
+    {
+        ESP_LOGE(TAG, "No receive buffer, channel stalled");
+        if (sdu)
+        {
+            os_mbuf_free_chain(sdu);
+        }
+        return;
+    }
+    s_stalled = false;
+}
+
+/* Runs on the host task, like every other channel operation */
+static void resume_ev_cb(struct ble_npl_event *ev)
+{
+    if (s_chan && s_stalled && hid_cmd_has_room(HID_L2CAP_SDU_MAX))
+    {
+        rx_ready(s_chan);
+    }
+}
+
+static void on_sdu(struct ble_l2cap_chan *chan, struct os_mbuf *sdu)
+{
+    static uint8_t buf[HID_L2CAP_SDU_MAX];
+    uint16_t len = OS_MBUF_PKTLEN(sdu);
+
+    if (len > sizeof(buf) || ble_hs_mbuf_to_flat(sdu, buf, sizeof(buf), NULL) != 0)
+    {
+        s_stats.dropped++;
+    }
+    else if (hid_cmd_submit(HID_CMD_SRC_L2CAP, buf, len) != ESP_OK)
+    {
+        s_stats.dropped++;
+    }
+    s_stats.sdus++;
+    os_mbuf_free_chain(sdu);
+
+    // Without a new buffer the peer gets no credits and waits for us
+    if (hid_cmd_has_room(HID_L2CAP_SDU_MAX))
+    {
+        rx_ready(chan);
+    }
+    else
+    {
+        s_stalled = true;
+        s_stats.stalls++;
+    }
+}
+
+static int l2cap_event_cb(struct ble_l2cap_event *event, void *arg)
+{
+    struct ble_l2cap_chan_info info;
+
+    switch (event->type)
+    {
+    case BLE_L2CAP_EVENT_COC_ACCEPT:
+        if (s_chan)
+        {
+            return BLE_HS_ENOMEM; // one channel at a time
+        }
+        rx_ready(event->accept.chan);
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_CONNECTED:
+        if (event->connect.status != 0)
+        {
+            ESP_LOGW(TAG, "Channel setup failed (%d)", event->connect.status);
+            return 0;
+        }
+        s_chan = event->connect.chan;
+        s_stats.channels++;
+        if (ble_l2cap_get_chan_info(s_chan, &info) == 0)
+        {
+            ESP_LOGI(TAG, "Channel open: SDU %u/%u, MPS %u/%u (ours/peer)", info.our_coc_mtu,
+                     info.peer_coc_mtu, info.our_l2cap_mtu, info.peer_l2cap_mtu);
+        }
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        if (event->disconnect.chan == s_chan)
+        {
+            s_chan = NULL;
+            s_stalled = false;
+            ESP_LOGI(TAG, "Channel closed");
+        }
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        on_sdu(event->receive.chan, event->receive.sdu_rx);
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+/* ───────────────────────── API ────────────────────────────── */
+void hid_l2cap_resume(void)
+{
+    if (s_stalled)
+    {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &s_resume_ev);
+    }
+}
+
+void hid_l2cap_log_stats(void)
+{
+    ESP_LOGI(TAG, "psm=0x%04x open=%d channels=%" PRIu32 " sdus=%" PRIu32 " stalls=%" PRIu32 " dropped=%" PRIu32,
+             CONFIG_EXAMPLE_L2CAP_COC_PSM, s_chan != NULL, s_stats.channels, s_stats.sdus, s_stats.stalls,
+             s_stats.dropped);
+}
+
+esp_err_t hid_l2cap_init(void)
+{
+    if (os_mempool_init(&s_sdu_mempool, SDU_BUF_COUNT, HID_L2CAP_SDU_MAX, s_sdu_mem, "hid_sdu") != 0 ||
+        os_mbuf_pool_init(&s_sdu_mbuf_pool, &s_sdu_mempool, HID_L2CAP_SDU_MAX, SDU_BUF_COUNT) != 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    ble_npl_event_init(&s_resume_ev, resume_ev_cb, NULL);
+
+    int rc = ble_l2cap_create_server(CONFIG_EXAMPLE_L2CAP_COC_PSM, HID_L2CAP_SDU_MAX, l2cap_event_cb, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(TAG, "L2CAP server failed (%d)", rc);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Listening on PSM 0x%04x", CONFIG_EXAMPLE_L2CAP_COC_PSM);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t hid_l2cap_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void hid_l2cap_resume(void)
+{
+}
+
+void hid_l2cap_log_stats(void)
+{
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*  L2CAP connection-oriented channel for bulk command streams
+ *
+ *  An LE credit-based channel on a fixed PSM that takes the same commands
+ *  and frames as the custom write characteristic, one command per SDU.
+ *  Flow control comes from the credits: a new receive buffer is only given
+ *  to the stack while the command queue can hold a full SDU, so a fast
+ *  sender stalls instead of losing data. The characteristic stays the path
+ *  for small interactive commands.
+ */
+#ifndef _HID_L2CAP_H_
+#define _HID_L2CAP_H_
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest SDU accepted on the channel, the same as one characteristic write */
+#define HID_L2CAP_SDU_MAX 256
+
+/* Registers the L2CAP server; call after the NimBLE host is initialised */
+esp_err_t hid_l2cap_init(void);
+
+/* Called by the command task once queue space was freed */
+void hid_l2cap_resume(void);
+
+void hid_l2cap_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_L2CAP_H_ */
@@ -0,0 +1,113 @@
+/*  Streaming LZSS decoder (heatshrink bitstream format)
+ */
+#include <string.h>
+
+#include "hid_lzss.h"
+
+#define WINDOW_MASK ((1 << HID_LZSS_WINDOW_BITS) - 1)
+
+enum
+{
+    ST_TAG,
+    ST_LITERAL,
+    ST_OFFSET,
+    ST_COUNT,
+    ST_COPY,
+};
+
+void hid_lzss_reset(hid_lzss_t *d)
+{
+    memset(d, 0, sizeof(*d));
+    d->state = ST_TAG;
+}
+
+void hid_lzss_feed(hid_lzss_t *d, uint8_t byte)
+{
+    d->in_byte = byte;
+    d->in_bits = 8;
+}
+
+/* Collects n bits across input bytes; false until all of them arrived */
+static bool take_bits(hid_lzss_t *d, uint8_t n, uint16_t *out)
+{
+    while (d->acc_bits < n)
+    {
+        if (d->in_bits == 0)
+        {
+            return false;
+        }
+        d->in_bits--;
+        d->acc = (d->acc << 1) | ((d->in_byte >> d->in_bits) & 1);
+        d->acc_bits++;
+    }
+    *out = d->acc;
+    d->acc = 0;
+    d->acc_bits = 0;
+    return true;
+}
+
+static uint8_t emit(hid_lzss_t *d, uint8_t c)
+{
+    d->window[d->head++ & WINDOW_MASK] = c;
+    return c;
+}
+
+bool hid_lzss_poll(hid_lzss_t *d, uint8_t *out)
+{
+    uint16_t v;
+
+    while (1)
+    {
+        switch (d->state)
+        {
+        case ST_TAG:
+            if (!take_bits(d, 1, &v))
+            {
+                return false;
+            }
+            d->state = v ? ST_LITERAL : ST_OFFSET;
+            break;
+
+        case ST_LITERAL:
+            if (!take_bits(d, 8, &v))
+            {
+                return false;
+            }
+            d->state = ST_TAG;
+            *out = emit(d, (uint8_t)v);
+            return true;
+
+        case ST_OFFSET:
+            if (!take_bits(d, HID_LZSS_WINDOW_BITS, &v))
+            {
+                return false;
+            }
+            d->offset = v + 1;
+            d->state = ST_COUNT;
+            break;
+
+        case ST_COUNT:
+            if (!take_bits(d, HID_LZSS_LOOKAHEAD_BITS, &v))
+            {
+                return false;
+            }
+            d->count = v + 1;
+            d->state = ST_COPY;
+            break;
+
+        case ST_COPY:
+            if (d->count == 0)
+            {
+                d->state = ST_TAG;
+                break;
+            }
+            d->count--;
+            *out = emit(d, d->window[(d->head - d->offset) & WINDOW_MASK]);
+            return true;
+
+        default:
+            hid_lzss_reset(d);
+            return false;
+        }
+    }
+}
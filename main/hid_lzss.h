@@ -0,0 +1,49 @@
+/*  Streaming LZSS decoder (heatshrink bitstream format)
+ *
+ *  Decodes text sent compressed by the client one output byte at a time, so
+ *  the typing engine can pull characters straight out of the compressed
+ *  stream. RAM use is the window plus a few bytes of state.
+ *
+ *  Bitstream, MSB first: tag 1 + 8-bit literal, or tag 0 + WINDOW_BITS
+ *  (offset - 1) + LOOKAHEAD_BITS (count - 1). Compatible with heatshrink
+ *  encoders run with -w 8 -l 4.
+ */
+#ifndef _HID_LZSS_H_
+#define _HID_LZSS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_LZSS_WINDOW_BITS 8
+#define HID_LZSS_LOOKAHEAD_BITS 4
+
+typedef struct
+{
+    uint8_t window[1 << HID_LZSS_WINDOW_BITS];
+    uint16_t head;
+    uint8_t state;
+    uint8_t in_byte;   // current input byte
+    uint8_t in_bits;   // bits of in_byte not consumed yet
+    uint8_t acc_bits;  // bits collected in acc so far
+    uint16_t acc;
+    uint16_t offset;
+    uint16_t count;
+} hid_lzss_t;
+
+void hid_lzss_reset(hid_lzss_t *d);
+
+/* Hands the next compressed byte over; only valid after poll returned false */
+void hid_lzss_feed(hid_lzss_t *d, uint8_t byte);
+
+/* Produces the next decoded byte; false when more input is required */
+bool hid_lzss_poll(hid_lzss_t *d, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_LZSS_H_ */
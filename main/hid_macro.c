@@ -0,0 +1,157 @@
+/*  Stored macros
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "hid_macro.h"
+#include "hid_output.h"
+#include "hid_proto.h"
+
+static const char *TAG = "HID_MACRO";
+
+#define NVS_NAMESPACE "hid_macro"
+
+typedef struct
+{
+    uint8_t steps[HID_MACRO_MAX];
+    uint16_t len;
+    bool loaded; // steps mirror the NVS slot
+} slot_t;
+
+static slot_t s_slots[HID_MACRO_SLOTS];
+static uint8_t s_upload[HID_MACRO_MAX];
+static size_t s_upload_len;
+static int s_upload_slot = -1; // -1: no upload in progress
+static struct
+{
+    uint32_t stored;
+    uint32_t runs;
+    uint32_t refused;
+} s_stats;
+
+static void slot_key(uint8_t slot, char *key, size_t size)
+{
+    snprintf(key, size, "m%u", slot);
+}
+
+static esp_err_t slot_save(uint8_t slot, const uint8_t *steps, size_t len)
+{
+    char key[8];
+    nvs_handle_t nvs;
+
+    slot_key(slot, key, sizeof(key));
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs, key, steps, len);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    return err;
+}
+
+/* Reads a slot from NVS the first time it is needed; an empty slot has len 0 */
+static void slot_load(uint8_t slot)
+{
+    slot_t *s = &s_slots[slot];
+    char key[8];
+    size_t n = sizeof(s->steps);
+    nvs_handle_t nvs;
+
+    if (s->loaded)
+    {
+        return;
+    }
+    s->loaded = true;
+    s->len = 0;
+    slot_key(slot, key, sizeof(key));
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // nothing stored yet
+    }
+    if (nvs_get_blob(nvs, key, s->steps, &n) == ESP_OK)
+    {
+        s->len = n;
+    }
+    nvs_close(nvs);
+}
+
+esp_err_t hid_macro_store(uint8_t slot, uint8_t flags, const uint8_t *steps, size_t len)
+{
+    if (slot >= HID_MACRO_SLOTS)
+    {
+        s_stats.refused++;
+        ESP_LOGW(TAG, "No macro slot %u", slot);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (flags & HID_MACRO_F_START)
+    {
+        s_upload_slot = slot;
+        s_upload_len = 0;
+    }
+    if (s_upload_slot != slot)
+    {
+        s_stats.refused++;
+        ESP_LOGW(TAG, "Chunk for slot %u without a start", slot);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_upload_len + len > sizeof(s_upload))
+    {
+        s_stats.refused++;
+        s_upload_slot = -1;
+        ESP_LOGW(TAG, "Macro longer than %d bytes", HID_MACRO_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_upload + s_upload_len, steps, len);
+    s_upload_len += len;
+    if (!(flags & HID_MACRO_F_END))
+    {
+        return ESP_OK;
+    }
+
+    s_upload_slot = -1;
+    esp_err_t err = slot_save(slot, s_upload, s_upload_len);
+    if (err != ESP_OK)
+    {
+        s_stats.refused++;
+        ESP_LOGE(TAG, "Saving macro %u failed (%s)", slot, esp_err_to_name(err));
+        return err;
+    }
+    memcpy(s_slots[slot].steps, s_upload, s_upload_len);
+    s_slots[slot].len = s_upload_len;
+    s_slots[slot].loaded = true;
+    s_stats.stored++;
+    ESP_LOGI(TAG, "Macro %u stored, %u bytes", slot, (unsigned)s_upload_len);
+    return ESP_OK;
+}
+
+esp_err_t hid_macro_run(uint8_t slot)
+{
+    if (slot >= HID_MACRO_SLOTS)
+    {
+        ESP_LOGW(TAG, "No macro slot %u", slot);
+        return ESP_ERR_INVALID_ARG;
+    }
+    slot_load(slot);
+    if (s_slots[slot].len == 0)
+    {
+        ESP_LOGW(TAG, "Macro %u is empty", slot);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_stats.runs++;
+    return hid_output_script(s_slots[slot].steps, s_slots[slot].len, true);
+}
+
+void hid_macro_log_stats(void)
+{
+    ESP_LOGI(TAG, "stored=%" PRIu32 " runs=%" PRIu32 " refused=%" PRIu32, s_stats.stored, s_stats.runs,
+             s_stats.refused);
+}
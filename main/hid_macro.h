@@ -0,0 +1,38 @@
+/*  Stored macros: compiled scripts kept in NVS and replayed on request
+ *
+ *  A macro is a run of script steps (hid_proto.h) uploaded with
+ *  HID_OP_MACRO_STORE frames and saved to its slot once the last chunk is in.
+ *  HID_OP_MACRO_RUN or the text command 'macro <slot>' (also behind 'at')
+ *  queues it on the bulk lane. Slots are read from flash once and then
+ *  served from RAM, so a run costs no flash access.
+ *
+ *  Only the command task calls in here.
+ */
+#ifndef _HID_MACRO_H_
+#define _HID_MACRO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_MACRO_SLOTS 4
+#define HID_MACRO_MAX 1024 // bytes of steps per slot; the bulk text buffer holds two
+
+/* Appends one chunk; flags are HID_MACRO_F_* */
+esp_err_t hid_macro_store(uint8_t slot, uint8_t flags, const uint8_t *steps, size_t len);
+
+/* Queues the macro in slot on the bulk lane */
+esp_err_t hid_macro_run(uint8_t slot);
+
+void hid_macro_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_MACRO_H_ */
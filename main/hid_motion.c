@@ -0,0 +1,150 @@
+/*  On-device pointer path interpolation (Q16.16 fixed point)
+ */
+#include <string.h>
+
+#include "hid_motion.h"
+
+#define Q16_ONE (1 << 16)
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (v >= res + bit)
+        {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+/* Q16.16 point on the path at progress t (0..Q16_ONE) */
+static void motion_eval(const hid_motion_t *m, int64_t t, int64_t *x, int64_t *y)
+{
+    const hid_motion_path_t *p = &m->path;
+
+    if (p->kind == HID_MOTION_BEZIER)
+    {
+        // Origin is P0 = (0,0), so its term drops out
+        int64_t u = Q16_ONE - t;
+        int64_t uu = (u * u) >> 16;
+        int64_t tt = (t * t) >> 16;
+        int64_t b1 = 3 * ((uu * t) >> 16);
+        int64_t b2 = 3 * ((u * tt) >> 16);
+        int64_t b3 = (tt * t) >> 16;
+
+        *x = b1 * p->pts[0][0] + b2 * p->pts[1][0] + b3 * p->pts[2][0];
+        *y = b1 * p->pts[0][1] + b2 * p->pts[1][1] + b3 * p->pts[2][1];
+        return;
+    }
+
+    // Polyline: constant speed along the cumulative length
+    uint32_t total = m->seg_end[p->npoints - 1];
+    uint64_t dist = ((uint64_t)total * t) >> 16;
+    int32_t x0 = 0, y0 = 0;
+
+    for (int i = 0; i < p->npoints; i++)
+    {
+        uint32_t start = i ? m->seg_end[i - 1] : 0;
+        int32_t x1 = p->pts[i][0], y1 = p->pts[i][1];
+
+        if (dist <= m->seg_end[i] || i == p->npoints - 1)
+        {
+            uint32_t len = m->seg_end[i] - start;
+            int64_t frac = len ? (int64_t)(((dist - start) << 16) / len) : Q16_ONE;
+            *x = ((int64_t)x0 << 16) + (x1 - x0) * frac;
+            *y = ((int64_t)y0 << 16) + (y1 - y0) * frac;
+            return;
+        }
+        x0 = x1;
+        y0 = y1;
+    }
+    *x = *y = 0;
+}
+
+static int32_t q16_round(int64_t v)
+{
+    return (int32_t)((v + (Q16_ONE / 2)) >> 16);
+}
+
+static int8_t clamp_rel(int32_t v)
+{
+    return v > 127 ? 127 : (v < -127 ? -127 : (int8_t)v);
+}
+
+bool hid_motion_start(hid_motion_t *m, const hid_motion_path_t *path)
+{
+    if (path->npoints == 0 || path->npoints > HID_MOTION_MAX_POINTS)
+    {
+        return false;
+    }
+    if (path->kind == HID_MOTION_BEZIER && path->npoints != 3)
+    {
+        return false;
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->path = *path;
+
+    if (path->kind == HID_MOTION_POLYLINE)
+    {
+        int32_t x0 = 0, y0 = 0;
+        uint32_t acc = 0;
+        for (int i = 0; i < path->npoints; i++)
+        {
+            int64_t dx = path->pts[i][0] - x0;
+            int64_t dy = path->pts[i][1] - y0;
+            acc += isqrt64((uint64_t)(dx * dx + dy * dy));
+            m->seg_end[i] = acc;
+            x0 = path->pts[i][0];
+            y0 = path->pts[i][1];
+        }
+    }
+    return true;
+}
+
+bool hid_motion_next(hid_motion_t *m, int8_t *dx, int8_t *dy)
+{
+    const hid_motion_path_t *p = &m->path;
+    int32_t end_x = p->pts[p->npoints - 1][0];
+    int32_t end_y = p->pts[p->npoints - 1][1];
+    int64_t x, y;
+
+    if (m->elapsed_ms >= p->duration_ms && m->sent_x == end_x && m->sent_y == end_y)
+    {
+        return false;
+    }
+
+    m->elapsed_ms += HID_MOTION_TICK_MS;
+    if (m->elapsed_ms >= p->duration_ms)
+    {
+        // Last sample is the exact end point, whatever rounding came before
+        m->elapsed_ms = p->duration_ms;
+        x = (int64_t)end_x << 16;
+        y = (int64_t)end_y << 16;
+    }
+    else
+    {
+        motion_eval(m, ((int64_t)m->elapsed_ms << 16) / p->duration_ms, &x, &y);
+    }
+
+    // Report the whole pixels not yet sent; a clamped rest carries over
+    *dx = clamp_rel(q16_round(x) - m->sent_x);
+    *dy = clamp_rel(q16_round(y) - m->sent_y);
+    m->sent_x += *dx;
+    m->sent_y += *dy;
+    return true;
+}
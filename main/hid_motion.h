@@ -0,0 +1,56 @@
+/*  On-device pointer path interpolation
+ *
+ *  A path is a handful of control points relative to the cursor position at
+ *  the start of the motion plus a duration. It is expanded into one relative
+ *  mouse report per tick using Q16.16 fixed point; the sub-pixel remainder of
+ *  every tick is carried into the next one so the final position is exact.
+ */
+#ifndef _HID_MOTION_H_
+#define _HID_MOTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_MOTION_MAX_POINTS 16
+#define HID_MOTION_TICK_MS 10 // one report per connection event at 7.5–10 ms intervals
+#define HID_MOTION_MAX_DURATION_MS 60000 // longest motion a command may ask for
+
+typedef enum
+{
+    HID_MOTION_POLYLINE = 0, // straight segments through every point
+    HID_MOTION_BEZIER,       // cubic Bézier: pts[0], pts[1] control, pts[2] end
+} hid_motion_kind_t;
+
+typedef struct
+{
+    uint8_t kind;     // hid_motion_kind_t
+    uint8_t npoints;  // points in pts, origin (0,0) implied
+    uint8_t buttons;  // held for the whole motion (drag), released at the end
+    uint32_t duration_ms;
+    int16_t pts[HID_MOTION_MAX_POINTS][2];
+} hid_motion_path_t;
+
+typedef struct
+{
+    hid_motion_path_t path;
+    uint32_t elapsed_ms;
+    int32_t sent_x; // whole pixels already reported
+    int32_t sent_y;
+    uint32_t seg_end[HID_MOTION_MAX_POINTS]; // cumulative polyline length
+} hid_motion_t;
+
+/* Validates the path and resets the interpolator */
+bool hid_motion_start(hid_motion_t *m, const hid_motion_path_t *path);
+
+/* Advances by one tick. Returns false once the end point has been reported. */
+bool hid_motion_next(hid_motion_t *m, int8_t *dx, int8_t *dy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_MOTION_H_ */
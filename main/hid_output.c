@@ -0,0 +1,1314 @@
+/*  HID output pipeline: prioritised report lanes feeding esp_hidd
+ *
+ *  Jobs are split into single reports. After every report the task goes back
+ *  to the highest lane, so interactive work preempts bulk typing between two
+ *  reports. The keyboard report is built from one shared state: a lane may
+ *  only press keys while no other lane holds any, which keeps a preempting
+ *  key tap from releasing (or modifying) a character that is being typed.
+ *
+ *  State reports identical to the last one sent for the same report ID are
+ *  not sent again; the host already has that state.
+ *
+ *  In Boot Protocol mode only the keyboard and mouse exist, as fixed 8 and
+ *  3 byte reports. esp_hid sends them on the boot characteristics under the
+ *  report ID they derive from, so the lanes keep producing the same reports
+ *  and the mode only changes which of them leave the device.
+ */
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "hid_output.h"
+#include "hid_config.h"
+#include "hid_keymap.h"
+#include "hid_lzss.h"
+#include "hid_proto.h"
+#include "hid_sysmon.h"
+#include "hid_unicode.h"
+
+static const char *TAG = "HID_OUT";
+
+// Report pacing, read per step so config writes apply to the next report
+#define CONSUMER_PRESS_MS (hid_config_get()->consumer_press_ms)
+#define CONSUMER_RELEASE_MS (hid_config_get()->consumer_release_ms)
+
+#define CONSUMER_HELD_BITS 0x01
+#define CONSUMER_HELD_ARRAY 0x02
+#define CLICK_PRESS_MS (hid_config_get()->click_press_ms)
+#define KEY_PRESS_MS (hid_config_get()->key_press_ms)
+#define KEY_RELEASE_MS (hid_config_get()->key_release_ms)
+#define CHAR_GAP_MS (hid_config_get()->char_gap_ms)
+
+#define INTERACTIVE_QUEUE_LEN 16
+#define MOTION_QUEUE_LEN 4
+#define BULK_QUEUE_LEN 16
+#define BULK_TEXT_BUF_SIZE 2048
+#define OUTPUT_TASK_STACK_SIZE 4096
+
+#if CONFIG_EXAMPLE_NKRO_DEFAULT
+#define NKRO_DEFAULT true
+#else
+#define NKRO_DEFAULT false
+#endif
+
+typedef enum
+{
+    JOB_CONSUMER,
+    JOB_MOUSE,
+    JOB_CLICK,
+    JOB_ABS_POINTER,
+    JOB_KEY_TAP,
+    JOB_MOTION,
+    JOB_TEXT,
+    JOB_TEXT_Z, // LZSS compressed text, decoded while typing
+    JOB_SCRIPT, // compiled script steps (hid_proto.h), executed as they are
+} hid_job_type_t;
+
+typedef struct
+{
+    uint8_t n;
+    uint8_t next;    // first usage not pressed yet
+    uint8_t pressed; // CONSUMER_HELD_* of the current round
+    uint16_t usages[HID_CONSUMER_BATCH_MAX];
+} consumer_batch_t;
+
+typedef struct
+{
+    hid_job_type_t type;
+    uint32_t gen;        // bulk generation at enqueue, see hid_output_abort()
+    int64_t enqueued_us;
+    union
+    {
+        consumer_batch_t consumer;
+        struct
+        {
+            int8_t dx;
+            int8_t dy;
+            uint8_t buttons;
+        } mouse;
+        struct
+        {
+            uint16_t x;
+            uint16_t y;
+            uint8_t buttons;
+        } abs;
+        struct
+        {
+            uint8_t modifier;
+            uint8_t n;
+            uint8_t keys[HID_KEY_CHORD_MAX];
+        } key;
+        hid_motion_path_t motion;
+        struct
+        {
+            uint16_t len; // bytes of this job still waiting in s_text_buf
+            bool restart; // JOB_TEXT_Z: first chunk of a compressed stream; JOB_SCRIPT: of a script
+        } text;
+    };
+} hid_job_t;
+
+typedef struct
+{
+    QueueHandle_t queue;
+    hid_job_t job;
+    bool active;
+    uint8_t step;
+    int64_t due_us;
+    hid_lane_stats_t stats;
+} hid_lane_state_t;
+
+/* Last report sent per report ID */
+typedef struct
+{
+    bool valid;
+    uint8_t len;
+    uint8_t data[sizeof(hid_nkro_report_t)]; // largest report
+} report_cache_t;
+
+typedef struct
+{
+    uint8_t modifier;
+    uint8_t keys[HID_NKRO_BITMAP_LEN]; // held usages, rendered as array or bitmap
+    int8_t owner;                      // lane holding the keyboard, -1 when all keys are up
+    bool contended;                    // another lane is waiting for the keyboard
+} kbd_state_t;
+
+/* Reports of the character being typed; a plain key is press + release,
+ * other code points replay a host input-method sequence (hid_unicode.h) */
+typedef struct
+{
+    hid_key_report_t reports[HID_UNICODE_MAX_REPORTS + 4]; // + Num Lock taps around a sequence
+    uint8_t len;
+    uint8_t idx;
+    bool rolled; // NKRO: key of the previous character still down
+} typing_state_t;
+
+/* Script step being executed; it stays loaded while the keyboard is busy */
+typedef struct
+{
+    uint8_t op[4 + HID_KEY_CHORD_MAX]; // longest step: HID_SCRIPT_KEYS with a full chord
+    uint8_t len;                       // 0: no step loaded
+    bool releasing;                    // HID_SCRIPT_TAP: key down, release due
+    uint8_t tap_press_ms;
+    uint8_t tap_release_ms;
+} script_state_t;
+
+static esp_hidd_dev_t *s_dev;
+static TaskHandle_t s_task_hdl;
+static hid_lane_state_t s_lanes[HID_LANE_MAX];
+static StreamBufferHandle_t s_text_buf;
+static kbd_state_t s_kbd = {.owner = -1};
+static hid_motion_t s_motion; // interpolator of the active HID_LANE_MOTION job
+static hid_lzss_t s_lzss;     // decoder state, persists across JOB_TEXT_Z chunks
+static hid_lzss_stats_t s_lzss_stats;
+static typing_state_t s_typing;
+static script_state_t s_script;
+static hid_utf8_t s_utf8; // persists across text jobs, writes may split a character
+static volatile uint32_t s_bulk_gen;
+static volatile uint32_t s_resync_gen;
+static volatile uint8_t s_protocol_req = ESP_HID_PROTOCOL_MODE_REPORT;
+static uint8_t s_protocol = ESP_HID_PROTOCOL_MODE_REPORT;
+static volatile uint8_t s_leds; // host keyboard LEDs, HID_LED_*
+static volatile bool s_nkro_req = NKRO_DEFAULT;
+static bool s_nkro = NKRO_DEFAULT;
+static hid_typing_stats_t s_typing_stats[2]; // [0] 6KRO, [1] NKRO
+static report_cache_t s_last_report[HID_RPT_ID_MAX + 1];
+static hid_dedup_stats_t s_dedup_stats[HID_RPT_ID_MAX + 1];
+
+// Everything the pipeline needs is allocated at build time
+static StaticQueue_t s_queue_ctl[HID_LANE_MAX];
+static uint8_t s_interactive_storage[INTERACTIVE_QUEUE_LEN * sizeof(hid_job_t)];
+static uint8_t s_motion_storage[MOTION_QUEUE_LEN * sizeof(hid_job_t)];
+static uint8_t s_bulk_storage[BULK_QUEUE_LEN * sizeof(hid_job_t)];
+static StaticStreamBuffer_t s_text_buf_ctl;
+static uint8_t s_text_buf_storage[BULK_TEXT_BUF_SIZE + 1];
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[OUTPUT_TASK_STACK_SIZE];
+
+/* ───────────────────────── Report Senders ─────────────────────────────── */
+/* Payload length of every report per protocol mode, 0 when it does not exist */
+static const uint8_t s_route_len[2][HID_RPT_ID_MAX + 1] = {
+    [ESP_HID_PROTOCOL_MODE_BOOT] = {
+        [HID_RPT_ID_MOUSE] = sizeof(hid_mouse_report_t),
+        [HID_RPT_ID_KEYBOARD] = sizeof(hid_keyboard_report_t),
+    },
+    [ESP_HID_PROTOCOL_MODE_REPORT] = {
+        [HID_RPT_ID_CONSUMER] = sizeof(hid_consumer_report_t),
+        [HID_RPT_ID_MOUSE] = sizeof(hid_mouse_report_t),
+        [HID_RPT_ID_KEYBOARD] = sizeof(hid_keyboard_report_t),
+#if CONFIG_EXAMPLE_ABS_POINTER_ENABLE
+        [HID_RPT_ID_ABS_POINTER] = sizeof(hid_abs_pointer_report_t),
+#endif
+#if CONFIG_EXAMPLE_NKRO_ENABLE
+        [HID_RPT_ID_NKRO] = sizeof(hid_nkro_report_t),
+#endif
+        [HID_RPT_ID_CONSUMER_BITS] = sizeof(hid_consumer_bits_report_t),
+    },
+};
+
+/* Sends a report unless it repeats the host's current state. A relative
+ * mouse report with movement is an event rather than a state and always
+ * goes out. */
+static void send_report(uint8_t report_id, const void *rpt, uint8_t len, bool is_event)
+{
+    report_cache_t *last = &s_last_report[report_id];
+    hid_dedup_stats_t *st = &s_dedup_stats[report_id];
+
+    uint8_t route_len = s_route_len[s_protocol][report_id];
+    if (route_len == 0)
+    {
+        st->unroutable++;
+        return;
+    }
+    len = route_len < len ? route_len : len;
+    if (!is_event && last->valid && last->len == len && memcmp(last->data, rpt, len) == 0)
+    {
+        st->suppressed++;
+        st->suppressed_bytes += len;
+        return;
+    }
+
+    // Only cache and count what reached the stack, e.g. not while disconnected
+    last->valid = esp_hidd_dev_input_set(s_dev, 0, report_id, (uint8_t *)rpt, len) == ESP_OK;
+    last->len = len;
+    memcpy(last->data, rpt, len);
+    if (last->valid)
+    {
+        st->sent++;
+    }
+    else
+    {
+        st->failed++;
+    }
+}
+
+// Reports are little endian, like the CPU, so the structs are sent as they are
+static void send_consumer_report(const uint16_t *usages, int n)
+{
+    hid_consumer_report_t rpt = {0};
+
+    memcpy(rpt.usages, usages, n * sizeof(usages[0]));
+    send_report(HID_RPT_ID_CONSUMER, &rpt, sizeof(rpt), false);
+}
+
+static void send_consumer_bits_report(uint8_t bits)
+{
+    hid_consumer_bits_report_t rpt = {.bits = bits};
+    send_report(HID_RPT_ID_CONSUMER_BITS, &rpt, sizeof(rpt), false);
+}
+
+/* Bit of usage in the consumer bitmap report, -1 if only the array has it */
+static int consumer_bit(uint16_t usage)
+{
+#define CONSUMER_BIT_ENTRY(u) u,
+    static const uint16_t bits[] = {HID_CONSUMER_BIT_USAGES(CONSUMER_BIT_ENTRY)};
+#undef CONSUMER_BIT_ENTRY
+
+    for (int i = 0; i < (int)(sizeof(bits) / sizeof(bits[0])); i++)
+    {
+        if (bits[i] == usage)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void send_mouse_report(int8_t dx, int8_t dy, uint8_t buttons)
+{
+    hid_mouse_report_t rpt = {.buttons = buttons, .dx = dx, .dy = dy};
+    send_report(HID_RPT_ID_MOUSE, &rpt, sizeof(rpt), dx || dy);
+}
+
+static void send_abs_pointer_report(uint16_t x, uint16_t y, uint8_t buttons)
+{
+    hid_abs_pointer_report_t rpt = {.buttons = buttons, .x = x, .y = y};
+    send_report(HID_RPT_ID_ABS_POINTER, &rpt, sizeof(rpt), false);
+}
+
+static bool kbd_nkro_active(void)
+{
+    return s_nkro && s_protocol == ESP_HID_PROTOCOL_MODE_REPORT;
+}
+
+static bool kbd_key_held(uint8_t keycode)
+{
+    return keycode < HID_NKRO_KEYS && (s_kbd.keys[keycode >> 3] & (1 << (keycode & 7)));
+}
+
+static void send_keyboard_report(void)
+{
+    if (kbd_nkro_active())
+    {
+        hid_nkro_report_t rpt = {.modifier = s_kbd.modifier};
+
+        memcpy(rpt.keys, s_kbd.keys, sizeof(rpt.keys));
+        send_report(HID_RPT_ID_NKRO, &rpt, sizeof(rpt), false);
+        return;
+    }
+
+    hid_keyboard_report_t rpt = {.modifier = s_kbd.modifier};
+    int n = 0;
+
+    for (int key = 1; key < HID_NKRO_KEYS; key++)
+    {
+        if (!kbd_key_held(key))
+        {
+            continue;
+        }
+        if (n == sizeof(rpt.keys))
+        {
+            // Phantom state: more keys than the array can carry
+            memset(rpt.keys, KEY_ERR_ROLLOVER, sizeof(rpt.keys));
+            break;
+        }
+        rpt.keys[n++] = key;
+    }
+    send_report(HID_RPT_ID_KEYBOARD, &rpt, sizeof(rpt), false);
+}
+
+/* ───────────────────────── Keyboard State ─────────────────────────────── */
+static bool kbd_claim(hid_lane_t lane)
+{
+    if (s_kbd.owner >= 0 && s_kbd.owner != (int8_t)lane)
+    {
+        s_kbd.contended = true;
+        return false;
+    }
+    s_kbd.owner = lane;
+    return true;
+}
+
+/* Replaces every held key with the given ones in a single report */
+static bool kbd_set(hid_lane_t lane, uint8_t modifier, const uint8_t *keys, int n)
+{
+    if (!kbd_claim(lane))
+    {
+        return false;
+    }
+    s_kbd.modifier = modifier;
+    memset(s_kbd.keys, 0, sizeof(s_kbd.keys));
+    for (int i = 0; i < n; i++)
+    {
+        if (keys[i] && keys[i] < HID_NKRO_KEYS)
+        {
+            s_kbd.keys[keys[i] >> 3] |= 1 << (keys[i] & 7);
+        }
+    }
+    send_keyboard_report();
+    return true;
+}
+
+static bool kbd_press(hid_lane_t lane, uint8_t modifier, uint8_t keycode)
+{
+    return kbd_set(lane, modifier, &keycode, 1);
+}
+
+static void kbd_release_all(void)
+{
+    s_kbd.owner = -1;
+    s_kbd.contended = false;
+    s_kbd.modifier = KEY_MOD_NONE;
+    memset(s_kbd.keys, 0, sizeof(s_kbd.keys));
+    send_keyboard_report();
+}
+
+/* ───────────────────────── Job Steps ─────────────────────────────── */
+static void text_discard(uint16_t len)
+{
+    uint8_t scratch[32];
+
+    while (len)
+    {
+        size_t n = len < sizeof(scratch) ? len : sizeof(scratch);
+        n = xStreamBufferReceive(s_text_buf, scratch, n, 0);
+        if (n == 0)
+        {
+            break;
+        }
+        len -= n;
+    }
+}
+
+static bool job_has_text(const hid_job_t *job)
+{
+    return job->type == JOB_TEXT || job->type == JOB_TEXT_Z || job->type == JOB_SCRIPT;
+}
+
+/* Next character of a text job, decoding compressed chunks on the fly */
+static bool text_next_char(hid_job_t *job, char *ch)
+{
+    if (job->type == JOB_TEXT)
+    {
+        if (job->text.len == 0 || xStreamBufferReceive(s_text_buf, ch, 1, 0) != 1)
+        {
+            return false;
+        }
+        job->text.len--;
+        return true;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool ok = false;
+    uint8_t in, out;
+
+    if (job->text.restart)
+    {
+        job->text.restart = false;
+        hid_lzss_reset(&s_lzss);
+    }
+    while (1)
+    {
+        if (hid_lzss_poll(&s_lzss, &out))
+        {
+            *ch = (char)out;
+            s_lzss_stats.bytes_out++;
+            ok = true;
+            break;
+        }
+        if (job->text.len == 0 || xStreamBufferReceive(s_text_buf, &in, 1, 0) != 1)
+        {
+            break;
+        }
+        job->text.len--;
+        s_lzss_stats.bytes_in++;
+        hid_lzss_feed(&s_lzss, in);
+    }
+    s_lzss_stats.decode_us += esp_timer_get_time() - start;
+    return ok;
+}
+
+static void typing_push(uint8_t modifier, uint8_t keycode)
+{
+    s_typing.reports[s_typing.len++] = (hid_key_report_t){modifier, keycode};
+}
+
+/* Loads the key reports of the next character into s_typing */
+static bool text_next_seq(hid_job_t *job)
+{
+    char ch;
+    uint32_t cp;
+    uint8_t modifier, keycode;
+
+    while (text_next_char(job, &ch))
+    {
+        if (!hid_utf8_feed(&s_utf8, (uint8_t)ch, &cp))
+        {
+            continue;
+        }
+        s_typing.idx = 0;
+        s_typing.len = 0;
+        if (cp < 0x80)
+        {
+            if (!keymap_ascii_lookup((char)cp, &modifier, &keycode))
+            {
+                ESP_LOGW(TAG, "Unsupported char: %c", (char)cp);
+                continue;
+            }
+            modifier = keymap_apply_leds(keycode, modifier, s_leds);
+            typing_push(modifier, keycode);
+            typing_push(0, 0);
+            return true;
+        }
+
+        const hid_unicode_seq_t *seq = hid_unicode_lookup(cp);
+        if (!seq)
+        {
+            ESP_LOGW(TAG, "Unsupported code point U+%04" PRIX32, cp);
+            continue;
+        }
+        // Alt codes only work on the numpad with Num Lock on; restore it afterwards
+        bool num_lock = seq->mode == HID_UNICODE_WINDOWS && !(s_leds & HID_LED_NUM_LOCK);
+        if (num_lock)
+        {
+            typing_push(0, KEY_NUMLOCK);
+            typing_push(0, 0);
+        }
+        for (int i = 0; i < seq->len; i++)
+        {
+            typing_push(seq->reports[i].modifier, seq->reports[i].keycode);
+        }
+        if (num_lock)
+        {
+            typing_push(0, KEY_NUMLOCK);
+            typing_push(0, 0);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool script_read(hid_job_t *job, uint8_t *out, size_t n)
+{
+    if (job->text.len < n || xStreamBufferReceive(s_text_buf, out, n, 0) != n)
+    {
+        return false;
+    }
+    job->text.len -= n;
+    return true;
+}
+
+/* Loads the next script step of the job into s_script; false at its end or
+ * on a malformed step */
+static bool script_load(hid_job_t *job)
+{
+    static const uint8_t step_len[] = {
+        [HID_SCRIPT_KEYS] = 4, // + n keys
+        [HID_SCRIPT_TAP] = 3,
+        [HID_SCRIPT_TIMING] = 3,
+        [HID_SCRIPT_MOUSE] = 5,
+        [HID_SCRIPT_CONSUMER] = 4,
+        [HID_SCRIPT_CONSUMER_BITS] = 3,
+        [HID_SCRIPT_ABS] = 7,
+        [HID_SCRIPT_WAIT] = 3,
+    };
+    uint8_t *op = s_script.op;
+    uint8_t len;
+
+    if (!script_read(job, op, 1))
+    {
+        return false;
+    }
+    len = op[0] < sizeof(step_len) ? step_len[op[0]] : 0;
+    if (len == 0)
+    {
+        ESP_LOGW(TAG, "Unknown script step 0x%02x", op[0]);
+        return false;
+    }
+    if (!script_read(job, op + 1, len - 1) ||
+        (op[0] == HID_SCRIPT_KEYS && (op[3] > HID_KEY_CHORD_MAX || !script_read(job, op + 4, op[3]))))
+    {
+        ESP_LOGW(TAG, "Malformed script step 0x%02x", op[0]);
+        return false;
+    }
+    s_script.len = len + (op[0] == HID_SCRIPT_KEYS ? op[3] : 0);
+    return true;
+}
+
+typedef enum
+{
+    STEP_SENT,    // one report sent, job continues at ls->due_us
+    STEP_DONE,    // job complete
+    STEP_BLOCKED, // keyboard held by another lane, nothing sent
+} step_result_t;
+
+/* Presses the next round of a consumer batch, then releases it. A round
+ * takes usages in order until one repeats or no report has room for it. */
+static step_result_t consumer_step(hid_lane_state_t *ls, int64_t now)
+{
+    consumer_batch_t *c = &ls->job.consumer;
+
+    if (ls->step == 0)
+    {
+        uint16_t slots[HID_CONSUMER_SLOTS];
+        int n_slots = 0;
+        uint8_t bits = 0;
+
+        for (; c->next < c->n; c->next++)
+        {
+            uint16_t usage = c->usages[c->next];
+            int bit = consumer_bit(usage);
+            if (bit >= 0)
+            {
+                if (bits & (1 << bit))
+                {
+                    break;
+                }
+                bits |= 1 << bit;
+                continue;
+            }
+            bool dup = false;
+            for (int i = 0; i < n_slots; i++)
+            {
+                dup |= slots[i] == usage;
+            }
+            if (dup || n_slots == HID_CONSUMER_SLOTS)
+            {
+                break;
+            }
+            slots[n_slots++] = usage;
+        }
+
+        c->pressed = 0;
+        if (bits)
+        {
+            send_consumer_bits_report(bits);
+            c->pressed |= CONSUMER_HELD_BITS;
+            ls->stats.reports++;
+        }
+        if (n_slots)
+        {
+            send_consumer_report(slots, n_slots);
+            c->pressed |= CONSUMER_HELD_ARRAY;
+            ls->stats.reports++;
+        }
+        ls->step = 1;
+        ls->due_us = now + CONSUMER_PRESS_MS * 1000;
+        return STEP_SENT;
+    }
+
+    if (c->pressed & CONSUMER_HELD_BITS)
+    {
+        send_consumer_bits_report(0);
+        ls->stats.reports++;
+    }
+    if (c->pressed & CONSUMER_HELD_ARRAY)
+    {
+        send_consumer_report(NULL, 0);
+        ls->stats.reports++;
+    }
+    if (c->next < c->n)
+    {
+        ls->step = 0;
+        ls->due_us = now + CONSUMER_RELEASE_MS * 1000;
+        return STEP_SENT;
+    }
+    return STEP_DONE;
+}
+
+/* Executes one script step: at most one report, then the step's delay */
+static step_result_t script_step(hid_lane_t lane, hid_lane_state_t *ls, int64_t now)
+{
+    hid_job_t *job = &ls->job;
+    const uint8_t *op = s_script.op;
+    uint32_t delay_ms;
+
+    if (job->text.restart)
+    {
+        job->text.restart = false;
+        s_script.tap_press_ms = KEY_PRESS_MS;
+        s_script.tap_release_ms = KEY_RELEASE_MS;
+    }
+    if (s_script.releasing)
+    {
+        s_script.releasing = false;
+        s_script.len = 0;
+        kbd_release_all();
+        ls->stats.reports++;
+        ls->due_us = now + s_script.tap_release_ms * 1000;
+        return STEP_SENT;
+    }
+    if (s_script.len == 0 && !script_load(job))
+    {
+        text_discard(job->text.len);
+        return STEP_DONE;
+    }
+
+    switch (op[0])
+    {
+    case HID_SCRIPT_KEYS:
+        if (op[2] == 0 && op[3] == 0 && s_kbd.owner >= 0 && s_kbd.owner != (int8_t)lane)
+        {
+            return STEP_BLOCKED; // another lane's keys are not ours to release
+        }
+        if (op[2] == 0 && op[3] == 0)
+        {
+            kbd_release_all();
+        }
+        else if (!kbd_set(lane, op[2], &op[4], op[3]))
+        {
+            return STEP_BLOCKED;
+        }
+        delay_ms = op[1];
+        break;
+    case HID_SCRIPT_TAP:
+    {
+        // Caps Lock only corrects typed letters; chords go out as compiled
+        uint8_t modifier = (op[1] & ~KEY_MOD_LSHIFT) ? op[1] : keymap_apply_leds(op[2], op[1], s_leds);
+        if (!kbd_press(lane, modifier, op[2]))
+        {
+            return STEP_BLOCKED;
+        }
+        s_script.releasing = true;
+        ls->stats.reports++;
+        ls->due_us = now + s_script.tap_press_ms * 1000;
+        return STEP_SENT;
+    }
+    case HID_SCRIPT_TIMING:
+        s_script.tap_press_ms = op[1];
+        s_script.tap_release_ms = op[2];
+        s_script.len = 0;
+        return STEP_SENT; // no report; the next step is due now
+    case HID_SCRIPT_MOUSE:
+        send_mouse_report((int8_t)op[2], (int8_t)op[3], op[4]);
+        delay_ms = op[1];
+        break;
+    case HID_SCRIPT_CONSUMER:
+    {
+        uint16_t usage = op[2] | op[3] << 8;
+        send_consumer_report(&usage, usage ? 1 : 0);
+        delay_ms = op[1];
+        break;
+    }
+    case HID_SCRIPT_CONSUMER_BITS:
+        send_consumer_bits_report(op[2]);
+        delay_ms = op[1];
+        break;
+    case HID_SCRIPT_ABS:
+        send_abs_pointer_report(op[2] | op[3] << 8, op[4] | op[5] << 8, op[6]);
+        delay_ms = op[1];
+        break;
+    default: // HID_SCRIPT_WAIT
+        s_script.len = 0;
+        ls->due_us = now + (op[1] | op[2] << 8) * 1000;
+        return STEP_SENT;
+    }
+    s_script.len = 0;
+    ls->stats.reports++;
+    ls->due_us = now + delay_ms * 1000;
+    return STEP_SENT;
+}
+
+/* Emits at most one report per report ID */
+static step_result_t job_step(hid_lane_t lane, hid_lane_state_t *ls, int64_t now)
+{
+    hid_job_t *job = &ls->job;
+
+    switch (job->type)
+    {
+    case JOB_CONSUMER:
+        return consumer_step(ls, now);
+
+    case JOB_MOUSE:
+        ls->stats.reports++;
+        send_mouse_report(job->mouse.dx, job->mouse.dy, job->mouse.buttons);
+        return STEP_DONE;
+
+    case JOB_CLICK:
+        ls->stats.reports++;
+        if (ls->step++ == 0)
+        {
+            send_mouse_report(0, 0, job->mouse.buttons);
+            ls->due_us = now + CLICK_PRESS_MS * 1000;
+            return STEP_SENT;
+        }
+        send_mouse_report(0, 0, 0);
+        return STEP_DONE;
+
+    case JOB_ABS_POINTER:
+        ls->stats.reports++;
+        send_abs_pointer_report(job->abs.x, job->abs.y, job->abs.buttons);
+        return STEP_DONE;
+
+    case JOB_KEY_TAP:
+        if (ls->step == 0)
+        {
+            if (!kbd_set(lane, job->key.modifier, job->key.keys, job->key.n))
+            {
+                return STEP_BLOCKED;
+            }
+            ls->stats.reports++;
+            ls->step = 1;
+            ls->due_us = now + KEY_PRESS_MS * 1000;
+            return STEP_SENT;
+        }
+        kbd_release_all();
+        ls->stats.reports++;
+        ls->due_us = now + KEY_RELEASE_MS * 1000;
+        return STEP_DONE;
+
+    case JOB_MOTION:
+    {
+        int8_t dx, dy;
+
+        if (ls->step == 0)
+        {
+            ls->step = 1;
+            if (!hid_motion_start(&s_motion, &job->motion))
+            {
+                ESP_LOGW(TAG, "Invalid motion path");
+                return STEP_DONE;
+            }
+        }
+        // Ticks that round to no movement produce no report
+        while (hid_motion_next(&s_motion, &dx, &dy))
+        {
+            ls->due_us = now + HID_MOTION_TICK_MS * 1000;
+            if (dx || dy)
+            {
+                send_mouse_report(dx, dy, job->motion.buttons);
+                ls->stats.reports++;
+                return STEP_SENT;
+            }
+            if (s_motion.elapsed_ms < job->motion.duration_ms)
+            {
+                return STEP_SENT;
+            }
+        }
+        if (job->motion.buttons)
+        {
+            send_mouse_report(0, 0, 0);
+            ls->stats.reports++;
+        }
+        return STEP_DONE;
+    }
+
+    case JOB_TEXT:
+    case JOB_TEXT_Z:
+    {
+        hid_typing_stats_t *ts = &s_typing_stats[kbd_nkro_active()];
+
+        if (s_typing.idx == s_typing.len)
+        {
+            // Only start a character while the keyboard is free
+            if (s_kbd.owner >= 0 && s_kbd.owner != (int8_t)lane)
+            {
+                return STEP_BLOCKED;
+            }
+            if (!text_next_seq(job))
+            {
+                text_discard(job->text.len);
+                if (s_typing.rolled)
+                {
+                    s_typing.rolled = false;
+                    kbd_release_all();
+                    ls->stats.reports++;
+                    ts->reports++;
+                }
+                return STEP_DONE;
+            }
+            ts->chars++;
+            if (s_typing.rolled)
+            {
+                const hid_key_report_t *next = &s_typing.reports[0];
+
+                s_typing.rolled = false;
+                // Merge the release into the next press unless that would
+                // change the modifier, repeat the key or starve another lane
+                if (s_typing.len != 2 || s_kbd.contended || next->modifier != s_kbd.modifier ||
+                    kbd_key_held(next->keycode))
+                {
+                    kbd_release_all();
+                    ls->stats.reports++;
+                    ts->reports++;
+                    ls->due_us = now + KEY_RELEASE_MS * 1000;
+                    return STEP_SENT;
+                }
+            }
+        }
+
+        const hid_key_report_t *r = &s_typing.reports[s_typing.idx++];
+        ls->stats.reports++;
+        ts->reports++;
+        if (s_typing.idx == s_typing.len)
+        {
+            // Sequences end with all keys up; the keyboard is free again
+            kbd_release_all();
+            ls->due_us = now + (KEY_RELEASE_MS + CHAR_GAP_MS) * 1000;
+            return STEP_SENT;
+        }
+        // Keep the keyboard across intermediate releases of a sequence
+        kbd_press(lane, r->modifier, r->keycode);
+        if (s_typing.len == 2 && kbd_nkro_active())
+        {
+            // Rolling: the next character's press releases this key
+            s_typing.idx = s_typing.len;
+            s_typing.rolled = true;
+            ls->due_us = now + (KEY_PRESS_MS + CHAR_GAP_MS) * 1000;
+            return STEP_SENT;
+        }
+        ls->due_us = now + (r->modifier || r->keycode ? KEY_PRESS_MS : KEY_RELEASE_MS) * 1000;
+        return STEP_SENT;
+    }
+
+    case JOB_SCRIPT:
+        return script_step(lane, ls, now);
+    }
+    return STEP_DONE;
+}
+
+/* ───────────────────────── Pipeline Task ─────────────────────────────── */
+/* Applies reconnects and protocol mode changes requested from other tasks */
+static void link_sync(void)
+{
+    static uint32_t resync_seen;
+
+    if (resync_seen != s_resync_gen)
+    {
+        resync_seen = s_resync_gen;
+        memset(s_last_report, 0, sizeof(s_last_report));
+    }
+    if (s_protocol != s_protocol_req)
+    {
+        s_protocol = s_protocol_req;
+        memset(s_last_report, 0, sizeof(s_last_report));
+        // The host starts the new mode with all keys up; give it the held ones
+        if (s_kbd.owner >= 0)
+        {
+            send_keyboard_report();
+        }
+        ESP_LOGI(TAG, "%s protocol mode", s_protocol == ESP_HID_PROTOCOL_MODE_BOOT ? "Boot" : "Report");
+    }
+    // Switch keyboard reports only while all keys are up on both
+    if (s_nkro != s_nkro_req && s_kbd.owner < 0)
+    {
+        s_nkro = s_nkro_req;
+        ESP_LOGI(TAG, "Keyboard report: %s", s_nkro ? "NKRO" : "6KRO");
+    }
+}
+
+static void bulk_cancel(hid_lane_state_t *ls)
+{
+    if (ls->active)
+    {
+        if (job_has_text(&ls->job))
+        {
+            text_discard(ls->job.text.len);
+        }
+        ls->stats.dropped++;
+        ls->active = false;
+    }
+    s_typing.len = s_typing.idx = 0;
+    s_typing.rolled = false;
+    s_script.len = 0;
+    s_script.releasing = false;
+    memset(&s_utf8, 0, sizeof(s_utf8));
+    // Keys another lane holds stay down
+    if (s_kbd.owner == HID_LANE_BULK)
+    {
+        kbd_release_all();
+    }
+}
+
+static bool lane_activate(hid_lane_t lane, hid_lane_state_t *ls, int64_t now)
+{
+    while (xQueueReceive(ls->queue, &ls->job, 0) == pdTRUE)
+    {
+        if (lane == HID_LANE_BULK && ls->job.gen != s_bulk_gen)
+        {
+            if (job_has_text(&ls->job))
+            {
+                text_discard(ls->job.text.len);
+            }
+            ls->stats.dropped++;
+            continue;
+        }
+
+        uint32_t latency = (uint32_t)(now - ls->job.enqueued_us);
+        ls->stats.jobs++;
+        ls->stats.latency_total_us += latency;
+        if (latency > ls->stats.latency_max_us)
+        {
+            ls->stats.latency_max_us = latency;
+        }
+
+        ls->active = true;
+        ls->step = 0;
+        if (ls->due_us < now)
+        {
+            ls->due_us = now;
+        }
+        return true;
+    }
+    return false;
+}
+
+static void hid_output_task(void *pvParameters)
+{
+    uint32_t bulk_gen_seen = s_bulk_gen;
+
+    while (1)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t next_due = INT64_MAX;
+        bool sent = false;
+
+        link_sync();
+        if (bulk_gen_seen != s_bulk_gen)
+        {
+            bulk_gen_seen = s_bulk_gen;
+            bulk_cancel(&s_lanes[HID_LANE_BULK]);
+            ESP_LOGI(TAG, "Bulk lane aborted");
+        }
+
+        for (int lane = 0; lane < HID_LANE_MAX; lane++)
+        {
+            hid_lane_state_t *ls = &s_lanes[lane];
+
+            if (!ls->active && !lane_activate(lane, ls, now))
+            {
+                continue;
+            }
+            if (ls->due_us > now)
+            {
+                if (ls->due_us < next_due)
+                {
+                    next_due = ls->due_us;
+                }
+                continue;
+            }
+
+            step_result_t res = job_step(lane, ls, now);
+            if (res == STEP_BLOCKED)
+            {
+                // Let the lane holding the keyboard run and release it
+                continue;
+            }
+            if (res == STEP_DONE)
+            {
+                ls->active = false;
+            }
+            sent = true;
+            break; // Re-evaluate from the highest lane after every report
+        }
+
+        if (sent)
+        {
+            continue;
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        if (next_due != INT64_MAX)
+        {
+            wait = pdMS_TO_TICKS((next_due - now + 999) / 1000);
+            if (wait == 0)
+            {
+                wait = 1;
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/* ───────────────────────── Enqueue API ─────────────────────────────── */
+static esp_err_t enqueue(hid_lane_t lane, hid_job_t *job)
+{
+    job->gen = s_bulk_gen;
+    job->enqueued_us = esp_timer_get_time();
+    if (xQueueSend(s_lanes[lane].queue, job, 0) != pdTRUE)
+    {
+        s_lanes[lane].stats.dropped++;
+        ESP_LOGW(TAG, "Lane %d full, job dropped", lane);
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotifyGive(s_task_hdl);
+    return ESP_OK;
+}
+
+esp_err_t hid_output_consumer(uint16_t usage)
+{
+    return hid_output_consumer_batch(&usage, 1);
+}
+
+esp_err_t hid_output_consumer_batch(const uint16_t *usages, size_t n)
+{
+    hid_job_t job = {.type = JOB_CONSUMER, .consumer = {.n = n}};
+
+    if (n == 0 || n > HID_CONSUMER_BATCH_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(job.consumer.usages, usages, n * sizeof(usages[0]));
+    return enqueue(HID_LANE_INTERACTIVE, &job);
+}
+
+esp_err_t hid_output_mouse(int8_t dx, int8_t dy, uint8_t buttons)
+{
+    hid_job_t job = {.type = JOB_MOUSE, .mouse = {dx, dy, buttons}};
+    return enqueue(HID_LANE_INTERACTIVE, &job);
+}
+
+esp_err_t hid_output_click(uint8_t buttons)
+{
+    hid_job_t job = {.type = JOB_CLICK, .mouse = {0, 0, buttons}};
+    return enqueue(HID_LANE_INTERACTIVE, &job);
+}
+
+esp_err_t hid_output_abs_pointer(uint16_t x, uint16_t y, uint8_t buttons)
+{
+#if CONFIG_EXAMPLE_ABS_POINTER_ENABLE
+    hid_job_t job = {.type = JOB_ABS_POINTER, .abs = {x, y, buttons}};
+
+    if (x > HID_ABS_POINTER_MAX || y > HID_ABS_POINTER_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return enqueue(HID_LANE_INTERACTIVE, &job);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t hid_output_key_tap(uint8_t modifier, uint8_t keycode)
+{
+    return hid_output_key_chord(modifier, &keycode, 1);
+}
+
+esp_err_t hid_output_key_chord(uint8_t modifier, const uint8_t *keys, size_t n)
+{
+    hid_job_t job = {.type = JOB_KEY_TAP, .key = {.modifier = modifier, .n = n}};
+
+    if (n > HID_KEY_CHORD_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(job.key.keys, keys, n);
+    return enqueue(HID_LANE_INTERACTIVE, &job);
+}
+
+esp_err_t hid_output_motion(const hid_motion_path_t *path)
+{
+    hid_job_t job = {.type = JOB_MOTION, .motion = *path};
+    return enqueue(HID_LANE_MOTION, &job);
+}
+
+static esp_err_t enqueue_text(hid_job_t *job, const void *text, size_t len)
+{
+    // Single producer: check both resources before committing the bytes
+    if (uxQueueSpacesAvailable(s_lanes[HID_LANE_BULK].queue) == 0 ||
+        xStreamBufferSpacesAvailable(s_text_buf) < len)
+    {
+        s_lanes[HID_LANE_BULK].stats.dropped++;
+        ESP_LOGW(TAG, "Bulk lane full, %u bytes dropped", (unsigned)len);
+        return ESP_ERR_NO_MEM;
+    }
+    xStreamBufferSend(s_text_buf, text, len, 0);
+    return enqueue(HID_LANE_BULK, job);
+}
+
+esp_err_t hid_output_text(const char *text, size_t len)
+{
+    hid_job_t job = {.type = JOB_TEXT, .text = {.len = (uint16_t)len}};
+    return enqueue_text(&job, text, len);
+}
+
+esp_err_t hid_output_text_compressed(const uint8_t *data, size_t len, bool start)
+{
+    hid_job_t job = {.type = JOB_TEXT_Z, .text = {.len = (uint16_t)len, .restart = start}};
+    return enqueue_text(&job, data, len);
+}
+
+esp_err_t hid_output_script(const uint8_t *steps, size_t len, bool start)
+{
+    hid_job_t job = {.type = JOB_SCRIPT, .text = {.len = (uint16_t)len, .restart = start}};
+    return enqueue_text(&job, steps, len);
+}
+
+void hid_output_abort(void)
+{
+    // Jobs queued before this point carry the old generation and get dropped
+    s_bulk_gen++;
+    xTaskNotifyGive(s_task_hdl);
+}
+
+void hid_output_resync(void)
+{
+    // Applied by the output task before its next report
+    s_resync_gen++;
+}
+
+void hid_output_set_protocol(uint8_t mode)
+{
+    if (mode != ESP_HID_PROTOCOL_MODE_BOOT && mode != ESP_HID_PROTOCOL_MODE_REPORT)
+    {
+        return;
+    }
+    s_protocol_req = mode;
+    xTaskNotifyGive(s_task_hdl);
+}
+
+uint8_t hid_output_get_protocol(void)
+{
+    return s_protocol_req;
+}
+
+void hid_output_set_leds(uint8_t leds)
+{
+    // Read when the next character is looked up
+    s_leds = leds;
+}
+
+uint8_t hid_output_get_leds(void)
+{
+    return s_leds;
+}
+
+esp_err_t hid_output_set_nkro(bool enable)
+{
+#if CONFIG_EXAMPLE_NKRO_ENABLE
+    s_nkro_req = enable;
+    xTaskNotifyGive(s_task_hdl);
+    return ESP_OK;
+#else
+    return enable ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+#endif
+}
+
+bool hid_output_get_nkro(void)
+{
+    return s_nkro_req;
+}
+
+/* ───────────────────────── Stats ─────────────────────────────── */
+void hid_output_get_stats(hid_lane_t lane, hid_lane_stats_t *out)
+{
+    *out = s_lanes[lane].stats;
+}
+
+void hid_output_get_lzss_stats(hid_lzss_stats_t *out)
+{
+    *out = s_lzss_stats;
+}
+
+void hid_output_get_typing_stats(bool nkro, hid_typing_stats_t *out)
+{
+    *out = s_typing_stats[nkro ? 1 : 0];
+}
+
+void hid_output_get_dedup_stats(uint8_t report_id, hid_dedup_stats_t *out)
+{
+    *out = report_id <= HID_RPT_ID_MAX ? s_dedup_stats[report_id] : (hid_dedup_stats_t){0};
+}
+
+void hid_output_log_stats(void)
+{
+    static const char *lane_names[HID_LANE_MAX] = {"interactive", "motion", "bulk"};
+
+    ESP_LOGI(TAG, "protocol mode %s", s_protocol == ESP_HID_PROTOCOL_MODE_BOOT ? "boot" : "report");
+
+    for (int lane = 0; lane < HID_LANE_MAX; lane++)
+    {
+        hid_lane_stats_t st;
+        hid_output_get_stats(lane, &st);
+        ESP_LOGI(TAG, "lane %-11s jobs=%" PRIu32 " dropped=%" PRIu32 " reports=%" PRIu32
+                      " latency avg=%" PRIu32 "us max=%" PRIu32 "us",
+                 lane_names[lane], st.jobs, st.dropped, st.reports,
+                 st.jobs ? (uint32_t)(st.latency_total_us / st.jobs) : 0,
+                 st.latency_max_us);
+    }
+
+    for (int id = 1; id <= HID_RPT_ID_MAX; id++)
+    {
+        hid_dedup_stats_t d = s_dedup_stats[id];
+        if (d.sent || d.failed || d.suppressed || d.unroutable)
+        {
+            ESP_LOGI(TAG, "report %d sent=%" PRIu32 " failed=%" PRIu32 " suppressed=%" PRIu32 " (%" PRIu32
+                          " bytes) unroutable=%" PRIu32,
+                     id, d.sent, d.failed, d.suppressed, d.suppressed_bytes, d.unroutable);
+        }
+    }
+
+    for (int nkro = 0; nkro < 2; nkro++)
+    {
+        hid_typing_stats_t t = s_typing_stats[nkro];
+        if (t.chars)
+        {
+            ESP_LOGI(TAG, "typing %s chars=%" PRIu32 " reports=%" PRIu32 " per char=%" PRIu32 ".%02" PRIu32,
+                     nkro ? "nkro" : "6kro", t.chars, t.reports, t.reports / t.chars,
+                     t.reports * 100 / t.chars % 100);
+        }
+    }
+
+    hid_lzss_stats_t z = s_lzss_stats;
+    if (z.bytes_out)
+    {
+        ESP_LOGI(TAG, "lzss in=%" PRIu32 " out=%" PRIu32 " ratio=%" PRIu32 "%% decode=%" PRIu32 "us/KB",
+                 z.bytes_in, z.bytes_out, (uint32_t)(z.bytes_in * 100 / z.bytes_out),
+                 (uint32_t)(z.decode_us * 1024 / z.bytes_out));
+    }
+
+    static const char *mode_names[HID_UNICODE_MODE_MAX] = {"linux", "windows", "mac"};
+    for (int mode = 0; mode < HID_UNICODE_MODE_MAX; mode++)
+    {
+        hid_unicode_stats_t u;
+        hid_unicode_get_stats(mode, &u);
+        if (u.code_points)
+        {
+            ESP_LOGI(TAG, "unicode %-7s code_points=%" PRIu32 " reports/cp=%" PRIu32 " cache_hits=%" PRIu32 "%s",
+                     mode_names[mode], u.code_points, u.reports / u.code_points, u.cache_hits,
+                     (hid_unicode_mode_t)mode == hid_unicode_get_mode() ? " (active)" : "");
+        }
+    }
+}
+
+/* ───────────────────────── Init ─────────────────────────────── */
+esp_err_t hid_output_init(esp_hidd_dev_t *dev)
+{
+    if (s_task_hdl)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_dev = dev;
+
+    s_lanes[HID_LANE_INTERACTIVE].queue = xQueueCreateStatic(INTERACTIVE_QUEUE_LEN, sizeof(hid_job_t),
+                                                             s_interactive_storage,
+                                                             &s_queue_ctl[HID_LANE_INTERACTIVE]);
+    s_lanes[HID_LANE_MOTION].queue = xQueueCreateStatic(MOTION_QUEUE_LEN, sizeof(hid_job_t),
+                                                        s_motion_storage, &s_queue_ctl[HID_LANE_MOTION]);
+    s_lanes[HID_LANE_BULK].queue = xQueueCreateStatic(BULK_QUEUE_LEN, sizeof(hid_job_t),
+                                                      s_bulk_storage, &s_queue_ctl[HID_LANE_BULK]);
+    s_text_buf = xStreamBufferCreateStatic(BULK_TEXT_BUF_SIZE, 1, s_text_buf_storage, &s_text_buf_ctl);
+
+    s_task_hdl = xTaskCreateStaticPinnedToCore(hid_output_task, "hid_output", OUTPUT_TASK_STACK_SIZE, NULL,
+                                               configMAX_PRIORITIES - 3, s_task_stack, &s_task_tcb,
+                                               HID_TASK_CORE);
+    hid_sysmon_register(s_task_hdl, OUTPUT_TASK_STACK_SIZE);
+    return ESP_OK;
+}
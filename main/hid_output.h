@@ -0,0 +1,130 @@
+/*  HID output pipeline: prioritised report lanes feeding esp_hidd
+ *
+ *  Every report leaves the device through one task. Work is queued on a lane
+ *  and the task always serves the highest lane that has a report due, so a
+ *  media key or mouse move never waits behind a long typed string.
+ */
+#ifndef _HID_OUTPUT_H_
+#define _HID_OUTPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_hidd.h"
+#include "hid_motion.h"
+#include "hid_report_map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Most keys one chord can hold; the 6KRO report shows ErrorRollOver beyond 6 */
+#define HID_KEY_CHORD_MAX 16
+
+/* Consumer usages one batch job can carry */
+#define HID_CONSUMER_BATCH_MAX 8
+
+/* Lanes in priority order (lowest index wins) */
+typedef enum
+{
+    HID_LANE_INTERACTIVE = 0, // consumer keys, mouse, single key taps
+    HID_LANE_MOTION,          // interpolated pointer paths
+    HID_LANE_BULK,            // typed text, macros
+    HID_LANE_MAX
+} hid_lane_t;
+
+/* Counters of one lane; latency is measured from enqueue to first report */
+typedef struct
+{
+    uint32_t jobs;
+    uint32_t dropped;
+    uint32_t reports;
+    uint64_t latency_total_us;
+    uint32_t latency_max_us;
+} hid_lane_stats_t;
+
+/* What happened to the reports of one report ID: sent, or dropped and why */
+typedef struct
+{
+    uint32_t sent;             // accepted by the HID stack
+    uint32_t failed;           // rejected by the HID stack, e.g. while disconnected
+    uint32_t suppressed;
+    uint32_t suppressed_bytes; // report payload bytes not sent
+    uint32_t unroutable;       // dropped, the report does not exist in Boot Protocol mode
+} hid_dedup_stats_t;
+
+/* Typed characters and the keyboard reports they took, per report format */
+typedef struct
+{
+    uint32_t chars;
+    uint32_t reports;
+} hid_typing_stats_t;
+
+/* Compressed text decode counters */
+typedef struct
+{
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint64_t decode_us;
+} hid_lzss_stats_t;
+
+esp_err_t hid_output_init(esp_hidd_dev_t *dev);
+
+/* Interactive lane */
+esp_err_t hid_output_consumer(uint16_t usage);
+/* Taps the usages in order, pressing as many together as the reports allow */
+esp_err_t hid_output_consumer_batch(const uint16_t *usages, size_t n);
+esp_err_t hid_output_mouse(int8_t dx, int8_t dy, uint8_t buttons);
+esp_err_t hid_output_click(uint8_t buttons);
+esp_err_t hid_output_key_tap(uint8_t modifier, uint8_t keycode);
+/* Presses all keys in one report and releases them together */
+esp_err_t hid_output_key_chord(uint8_t modifier, const uint8_t *keys, size_t n);
+esp_err_t hid_output_abs_pointer(uint16_t x, uint16_t y, uint8_t buttons);
+
+/* Motion lane */
+esp_err_t hid_output_motion(const hid_motion_path_t *path);
+
+/* Bulk lane */
+esp_err_t hid_output_text(const char *text, size_t len);
+/* LZSS chunk (see hid_lzss.h); start resets the decoder for a new stream */
+esp_err_t hid_output_text_compressed(const uint8_t *data, size_t len, bool start);
+/* Whole script steps (hid_proto.h); start puts the tap pacing back to the
+ * configured one for a new script */
+esp_err_t hid_output_script(const uint8_t *steps, size_t len, bool start);
+
+/* Cancels the in-flight and queued bulk work and releases every held key */
+void hid_output_abort(void);
+
+/* Forgets the last report sent per ID, so the next one always goes out.
+ * Call on (re)connect and when the protocol mode changes. */
+void hid_output_resync(void);
+
+/* ESP_HID_PROTOCOL_MODE_BOOT or _REPORT, as written by the host. Takes effect
+ * between two reports; held keys are sent again in the new mode. */
+void hid_output_set_protocol(uint8_t mode);
+uint8_t hid_output_get_protocol(void);
+
+/* Keyboard LED output report from the host (HID_LED_* in hid_keymap.h).
+ * Typing follows Caps Lock and turns Num Lock on for Alt codes. */
+void hid_output_set_leds(uint8_t leds);
+uint8_t hid_output_get_leds(void);
+
+/* Selects the keyboard report: the 6-key array or the NKRO bitmap. Takes
+ * effect once no key is held; Boot Protocol mode always uses the array.
+ * With NKRO, text is typed rolling: one report per plain character. */
+esp_err_t hid_output_set_nkro(bool enable);
+bool hid_output_get_nkro(void);
+
+void hid_output_get_stats(hid_lane_t lane, hid_lane_stats_t *out);
+void hid_output_get_lzss_stats(hid_lzss_stats_t *out);
+void hid_output_get_dedup_stats(uint8_t report_id, hid_dedup_stats_t *out);
+void hid_output_get_typing_stats(bool nkro, hid_typing_stats_t *out);
+void hid_output_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_OUTPUT_H_ */
@@ -0,0 +1,122 @@
+/*  Binary command frames for the custom write characteristic
+ *
+ *  A write that starts with HID_PROTO_FRAME_MARKER carries binary frames
+ *  instead of a text command. No text command starts with a NUL byte, so both
+ *  forms share the same characteristic. Several frames may be packed into one
+ *  write:
+ *
+ *      [0x00][opcode][len][payload: len bytes] [0x00][opcode][len]...
+ *
+ *  Multi-byte payload fields are little endian.
+ */
+#ifndef _HID_PROTO_H_
+#define _HID_PROTO_H_
+
+#define HID_PROTO_FRAME_MARKER 0x00
+#define HID_PROTO_FRAME_HDR_LEN 3
+
+typedef enum
+{
+    HID_OP_POS = 0x01,    // u16 x, u16 y [, u8 buttons] – absolute pointer, 0..32767
+    HID_OP_TEXT_Z = 0x02, // u8 flags, LZSS bytes – compressed text chunk (hid_lzss.h), or stored text
+    HID_OP_TIME_SYNC = 0x03, // u8 seq, u64 client us – answered on the clock characteristic
+    HID_OP_CLOCK_SET = 0x04, // i64 offset us (client - esp_timer), u32 round trip us
+    HID_OP_SCRIPT = 0x05,    // u8 flags, script steps – replayed as they arrive
+    HID_OP_MACRO_STORE = 0x06, // u8 slot, u8 flags, script steps – appended to a macro (hid_macro.h)
+    HID_OP_MACRO_RUN = 0x07,   // u8 slot – replays a stored macro
+} hid_proto_op_t;
+
+/* HID_OP_TEXT_Z flags */
+#define HID_TEXT_Z_F_START 0x01  // first chunk of a text, resets the decoder
+#define HID_TEXT_Z_F_STORED 0x02 // plain text, typed as it is and never read as a command
+
+/* Script steps, compiled on the client (PythonClient/hid_script.py) with keys
+ * resolved for the host's layout and all pacing explicit, so the device only
+ * sends the reports. Delays run from a step's report to the next step; a step
+ * never spans two frames:
+ *
+ *      [0x01][u8 delay ms][u8 modifier][u8 n][n keys]  keyboard state, nothing held: all up
+ *      [0x02][u8 modifier][u8 key]                     tap, paced by the last 0x03
+ *      [0x03][u8 press ms][u8 release ms]              tap pacing
+ *      [0x04][u8 delay ms][i8 dx][i8 dy][u8 buttons]   relative mouse
+ *      [0x05][u8 delay ms][u16 usage]                  consumer array, 0 releases
+ *      [0x06][u8 delay ms][u8 bits]                    consumer bitmap (HID_CONSUMER_BIT_USAGES)
+ *      [0x07][u8 delay ms][u16 x][u16 y][u8 buttons]   absolute pointer
+ *      [0x08][u16 ms]                                  wait
+ *
+ * Taps with no modifier or Shift alone follow Caps Lock like typed text,
+ * other taps are sent as compiled; a script ends with all keys up.
+ */
+#define HID_SCRIPT_KEYS 0x01
+#define HID_SCRIPT_TAP 0x02
+#define HID_SCRIPT_TIMING 0x03
+#define HID_SCRIPT_MOUSE 0x04
+#define HID_SCRIPT_CONSUMER 0x05
+#define HID_SCRIPT_CONSUMER_BITS 0x06
+#define HID_SCRIPT_ABS 0x07
+#define HID_SCRIPT_WAIT 0x08
+
+#define HID_SCRIPT_F_START 0x01 // HID_OP_SCRIPT: first chunk, tap pacing back to the config
+#define HID_MACRO_F_START 0x01  // HID_OP_MACRO_STORE: first chunk, the slot starts empty
+#define HID_MACRO_F_END 0x02    // last chunk, the slot is saved
+
+/* Status characteristic (read / notify), sent again whenever a field changes:
+ *
+ *      [u8 keyboard LEDs, HID_LED_*][u8 protocol mode: 0 boot, 1 report]
+ */
+#define HID_STATUS_LEN 2
+
+/* Clock characteristic (notify), see hid_sched.h:
+ *
+ *      [0x01][u8 seq][u64 client send][u64 device receive][u64 device send]
+ *      [0x02][u64 due, client us][i32 late us][u32 uncertainty us]
+ *
+ * The first answers HID_OP_TIME_SYNC, the second reports an 'at' command
+ * that ran; late saturates at INT32_MAX (about 35 minutes) and uncertainty is
+ * 0xFFFFFFFF while the clock is not synced.
+ */
+#define HID_TIME_SYNC_LEN 9
+#define HID_CLOCK_MSG_SYNC 0x01
+#define HID_CLOCK_SYNC_REPLY_LEN 26
+#define HID_CLOCK_MSG_EXEC 0x02
+#define HID_CLOCK_EXEC_LEN 17
+
+/* Stats characteristic (read), see hid_boot.h:
+ *
+ *      [u8 n][u32 us since reset] x n
+ *
+ * One time per boot phase, in hid_boot_phase_t order; HID_STATS_NOT_REACHED
+ * for a phase not reached yet.
+ */
+#define HID_STATS_PHASES 9
+#define HID_STATS_NOT_REACHED 0xFFFFFFFF
+#define HID_STATS_LEN (1 + 4 * HID_STATS_PHASES)
+
+/* Config characteristic (read / write, encrypted link), see hid_config.h:
+ *
+ *  write [0x01]([u8 key][u8 len][value])...  set keys, all or none
+ *        [0x02]                              restore defaults
+ *        [0x03][u8 view][u8 from]            what reads return, from key index
+ *  read  [u8 version][u8 view][u8 from][u8 key count] then per key
+ *        values: [u8 key][u8 len][value]
+ *        schema: [u8 key][u8 type][u8 flags][u32 min][u32 max][u8 n][name]
+ *
+ * Values are little endian, strings carry no terminator. Values always fit
+ * one read (secret keys are left out); the schema is paged, keys that do not
+ * fit are read again from the next index. Refused writes get an ATT error and
+ * leave the record unchanged.
+ */
+#define HID_CFG_OP_SET 0x01
+#define HID_CFG_OP_RESET 0x02
+#define HID_CFG_OP_VIEW 0x03
+#define HID_CFG_VIEW_VALUES 0
+#define HID_CFG_VIEW_SCHEMA 1
+#define HID_CFG_TYPE_U8 1
+#define HID_CFG_TYPE_U16 2
+#define HID_CFG_TYPE_U32 3
+#define HID_CFG_TYPE_STR 4
+#define HID_CFG_F_REBOOT 0x01 // takes effect at the next boot
+#define HID_CFG_F_SECRET 0x02 // write only
+#define HID_CONFIG_READ_MAX 240
+
+#endif /* _HID_PROTO_H_ */
@@ -0,0 +1,240 @@
+/*  Report map of the device and the packed reports it describes
+ *
+ *  Each report is a field list (see hid_descriptor.h) next to the struct the
+ *  output pipeline fills in; a struct that drifts from its fields does not
+ *  compile. Collections are listed in report ID order. host_sim's
+ *  report_map_check parses the bytes of HID_REPORT_MAP back into report
+ *  lengths and compares them with the structs, independently of the lists.
+ */
+#ifndef _HID_REPORT_MAP_H_
+#define _HID_REPORT_MAP_H_
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "hid_descriptor.h"
+#include "hid_keymap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Report IDs used in consumer_map */
+#define HID_RPT_ID_CONSUMER 1
+#define HID_RPT_ID_MOUSE 2
+#define HID_RPT_ID_KEYBOARD 3
+#define HID_RPT_ID_ABS_POINTER 4
+#define HID_RPT_ID_NKRO 5
+#define HID_RPT_ID_CONSUMER_BITS 6
+
+#define HID_RPT_ID_MAX 6
+
+/* Consumer usages pressed at once: up to HID_CONSUMER_SLOTS from the array
+ * report plus every usage of the bitmap report */
+#define HID_CONSUMER_SLOTS 3
+
+/* NKRO keyboard: modifier byte + one bit per usage 0..HID_NKRO_KEYS-1 */
+#define HID_NKRO_KEYS 104
+#define HID_NKRO_BITMAP_LEN (HID_NKRO_KEYS / 8)
+
+#define HID_ABS_POINTER_MAX 32767
+
+/* ───────────────────────── Consumer Control (ID 1) ──────────────────────── */
+#define HID_CONSUMER_FIELDS(F)                                                                 \
+    F(HID_LOGICAL_MIN(0) HID_LOGICAL_MAX16(0x3FF) HID_USAGE_MIN(0) HID_USAGE_MAX16(0x3FF), 16, \
+      HID_CONSUMER_SLOTS, HID_MAIN_INPUT, HID_DATA_ARRAY)
+
+typedef struct __attribute__((packed))
+{
+    uint16_t usages[HID_CONSUMER_SLOTS];
+} hid_consumer_report_t;
+
+#define HID_CONSUMER_COLLECTION                \
+    HID_USAGE_PAGE(HID_PAGE_CONSUMER)          \
+    HID_USAGE(HID_CONSUMER_CONTROL)            \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION) \
+    HID_REPORT_ID(HID_RPT_ID_CONSUMER)         \
+    HID_CONSUMER_FIELDS(HID_FIELD_ITEMS)       \
+    HID_END_COLLECTION
+
+/* ───────────────────────── Mouse (ID 2) ──────────────────────── */
+#define HID_MOUSE_FIELDS(F)                                                                           \
+    F(HID_USAGE_PAGE(HID_PAGE_BUTTON) HID_USAGE_MIN(1) HID_USAGE_MAX(3) HID_LOGICAL_MIN(0)            \
+          HID_LOGICAL_MAX(1),                                                                         \
+      1, 3, HID_MAIN_INPUT, HID_DATA_VAR_ABS)                                                         \
+    F(, 5, 1, HID_MAIN_INPUT, HID_CONST_VAR_ABS)                                                      \
+    F(HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP) HID_USAGE(HID_GD_X) HID_USAGE(HID_GD_Y)                \
+          HID_LOGICAL_MIN(-127) HID_LOGICAL_MAX(127),                                                 \
+      8, 2, HID_MAIN_INPUT, HID_DATA_VAR_REL)
+
+/* Also the Boot Protocol mouse report */
+typedef struct __attribute__((packed))
+{
+    uint8_t buttons;
+    int8_t dx;
+    int8_t dy;
+} hid_mouse_report_t;
+
+#define HID_MOUSE_COLLECTION                      \
+    HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP)      \
+    HID_USAGE(HID_GD_MOUSE)                       \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION)    \
+    HID_REPORT_ID(HID_RPT_ID_MOUSE)               \
+    HID_USAGE(HID_GD_POINTER)                     \
+    HID_COLLECTION(HID_COLLECTION_PHYSICAL)       \
+    HID_MOUSE_FIELDS(HID_FIELD_ITEMS)             \
+    HID_END_COLLECTION                            \
+    HID_END_COLLECTION
+
+/* ───────────────────────── Keyboard (ID 3) ──────────────────────── */
+#define HID_KEYBOARD_FIELDS(F)                                                                        \
+    F(HID_USAGE_PAGE(HID_PAGE_KEYBOARD) HID_USAGE_MIN(0xE0) HID_USAGE_MAX(0xE7) HID_LOGICAL_MIN(0)    \
+          HID_LOGICAL_MAX(1),                                                                         \
+      1, 8, HID_MAIN_INPUT, HID_DATA_VAR_ABS)                                                         \
+    F(, 8, 1, HID_MAIN_INPUT, HID_CONST_VAR_ABS)                                                      \
+    F(HID_USAGE_PAGE(HID_PAGE_LEDS) HID_USAGE_MIN(1) HID_USAGE_MAX(5), 1, 5, HID_MAIN_OUTPUT,         \
+      HID_DATA_VAR_ABS)                                                                               \
+    F(, 3, 1, HID_MAIN_OUTPUT, HID_CONST_VAR_ABS)                                                     \
+    F(HID_LOGICAL_MAX(0x65) HID_USAGE_PAGE(HID_PAGE_KEYBOARD) HID_USAGE_MIN(0) HID_USAGE_MAX(0x65), 8, \
+      6, HID_MAIN_INPUT, HID_DATA_ARRAY)
+
+/* Also the Boot Protocol keyboard report */
+typedef struct __attribute__((packed))
+{
+    uint8_t modifier;
+    uint8_t reserved;
+    uint8_t keys[6];
+} hid_keyboard_report_t;
+
+/* Output report: HID_LED_* bits */
+typedef struct __attribute__((packed))
+{
+    uint8_t leds;
+} hid_keyboard_leds_t;
+
+#define HID_KEYBOARD_COLLECTION                \
+    HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP)   \
+    HID_USAGE(HID_GD_KEYBOARD)                 \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION) \
+    HID_REPORT_ID(HID_RPT_ID_KEYBOARD)         \
+    HID_KEYBOARD_FIELDS(HID_FIELD_ITEMS)       \
+    HID_END_COLLECTION
+
+/* ───────────────────────── Absolute Pointer (ID 4) ──────────────────────── */
+#define HID_ABS_POINTER_FIELDS(F)                                                                     \
+    F(HID_USAGE_PAGE(HID_PAGE_BUTTON) HID_USAGE_MIN(1) HID_USAGE_MAX(3) HID_LOGICAL_MIN(0)            \
+          HID_LOGICAL_MAX(1),                                                                         \
+      1, 3, HID_MAIN_INPUT, HID_DATA_VAR_ABS)                                                         \
+    F(, 5, 1, HID_MAIN_INPUT, HID_CONST_VAR_ABS)                                                      \
+    F(HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP) HID_USAGE(HID_GD_X) HID_USAGE(HID_GD_Y)                \
+          HID_LOGICAL_MIN(0) HID_LOGICAL_MAX16(HID_ABS_POINTER_MAX),                                  \
+      16, 2, HID_MAIN_INPUT, HID_DATA_VAR_ABS)
+
+typedef struct __attribute__((packed))
+{
+    uint8_t buttons;
+    uint16_t x;
+    uint16_t y;
+} hid_abs_pointer_report_t;
+
+/* Tablet style: a mouse collection with absolute axes */
+#define HID_ABS_POINTER_COLLECTION             \
+    HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP)   \
+    HID_USAGE(HID_GD_MOUSE)                    \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION) \
+    HID_REPORT_ID(HID_RPT_ID_ABS_POINTER)      \
+    HID_USAGE(HID_GD_POINTER)                  \
+    HID_COLLECTION(HID_COLLECTION_PHYSICAL)    \
+    HID_ABS_POINTER_FIELDS(HID_FIELD_ITEMS)    \
+    HID_END_COLLECTION                         \
+    HID_END_COLLECTION
+
+/* ───────────────────────── NKRO Keyboard (ID 5) ──────────────────────── */
+#define HID_NKRO_FIELDS(F)                                                                            \
+    F(HID_USAGE_PAGE(HID_PAGE_KEYBOARD) HID_USAGE_MIN(0xE0) HID_USAGE_MAX(0xE7) HID_LOGICAL_MIN(0)    \
+          HID_LOGICAL_MAX(1),                                                                         \
+      1, 8, HID_MAIN_INPUT, HID_DATA_VAR_ABS)                                                         \
+    F(HID_USAGE_MIN(0) HID_USAGE_MAX(HID_NKRO_KEYS - 1), 1, HID_NKRO_KEYS, HID_MAIN_INPUT,            \
+      HID_DATA_VAR_ABS)
+
+typedef struct __attribute__((packed))
+{
+    uint8_t modifier;
+    uint8_t keys[HID_NKRO_BITMAP_LEN]; // bit n of byte n / 8 is key code n
+} hid_nkro_report_t;
+
+#define HID_NKRO_COLLECTION                    \
+    HID_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP)   \
+    HID_USAGE(HID_GD_KEYBOARD)                 \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION) \
+    HID_REPORT_ID(HID_RPT_ID_NKRO)             \
+    HID_NKRO_FIELDS(HID_FIELD_ITEMS)           \
+    HID_END_COLLECTION
+
+/* ───────────────────────── Consumer Bitmap (ID 6) ──────────────────────── */
+/* Bit n of the report is the n-th usage */
+#define HID_CONSUMER_BIT_USAGES(U) \
+    U(VOLUME_UP)                   \
+    U(VOLUME_DOWN)                 \
+    U(MUTE)                        \
+    U(PLAY_PAUSE)                  \
+    U(SCAN_NEXT)                   \
+    U(SCAN_PREVIOUS)               \
+    U(STOP)
+
+#define HID_COUNT_ONE(x) +1
+#define HID_CONSUMER_BITS (0 HID_CONSUMER_BIT_USAGES(HID_COUNT_ONE))
+
+#define HID_CONSUMER_BITS_FIELDS(F)                                                                   \
+    F(HID_LOGICAL_MIN(0) HID_LOGICAL_MAX(1) HID_CONSUMER_BIT_USAGES(HID_USAGE), 1, HID_CONSUMER_BITS, \
+      HID_MAIN_INPUT, HID_DATA_VAR_ABS)                                                               \
+    F(, 1, 8 - HID_CONSUMER_BITS, HID_MAIN_INPUT, HID_CONST_VAR_ABS)
+
+typedef struct __attribute__((packed))
+{
+    uint8_t bits;
+} hid_consumer_bits_report_t;
+
+#define HID_CONSUMER_BITS_COLLECTION           \
+    HID_USAGE_PAGE(HID_PAGE_CONSUMER)          \
+    HID_USAGE(HID_CONSUMER_CONTROL)            \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION) \
+    HID_REPORT_ID(HID_RPT_ID_CONSUMER_BITS)    \
+    HID_CONSUMER_BITS_FIELDS(HID_FIELD_ITEMS)  \
+    HID_END_COLLECTION
+
+/* ───────────────────────── Report Map ──────────────────────── */
+#if CONFIG_EXAMPLE_ABS_POINTER_ENABLE
+#define HID_ABS_POINTER_MAP HID_ABS_POINTER_COLLECTION
+#else
+#define HID_ABS_POINTER_MAP
+#endif
+#if CONFIG_EXAMPLE_NKRO_ENABLE
+#define HID_NKRO_MAP HID_NKRO_COLLECTION
+#else
+#define HID_NKRO_MAP
+#endif
+
+/* Contents of the report map array, as the device registers it */
+#define HID_REPORT_MAP        \
+    HID_CONSUMER_COLLECTION   \
+    HID_MOUSE_COLLECTION      \
+    HID_KEYBOARD_COLLECTION   \
+    HID_ABS_POINTER_MAP       \
+    HID_NKRO_MAP              \
+    HID_CONSUMER_BITS_COLLECTION
+
+/* ───────────────────────── Checks ──────────────────────── */
+HID_CHECK_INPUT(hid_consumer_report_t, HID_CONSUMER_FIELDS);
+HID_CHECK_INPUT(hid_mouse_report_t, HID_MOUSE_FIELDS);
+HID_CHECK_INPUT(hid_keyboard_report_t, HID_KEYBOARD_FIELDS);
+HID_CHECK_OUTPUT(hid_keyboard_leds_t, HID_KEYBOARD_FIELDS);
+HID_CHECK_INPUT(hid_abs_pointer_report_t, HID_ABS_POINTER_FIELDS);
+HID_CHECK_INPUT(hid_nkro_report_t, HID_NKRO_FIELDS);
+HID_CHECK_INPUT(hid_consumer_bits_report_t, HID_CONSUMER_BITS_FIELDS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_REPORT_MAP_H_ */
@@ -0,0 +1,208 @@
+/*  Scan result store shared by BLE and BR/EDR discovery
+ */
+#include <string.h>
+
+#include "hid_scan_store.h"
+
+#if !CONFIG_BT_NIMBLE_ENABLED
+#define HASH_SIZE 64 // power of two, at least twice the pool
+#define HASH_EMPTY 0xff
+#define NAME_ARENA 1024
+#define RSSI_SHIFT 2 // running average weight 1/4
+
+/* ───────────────────────── Globals ─────────────────────────────── */
+static esp_hid_scan_result_t s_pool[HID_SCAN_POOL_SIZE];
+static struct
+{
+    uint32_t seen;   // s_clock at the last report
+    int16_t rssi_q4; // averaged RSSI in 1/16 dBm
+} s_meta[HID_SCAN_POOL_SIZE];
+static uint8_t s_hash[HASH_SIZE] = {[0 ... HASH_SIZE - 1] = HASH_EMPTY}; // pool index
+static uint8_t s_order[HID_SCAN_POOL_SIZE]; // pool indices, oldest arrival first
+static uint8_t s_count;
+static uint32_t s_clock;
+static char s_names[NAME_ARENA];
+static size_t s_names_len;
+static hid_scan_stats_t s_stats;
+
+/* ───────────────────────── Hash ────────────────────────────── */
+static uint32_t hash_of(const esp_bd_addr_t bda, esp_hid_transport_t transport)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < ESP_BD_ADDR_LEN; i++)
+    {
+        h = (h ^ bda[i]) * 16777619u;
+    }
+    h = (h ^ transport) * 16777619u;
+    return (h ^ (h >> 16)) & (HASH_SIZE - 1);
+}
+
+/* Returns the pool index, or -1 with *slot at the free slot it would take */
+static int lookup(const esp_bd_addr_t bda, esp_hid_transport_t transport, uint32_t *slot)
+{
+    uint32_t h = hash_of(bda, transport);
+    // The table is twice the pool, so there is always an empty slot to stop at
+    while (s_hash[h] != HASH_EMPTY)
+    {
+        esp_hid_scan_result_t *r = &s_pool[s_hash[h]];
+        if (r->transport == transport && memcmp(bda, r->bda, sizeof(esp_bd_addr_t)) == 0)
+        {
+            break;
+        }
+        h = (h + 1) & (HASH_SIZE - 1);
+    }
+    if (slot)
+    {
+        *slot = h;
+    }
+    return s_hash[h] == HASH_EMPTY ? -1 : s_hash[h];
+}
+
+/* Linear-probing delete: pull later entries back so no probe chain breaks */
+static void unhash(uint32_t slot)
+{
+    uint32_t next = slot;
+    s_hash[slot] = HASH_EMPTY;
+    while (1)
+    {
+        next = (next + 1) & (HASH_SIZE - 1);
+        if (s_hash[next] == HASH_EMPTY)
+        {
+            return;
+        }
+        esp_hid_scan_result_t *r = &s_pool[s_hash[next]];
+        uint32_t home = hash_of(r->bda, r->transport);
+        if (((next - home) & (HASH_SIZE - 1)) >= ((next - slot) & (HASH_SIZE - 1)))
+        {
+            s_hash[slot] = s_hash[next];
+            s_hash[next] = HASH_EMPTY;
+            slot = next;
+        }
+    }
+}
+
+/* Frees the least recently heard entry and returns its pool index */
+static uint8_t evict(void)
+{
+    uint8_t idx = 0, pos = 0;
+    uint32_t slot;
+
+    for (uint8_t i = 1; i < HID_SCAN_POOL_SIZE; i++)
+    {
+        if (s_meta[i].seen < s_meta[idx].seen)
+        {
+            idx = i;
+        }
+    }
+    lookup(s_pool[idx].bda, s_pool[idx].transport, &slot);
+    unhash(slot);
+    while (s_order[pos] != idx)
+    {
+        pos++;
+    }
+    memmove(&s_order[pos], &s_order[pos + 1], s_count - 1 - pos);
+    s_count--;
+    s_stats.evicted++;
+    return idx;
+}
+
+/* ───────────────────────── API ────────────────────────────── */
+void hid_scan_store_reset(void)
+{
+    memset(s_hash, HASH_EMPTY, sizeof(s_hash));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_count = 0;
+    s_clock = 0;
+    s_names_len = 0;
+}
+
+esp_hid_scan_result_t *hid_scan_store_find(const esp_bd_addr_t bda, esp_hid_transport_t transport)
+{
+    int idx = lookup(bda, transport, NULL);
+    return idx < 0 ? NULL : &s_pool[idx];
+}
+
+esp_hid_scan_result_t *hid_scan_store_add(const esp_bd_addr_t bda, esp_hid_transport_t transport, int rssi)
+{
+    uint32_t slot;
+    // Entries are never freed one by one, so below a full pool the next one is unused
+    uint8_t idx = s_count < HID_SCAN_POOL_SIZE ? s_count : evict();
+
+    lookup(bda, transport, &slot);
+    s_hash[slot] = idx;
+    s_order[s_count++] = idx;
+
+    esp_hid_scan_result_t *r = &s_pool[idx];
+    memset(r, 0, sizeof(*r));
+    memcpy(r->bda, bda, sizeof(esp_bd_addr_t));
+    r->transport = transport;
+    hid_scan_store_heard(r, rssi);
+    return r;
+}
+
+void hid_scan_store_heard(esp_hid_scan_result_t *r, int rssi)
+{
+    int idx = r - s_pool;
+    s_meta[idx].seen = ++s_clock;
+    s_stats.reports++;
+    if (rssi == 0)
+    {
+        return;
+    }
+    if (r->rssi == 0)
+    {
+        s_meta[idx].rssi_q4 = rssi * 16;
+    }
+    else
+    {
+        s_meta[idx].rssi_q4 += (rssi * 16 - s_meta[idx].rssi_q4) / (1 << RSSI_SHIFT);
+    }
+    r->rssi = s_meta[idx].rssi_q4 / 16;
+}
+
+/* Devices often share a name, so equal names share one copy */
+const char *hid_scan_store_name(const uint8_t *name, uint8_t name_len)
+{
+    size_t off = 0;
+    while (off < s_names_len)
+    {
+        size_t n = strlen(&s_names[off]);
+        if (n == name_len && memcmp(&s_names[off], name, name_len) == 0)
+        {
+            return &s_names[off];
+        }
+        off += n + 1;
+    }
+    if (s_names_len + name_len + 1 > sizeof(s_names))
+    {
+        s_stats.names_dropped++;
+        return NULL;
+    }
+    char *s = &s_names[s_names_len];
+    memcpy(s, name, name_len);
+    s[name_len] = 0;
+    s_names_len += name_len + 1;
+    return s;
+}
+
+size_t hid_scan_store_count(void)
+{
+    return s_count;
+}
+
+esp_hid_scan_result_t *hid_scan_store_results(void)
+{
+    esp_hid_scan_result_t *head = NULL;
+    for (int i = s_count - 1; i >= 0; i--)
+    {
+        s_pool[s_order[i]].next = head;
+        head = &s_pool[s_order[i]];
+    }
+    return head;
+}
+
+void hid_scan_store_get_stats(hid_scan_stats_t *out)
+{
+    *out = s_stats;
+}
+#endif /* !CONFIG_BT_NIMBLE_ENABLED */
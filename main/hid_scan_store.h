@@ -0,0 +1,57 @@
+/*  Scan result store shared by BLE and BR/EDR discovery (Bluedroid builds)
+ *
+ *  A fixed pool of results found through an open-addressed hash on address
+ *  and transport, so each report costs the same however many devices are
+ *  around. Names are interned into an arena. A full pool gives up its least
+ *  recently heard entry; the arena is only reclaimed by a reset. Callers
+ *  serialise access (esp_hid_gap.c feeds it from the BTC task).
+ */
+#ifndef _HID_SCAN_STORE_H_
+#define _HID_SCAN_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "esp_hid_gap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !CONFIG_BT_NIMBLE_ENABLED
+#define HID_SCAN_POOL_SIZE 32
+
+typedef struct
+{
+    uint32_t reports;
+    uint32_t evicted;
+    uint32_t names_dropped;
+} hid_scan_stats_t;
+
+void hid_scan_store_reset(void);
+
+esp_hid_scan_result_t *hid_scan_store_find(const esp_bd_addr_t bda, esp_hid_transport_t transport);
+
+/* Zeroed result for a new address, heard once; evicts when the pool is full */
+esp_hid_scan_result_t *hid_scan_store_add(const esp_bd_addr_t bda, esp_hid_transport_t transport, int rssi);
+
+/* Marks r as just heard and folds rssi (0: not reported) into its average */
+void hid_scan_store_heard(esp_hid_scan_result_t *r, int rssi);
+
+/* Shared copy of name, NULL when the arena is full */
+const char *hid_scan_store_name(const uint8_t *name, uint8_t name_len);
+
+size_t hid_scan_store_count(void);
+
+/* Chains the results through next in arrival order, oldest first */
+esp_hid_scan_result_t *hid_scan_store_results(void);
+
+void hid_scan_store_get_stats(hid_scan_stats_t *out);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_SCAN_STORE_H_ */
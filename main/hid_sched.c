@@ -0,0 +1,205 @@
+/*  Scheduled commands on the client's clock
+ */
+#include <inttypes.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "hid_cmd.h"
+#include "hid_proto.h"
+#include "hid_sched.h"
+
+static const char *TAG = "HID_SCHED";
+
+// Commands further out or further in the past than this are refused, they are
+// almost always a unit mix-up
+#define SCHED_HORIZON_US (24LL * 3600 * 1000000)
+
+typedef struct
+{
+    int64_t due_us; // esp_timer clock
+    uint8_t len;
+    char cmd[HID_SCHED_CMD_MAX];
+} sched_entry_t;
+
+// s_entries[0 .. s_count) sorted by due time; guarded by s_lock, which is
+// taken by the command task (add) and the esp_timer task (run)
+static sched_entry_t s_entries[HID_SCHED_MAX];
+static uint8_t s_count;
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+static esp_timer_handle_t s_timer;
+static hid_sched_notify_t s_notify;
+
+static int64_t s_offset_us;
+static uint32_t s_rtt_us;
+static bool s_synced;
+
+static struct
+{
+    uint32_t syncs;
+    uint32_t scheduled;
+    uint32_t executed;
+    uint32_t rejected;
+    int64_t late_max_us;
+    int64_t late_sum_us;
+} s_stats;
+
+/* ───────────────────────── Clock ────────────────────────────── */
+void hid_sched_sync_request(const uint8_t *payload, size_t len, int64_t rx_us)
+{
+    uint8_t msg[HID_CLOCK_SYNC_REPLY_LEN];
+
+    if (len < HID_TIME_SYNC_LEN || !s_notify)
+    {
+        return;
+    }
+    // Echo seq and the client's send time, add our receive and send times
+    msg[0] = HID_CLOCK_MSG_SYNC;
+    memcpy(msg + 1, payload, HID_TIME_SYNC_LEN);
+    memcpy(msg + 10, &rx_us, sizeof(rx_us));
+    int64_t tx_us = esp_timer_get_time();
+    memcpy(msg + 18, &tx_us, sizeof(tx_us));
+    s_notify(msg, sizeof(msg));
+    s_stats.syncs++;
+}
+
+void hid_sched_set_clock(int64_t offset_us, uint32_t rtt_us)
+{
+    s_offset_us = offset_us;
+    s_rtt_us = rtt_us;
+    s_synced = true;
+    ESP_LOGI(TAG, "Clock offset %" PRId64 " us, +/-%" PRIu32 " us", offset_us, rtt_us / 2);
+}
+
+/* ───────────────────────── Scheduler ────────────────────────────── */
+/* Points the timer at the earliest entry; called with s_lock held */
+static void arm_locked(void)
+{
+    esp_timer_stop(s_timer);
+    if (s_count)
+    {
+        int64_t delay = s_entries[0].due_us - esp_timer_get_time();
+        esp_timer_start_once(s_timer, delay > 0 ? delay : 0);
+    }
+}
+
+static void report_exec(int64_t due_us, int64_t late_us)
+{
+    uint8_t msg[HID_CLOCK_EXEC_LEN];
+    int32_t late = late_us < INT32_MAX ? late_us : INT32_MAX; // a past 'at' can be hours late
+    // Without a sync the device clock is all there is; say so with the uncertainty
+    int64_t due = s_synced ? due_us + s_offset_us : due_us;
+    uint32_t uncertainty = s_synced ? s_rtt_us / 2 : UINT32_MAX;
+
+    msg[0] = HID_CLOCK_MSG_EXEC;
+    memcpy(msg + 1, &due, sizeof(due));
+    memcpy(msg + 9, &late, sizeof(late));
+    memcpy(msg + 13, &uncertainty, sizeof(uncertainty));
+    if (s_notify)
+    {
+        s_notify(msg, sizeof(msg));
+    }
+}
+
+static void sched_timer_cb(void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    while (s_count && s_entries[0].due_us <= now)
+    {
+        sched_entry_t *e = &s_entries[0];
+        int64_t late = now - e->due_us;
+
+        // Same queue as the write characteristic: 'at' only delays a command
+        hid_cmd_submit(HID_CMD_SRC_SCHED, (const uint8_t *)e->cmd, e->len);
+        report_exec(e->due_us, late);
+        s_stats.executed++;
+        s_stats.late_sum_us += late;
+        s_stats.late_max_us = late > s_stats.late_max_us ? late : s_stats.late_max_us;
+
+        memmove(&s_entries[0], &s_entries[1], --s_count * sizeof(s_entries[0]));
+        now = esp_timer_get_time();
+    }
+    arm_locked();
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t hid_sched_at(int64_t t_us, bool relative, const char *cmd, size_t len)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t due;
+
+    if (!relative && !s_synced)
+    {
+        ESP_LOGW(TAG, "Clock not synced, use a relative time");
+        return ESP_ERR_INVALID_STATE;
+    }
+    due = relative ? now + t_us : t_us - s_offset_us;
+    if (len == 0 || len > HID_SCHED_CMD_MAX || due - now > SCHED_HORIZON_US || now - due > SCHED_HORIZON_US)
+    {
+        s_stats.rejected++;
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (due < now)
+    {
+        // Runs at once and is reported as late like any other execution
+        ESP_LOGW(TAG, "Command %" PRId64 " us late already", now - due);
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_count == HID_SCHED_MAX)
+    {
+        xSemaphoreGive(s_lock);
+        s_stats.rejected++;
+        return ESP_ERR_NO_MEM;
+    }
+    int i = s_count;
+    while (i > 0 && s_entries[i - 1].due_us > due)
+    {
+        s_entries[i] = s_entries[i - 1];
+        i--;
+    }
+    s_entries[i].due_us = due;
+    s_entries[i].len = len;
+    memcpy(s_entries[i].cmd, cmd, len);
+    s_count++;
+    s_stats.scheduled++;
+    if (i == 0)
+    {
+        arm_locked();
+    }
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+/* ───────────────────────── Init / Stats ────────────────────────────── */
+void hid_sched_log_stats(void)
+{
+    ESP_LOGI(TAG, "synced=%d offset=%" PRId64 " us +/-%" PRIu32 " us syncs=%" PRIu32, s_synced, s_offset_us,
+             s_rtt_us / 2, s_stats.syncs);
+    ESP_LOGI(TAG, "scheduled=%" PRIu32 " executed=%" PRIu32 " rejected=%" PRIu32 " pending=%u late avg=%" PRId64
+             " us max=%" PRId64 " us",
+             s_stats.scheduled, s_stats.executed, s_stats.rejected, s_count,
+             s_stats.executed ? s_stats.late_sum_us / s_stats.executed : 0, s_stats.late_max_us);
+}
+
+esp_err_t hid_sched_init(hid_sched_notify_t notify)
+{
+    if (s_timer)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_notify = notify;
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+
+    esp_timer_create_args_t args = {
+        .callback = sched_timer_cb,
+        .name = "hid_sched",
+    };
+    return esp_timer_create(&args, &s_timer);
+}
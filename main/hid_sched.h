@@ -0,0 +1,48 @@
+/*  Scheduled commands on the client's clock
+ *
+ *  The client estimates the offset between its clock and esp_timer from
+ *  round-trip timestamps (HID_OP_TIME_SYNC) and hands the result back with
+ *  HID_OP_CLOCK_SET. 'at' commands are then held until their time and fed
+ *  to the command task by a one-shot esp_timer, so devices synced to the
+ *  same client act together whatever the write latency of each link. A time
+ *  already past when the command arrives runs at once. Every execution is
+ *  reported on the clock characteristic with its lateness and the sync
+ *  uncertainty, from which the client works out the skew between devices.
+ */
+#ifndef _HID_SCHED_H_
+#define _HID_SCHED_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_SCHED_MAX 8
+#define HID_SCHED_CMD_MAX 128
+
+/* Sends one clock characteristic message (hid_proto.h) to the client */
+typedef void (*hid_sched_notify_t)(const uint8_t *msg, size_t len);
+
+esp_err_t hid_sched_init(hid_sched_notify_t notify);
+
+/* Answers a HID_OP_TIME_SYNC payload; rx_us is when the write arrived */
+void hid_sched_sync_request(const uint8_t *payload, size_t len, int64_t rx_us);
+
+/* Client clock = esp_timer + offset_us, measured with rtt_us round trip */
+void hid_sched_set_clock(int64_t offset_us, uint32_t rtt_us);
+
+/* Holds cmd until t_us on the client clock, or t_us from now if relative */
+esp_err_t hid_sched_at(int64_t t_us, bool relative, const char *cmd, size_t len);
+
+void hid_sched_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_SCHED_H_ */
@@ -0,0 +1,88 @@
+/*  Task placement and runtime monitoring
+ */
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "hid_sysmon.h"
+
+static const char *TAG = "HID_SYS";
+
+#define MAX_TASKS 6
+
+typedef struct
+{
+    TaskHandle_t task;
+    uint32_t stack_size;
+} sysmon_task_t;
+
+static sysmon_task_t s_tasks[MAX_TASKS];
+static int s_task_count;
+
+void hid_sysmon_register(TaskHandle_t task, uint32_t stack_size)
+{
+    if (task && s_task_count < MAX_TASKS)
+    {
+        s_tasks[s_task_count].task = task;
+        s_tasks[s_task_count].stack_size = stack_size;
+        s_task_count++;
+    }
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/* Busy share of each core: everything the idle task did not get */
+static void log_core_load(void)
+{
+    static configRUN_TIME_COUNTER_TYPE last_total, last_idle[portNUM_PROCESSORS];
+    configRUN_TIME_COUNTER_TYPE total = portGET_RUN_TIME_COUNTER_VALUE();
+    configRUN_TIME_COUNTER_TYPE elapsed = total - last_total;
+
+    last_total = total;
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        configRUN_TIME_COUNTER_TYPE idle = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+        configRUN_TIME_COUNTER_TYPE busy = elapsed - (idle - last_idle[core]);
+
+        last_idle[core] = idle;
+        if (elapsed)
+        {
+            ESP_LOGI(TAG, "core %d load=%" PRIu32 "%%", core, (uint32_t)((uint64_t)busy * 100 / elapsed));
+        }
+    }
+}
+#endif
+
+static void log_stack(TaskHandle_t task, uint32_t stack_size)
+{
+    // High-water mark is the least free stack ever seen, in bytes on ESP-IDF
+    uint32_t free_min = uxTaskGetStackHighWaterMark(task);
+
+    if (stack_size)
+    {
+        ESP_LOGI(TAG, "task %-12s core=%d stack used=%" PRIu32 "/%" PRIu32,
+                 pcTaskGetName(task), (int)xTaskGetCoreID(task), stack_size - free_min, stack_size);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "task %-12s core=%d stack free_min=%" PRIu32,
+                 pcTaskGetName(task), (int)xTaskGetCoreID(task), free_min);
+    }
+}
+
+void hid_sysmon_log(void)
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    log_core_load();
+#endif
+    for (int i = 0; i < s_task_count; i++)
+    {
+        log_stack(s_tasks[i].task, s_tasks[i].stack_size);
+    }
+
+    // The host task belongs to NimBLE; its stack size comes from its own Kconfig
+    TaskHandle_t host = xTaskGetHandle("nimble_host");
+    if (host)
+    {
+        log_stack(host, CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE);
+    }
+}
@@ -0,0 +1,38 @@
+/*  Task placement and runtime monitoring
+ *
+ *  The NimBLE host and controller stay on core 0. Command decoding, keymap
+ *  lookups and report scheduling run on HID_TASK_CORE, in tasks whose stacks
+ *  and control blocks are allocated statically, so long sessions cause no
+ *  heap churn. Registered tasks are reported with their stack high-water
+ *  mark next to the per-core load.
+ */
+#ifndef _HID_SYSMON_H_
+#define _HID_SYSMON_H_
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_FREERTOS_UNICORE
+#define HID_TASK_CORE 0
+#else
+#define HID_TASK_CORE CONFIG_EXAMPLE_HID_TASK_CORE
+#endif
+
+/* Adds a task to the stack report; stack_size in bytes as passed at creation */
+void hid_sysmon_register(TaskHandle_t task, uint32_t stack_size);
+
+/* Logs per-core load since the previous call and stack usage per task */
+void hid_sysmon_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_SYSMON_H_ */
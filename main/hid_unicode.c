@@ -0,0 +1,227 @@
+/*  Unicode typing through the host's input method
+ */
+#include <string.h>
+#include <strings.h>
+
+#include "sdkconfig.h"
+#include "hid_unicode.h"
+
+#define CACHE_SIZE 16 // direct mapped on the code point
+
+static hid_unicode_seq_t s_cache[CACHE_SIZE];
+static hid_unicode_mode_t s_mode = CONFIG_EXAMPLE_UNICODE_MODE;
+static hid_unicode_stats_t s_stats[HID_UNICODE_MODE_MAX];
+
+static const char *const s_mode_names[HID_UNICODE_MODE_MAX] = {"linux", "windows", "mac"};
+
+/* ───────────────────────── UTF-8 ────────────────────────────── */
+bool hid_utf8_feed(hid_utf8_t *u, uint8_t byte, uint32_t *cp)
+{
+    if (byte < 0x80)
+    {
+        u->need = 0;
+        *cp = byte;
+        return true;
+    }
+    if ((byte & 0xC0) == 0x80)
+    {
+        if (u->need == 0)
+        {
+            return false; // stray continuation byte
+        }
+        u->cp = (u->cp << 6) | (byte & 0x3F);
+        if (--u->need)
+        {
+            return false;
+        }
+        *cp = u->cp;
+        return true;
+    }
+
+    if ((byte & 0xE0) == 0xC0)
+    {
+        u->cp = byte & 0x1F;
+        u->need = 1;
+    }
+    else if ((byte & 0xF0) == 0xE0)
+    {
+        u->cp = byte & 0x0F;
+        u->need = 2;
+    }
+    else if ((byte & 0xF8) == 0xF0)
+    {
+        u->cp = byte & 0x07;
+        u->need = 3;
+    }
+    else
+    {
+        u->need = 0;
+    }
+    return false;
+}
+
+/* ───────────────────────── Sequence Builders ────────────────────────────── */
+static void seq_push(hid_unicode_seq_t *seq, uint8_t modifier, uint8_t keycode)
+{
+    if (seq->len < HID_UNICODE_MAX_REPORTS)
+    {
+        seq->reports[seq->len].modifier = modifier;
+        seq->reports[seq->len].keycode = keycode;
+        seq->len++;
+    }
+}
+
+/* Press and release one key while `hold` stays down */
+static void seq_tap(hid_unicode_seq_t *seq, uint8_t hold, uint8_t modifier, uint8_t keycode)
+{
+    seq_push(seq, hold | modifier, keycode);
+    seq_push(seq, hold, 0);
+}
+
+static uint8_t hex_key(uint8_t digit)
+{
+    uint8_t modifier, keycode;
+    keymap_ascii_lookup("0123456789abcdef"[digit & 0xF], &modifier, &keycode);
+    return keycode;
+}
+
+static uint8_t numpad_key(uint8_t digit)
+{
+    return digit ? KEY_KP_1 + digit - 1 : KEY_KP_0;
+}
+
+static void build_linux(hid_unicode_seq_t *seq, uint32_t cp)
+{
+    int shift = 20;
+
+    seq_tap(seq, 0, KEY_MOD_LCTRL | KEY_MOD_LSHIFT, KEY_U);
+    while (shift > 0 && ((cp >> shift) & 0xF) == 0)
+    {
+        shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4)
+    {
+        seq_tap(seq, 0, 0, hex_key(cp >> shift));
+    }
+    seq_tap(seq, 0, 0, KEY_ENTER);
+}
+
+/* Alt, numpad +, then the code in hex. Windows only takes hex codes once the
+ * REG_SZ value EnableHexNumpad = "1" is set under HKCU\Control Panel\Input
+ * Method (and the user has logged on again); decimal Alt codes cannot be
+ * used instead, they go through the OEM or ANSI code page. Up to U+FFFF. */
+static void build_windows(hid_unicode_seq_t *seq, uint32_t cp)
+{
+    int shift = 12;
+
+    seq_push(seq, KEY_MOD_LALT, 0);
+    seq_tap(seq, KEY_MOD_LALT, 0, KEY_KP_PLUS);
+    while (shift > 0 && ((cp >> shift) & 0xF) == 0)
+    {
+        shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4)
+    {
+        uint8_t digit = (cp >> shift) & 0xF;
+        seq_tap(seq, KEY_MOD_LALT, 0, digit < 10 ? numpad_key(digit) : hex_key(digit));
+    }
+    seq_push(seq, 0, 0);
+}
+
+static void build_macos(hid_unicode_seq_t *seq, uint32_t cp)
+{
+    uint16_t units[2];
+    int n = 0;
+
+    if (cp > 0xFFFF)
+    {
+        cp -= 0x10000;
+        units[n++] = 0xD800 | (cp >> 10);
+        units[n++] = 0xDC00 | (cp & 0x3FF);
+    }
+    else
+    {
+        units[n++] = cp;
+    }
+
+    seq_push(seq, KEY_MOD_LALT, 0);
+    for (int u = 0; u < n; u++)
+    {
+        for (int shift = 12; shift >= 0; shift -= 4)
+        {
+            seq_tap(seq, KEY_MOD_LALT, 0, hex_key(units[u] >> shift));
+        }
+    }
+    seq_push(seq, 0, 0);
+}
+
+/* ───────────────────────── Lookup ────────────────────────────── */
+const hid_unicode_seq_t *hid_unicode_lookup(uint32_t cp)
+{
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF) || (s_mode == HID_UNICODE_WINDOWS && cp > 0xFFFF))
+    {
+        return NULL;
+    }
+
+    hid_unicode_seq_t *seq = &s_cache[(cp ^ (cp >> 4)) % CACHE_SIZE];
+    hid_unicode_stats_t *st = &s_stats[s_mode];
+
+    if (seq->cp == cp && seq->mode == s_mode)
+    {
+        st->cache_hits++;
+    }
+    else
+    {
+        memset(seq, 0, sizeof(*seq));
+        seq->cp = cp;
+        seq->mode = s_mode;
+        switch (s_mode)
+        {
+        case HID_UNICODE_WINDOWS:
+            build_windows(seq, cp);
+            break;
+        case HID_UNICODE_MACOS:
+            build_macos(seq, cp);
+            break;
+        default:
+            build_linux(seq, cp);
+            break;
+        }
+    }
+
+    st->code_points++;
+    st->reports += seq->len;
+    return seq;
+}
+
+/* ───────────────────────── Mode / Stats ────────────────────────────── */
+void hid_unicode_set_mode(hid_unicode_mode_t mode)
+{
+    if (mode < HID_UNICODE_MODE_MAX)
+    {
+        s_mode = mode;
+    }
+}
+
+hid_unicode_mode_t hid_unicode_get_mode(void)
+{
+    return s_mode;
+}
+
+bool hid_unicode_mode_from_str(const char *name, hid_unicode_mode_t *mode)
+{
+    for (int i = 0; i < HID_UNICODE_MODE_MAX; i++)
+    {
+        if (strcasecmp(name, s_mode_names[i]) == 0)
+        {
+            *mode = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void hid_unicode_get_stats(hid_unicode_mode_t mode, hid_unicode_stats_t *out)
+{
+    *out = s_stats[mode];
+}
@@ -0,0 +1,67 @@
+/*  Unicode typing through the host's input method
+ *
+ *  Code points the keymap cannot reach are entered with an OS-specific key
+ *  sequence. Each sequence is built once and kept in a small cache, so a
+ *  repeated character is replayed without being encoded again.
+ */
+#ifndef _HID_UNICODE_H_
+#define _HID_UNICODE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hid_keymap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_UNICODE_MAX_REPORTS 20
+
+typedef enum
+{
+    HID_UNICODE_LINUX = 0, // Ctrl+Shift+U, hex digits, Enter (IBus / GTK)
+    HID_UNICODE_WINDOWS,   // Alt held, numpad +, hex code (EnableHexNumpad), up to U+FFFF
+    HID_UNICODE_MACOS,     // Option held, UTF-16 hex ("Unicode Hex Input" source)
+    HID_UNICODE_MODE_MAX
+} hid_unicode_mode_t;
+
+typedef struct
+{
+    uint32_t cp;
+    uint8_t mode;
+    uint8_t len;
+    hid_key_report_t reports[HID_UNICODE_MAX_REPORTS];
+} hid_unicode_seq_t;
+
+typedef struct
+{
+    uint32_t code_points;
+    uint32_t reports;
+    uint32_t cache_hits;
+} hid_unicode_stats_t;
+
+/* Incremental UTF-8 decoder */
+typedef struct
+{
+    uint32_t cp;
+    uint8_t need; // continuation bytes still expected
+} hid_utf8_t;
+
+/* Returns true when byte completes a code point; malformed input is skipped */
+bool hid_utf8_feed(hid_utf8_t *u, uint8_t byte, uint32_t *cp);
+
+void hid_unicode_set_mode(hid_unicode_mode_t mode);
+hid_unicode_mode_t hid_unicode_get_mode(void);
+bool hid_unicode_mode_from_str(const char *name, hid_unicode_mode_t *mode);
+
+/* Cached key sequence for cp in the current mode, NULL if it cannot be typed */
+const hid_unicode_seq_t *hid_unicode_lookup(uint32_t cp);
+
+void hid_unicode_get_stats(hid_unicode_mode_t mode, hid_unicode_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_UNICODE_H_ */
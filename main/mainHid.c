@@ -2,14 +2,30 @@
  *  Replays the commands received over BLE via BLE-HID
  *  Build: idf.py menuconfig → Component-config → Bluetooth → NimBLE
  */
+#include <inttypes.h>
+
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_hidd.h"
 #include "esp_hid_gap.h"
+#include "hid_battery.h"
+#include "hid_boot.h"
+#include "hid_cmd.h"
+#include "hid_config.h"
+#include "hid_l2cap.h"
+#include "hid_output.h"
+#include "hid_proto.h"
+#include "hid_report_map.h"
+#include "hid_sched.h"
+#include "hid_unicode.h"
 
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
 #include "host/ble_hs.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
 
 static const char *TAG = "HID_MIN";
 
@@ -20,282 +36,83 @@ static const char *TAG = "HID_MIN";
 
 #define CUSTOM_CHAR_READ_UUID_BASE {0xB1, 0xC2, 0xD3, 0xE4, 0xF5, 0x06, 0x17, 0x28, 0x39, 0x4A, 0x5B, 0x6C, 0x11, 0x12, 0x13, 0x14}
 
-#define VOLUME_UP (0x00E9)     // Volume Up
-#define VOLUME_DOWN (0x00EA)   // Volume Down
-#define MUTE (0x00E2)          // Mute
-#define PLAY_PAUSE (0x00CD)    // Play/Pause
-#define SCAN_NEXT (0x00B5)     // Scan Next Track
-#define SCAN_PREVIOUS (0x00B6) // Scan Previous Track
-#define STOP (0x00B7)          // Stop
-
-// Modifier Keys
-#define KEY_MOD_NONE 0x00
-#define KEY_MOD_LCTRL 0x01
-#define KEY_MOD_LSHIFT 0x02
-#define KEY_MOD_LALT 0x04
-#define KEY_MOD_LGUI 0x08
-#define KEY_MOD_RCTRL 0x10
-#define KEY_MOD_RSHIFT 0x20
-#define KEY_MOD_RALT 0x40
-#define KEY_MOD_RGUI 0x80
-
-// Letters
-#define KEY_A 0x04
-#define KEY_B 0x05
-#define KEY_C 0x06
-#define KEY_D 0x07
-#define KEY_E 0x08
-#define KEY_F 0x09
-#define KEY_G 0x0A
-#define KEY_H 0x0B
-#define KEY_I 0x0C
-#define KEY_J 0x0D
-#define KEY_K 0x0E
-#define KEY_L 0x0F
-#define KEY_M 0x10
-#define KEY_N 0x11
-#define KEY_O 0x12
-#define KEY_P 0x13
-#define KEY_Q 0x14
-#define KEY_R 0x15
-#define KEY_S 0x16
-#define KEY_T 0x17
-#define KEY_U 0x18
-#define KEY_V 0x19
-#define KEY_W 0x1A
-#define KEY_X 0x1B
-#define KEY_Y 0x1C
-#define KEY_Z 0x1D
-
-// Numbers
-#define KEY_1 0x1E
-#define KEY_2 0x1F
-#define KEY_3 0x20
-#define KEY_4 0x21
-#define KEY_5 0x22
-#define KEY_6 0x23
-#define KEY_7 0x24
-#define KEY_8 0x25
-#define KEY_9 0x26
-#define KEY_0 0x27
-
-// Special Characters
-#define KEY_ENTER 0x28
-#define KEY_ESC 0x29
-#define KEY_BACKSPACE 0x2A
-#define KEY_TAB 0x2B
-#define KEY_SPACE 0x2C
-#define KEY_MINUS 0x2D
-#define KEY_EQUAL 0x2E
-#define KEY_LEFTBRACE 0x2F
-#define KEY_RIGHTBRACE 0x30
-#define KEY_BACKSLASH 0x31
-#define KEY_SEMICOLON 0x33
-#define KEY_APOSTROPHE 0x34
-#define KEY_GRAVE 0x35
-#define KEY_COMMA 0x36
-#define KEY_DOT 0x37
-#define KEY_SLASH 0x38
-
-// Arrow Keys
-#define KEY_RIGHT 0x4F
-#define KEY_LEFT 0x50
-#define KEY_DOWN 0x51
-#define KEY_UP 0x52
-
-// Function Keys
-#define KEY_F1 0x3A
-#define KEY_F2 0x3B
-#define KEY_F3 0x3C
-#define KEY_F4 0x3D
-#define KEY_F5 0x3E
-#define KEY_F6 0x3F
-#define KEY_F7 0x40
-#define KEY_F8 0x41
-#define KEY_F9 0x42
-#define KEY_F10 0x43
-#define KEY_F11 0x44
-#define KEY_F12 0x45
-
-// Other useful keys
-#define KEY_DELETE 0x4C
-#define KEY_HOME 0x4A
-#define KEY_END 0x4D
-#define KEY_PAGEUP 0x4B
-#define KEY_PAGEDOWN 0x4E
-
-typedef struct
-{
-    TaskHandle_t task_hdl;
-    esp_hidd_dev_t *hid_dev;
-    uint8_t protocol_mode;
-    uint8_t *buffer;
-} local_param_t;
-
-static local_param_t s_ble_hid_param = {0};
-
-/* ───────────────────────── Report Map (Consumer-Control) ──────────────────── */
-static const uint8_t consumer_map[] = {
-    // Consumer Control (Report ID 1)
-    0x05, 0x0C, // Usage Page (Consumer Devices)
-    0x09, 0x01, // Usage (Consumer Control)
-    0xA1, 0x01, // Collection (Application)
-    0x85, 0x01, //   Report ID (1)
-    0x15, 0x00,
-    0x26, 0xFF, 0x03, //   Logical Maximum (0x03FF)
-    0x19, 0x00,
-    0x2A, 0xFF, 0x03, //   Usage Maximum
-    0x75, 0x10,       //   Report Size (16)
-    0x95, 0x01,       //   Report Count (1)
-    0x81, 0x00,       //   Input (Data, Array)
-    0xC0,             // End Collection
-
-    // Keyboard (Report ID 3)
-    0x05, 0x01, // Usage Page (Generic Desktop)
-    0x09, 0x06, // Usage (Keyboard)
-    0xA1, 0x01, // Collection (Application)
-    0x85, 0x03, //   Report ID (3)
-    0x05, 0x07, //   Usage Page (Key Codes)
-    0x19, 0xE0, //   Usage Minimum (224)
-    0x29, 0xE7, //   Usage Maximum (231)
-    0x15, 0x00, //   Logical Minimum (0)
-    0x25, 0x01, //   Logical Maximum (1)
-    0x75, 0x01, //   Report Size (1)
-    0x95, 0x08, //   Report Count (8)
-    0x81, 0x02, //   Input (Data, Var, Abs)
-    0x95, 0x01, //   Report Count (1)
-    0x75, 0x08, //   Report Size (8)
-    0x81, 0x03, //   Input (Const, Var, Abs)
-    0x95, 0x06, //   Report Count (6)
-    0x75, 0x08, //   Report Size (8)
-    0x15, 0x00, //   Logical Minimum (0)
-    0x25, 0x65, //   Logical Maximum (101)
-    0x05, 0x07, //   Usage Page (Key Codes)
-    0x19, 0x00, //   Usage Minimum (0)
-    0x29, 0x65, //   Usage Maximum (101)
-    0x81, 0x00, //   Input (Data, Array)
-    0xC0,       // End Collection
-
-    // Mouse (Report ID 2)
-    0x05, 0x01, // Usage Page (Generic Desktop)
-    0x09, 0x02, // Usage (Mouse)
-    0xA1, 0x01, // Collection (Application)
-    0x85, 0x02, //   Report ID (2)
-    0x09, 0x01, //   Usage (Pointer)
-    0xA1, 0x00, //   Collection (Physical)
-    0x05, 0x09, //     Usage Page (Buttons)
-    0x19, 0x01, //     Usage Minimum (Button 1)
-    0x29, 0x03, //     Usage Maximum (Button 3)
-    0x15, 0x00, //     Logical Minimum (0)
-    0x25, 0x01, //     Logical Maximum (1)
-    0x95, 0x03, //     Report Count (3)
-    0x75, 0x01, //     Report Size (1)
-    0x81, 0x02, //     Input (Data, Var, Abs)
-    0x95, 0x01, //     Report Count (1)
-    0x75, 0x05, //     Report Size (5)
-    0x81, 0x03, //     Input (Const, Var, Abs) – padding
-    0x05, 0x01, //     Usage Page (Generic Desktop)
-    0x09, 0x30, //     Usage (X)
-    0x09, 0x31, //     Usage (Y)
-    0x15, 0x81, //     Logical Minimum (-127)
-    0x25, 0x7F, //     Logical Maximum (127)
-    0x75, 0x08, //     Report Size (8)
-    0x95, 0x02, //     Report Count (2)
-    0x81, 0x06, //     Input (Data, Var, Rel)
-    0xC0,       //   End Collection
-    0xC0        // End Collection
-};
+#define CUSTOM_CHAR_CLOCK_UUID_BASE {0xC1, 0xD2, 0xE3, 0xF4, 0x05, 0x16, 0x27, 0x38, 0x49, 0x5A, 0x6B, 0x7C, 0x21, 0x22, 0x23, 0x24}
 
-/* ───────────────────────── Globals ─────────────────────────────── */
-static esp_hidd_dev_t *hid_dev;
+#define CUSTOM_CHAR_STATS_UUID_BASE {0xD1, 0xE2, 0xF3, 0x04, 0x15, 0x26, 0x37, 0x48, 0x59, 0x6A, 0x7B, 0x8C, 0x31, 0x32, 0x33, 0x34}
 
-/* ───────────────────────── Media Keys ─────────────────────────────── */
-static void send_consumer(uint16_t usage)
-{
-    uint8_t rpt[2] = {usage & 0xFF, usage >> 8}; // Little endian
-
-    // Send key press
-    esp_hidd_dev_input_set(hid_dev, 0, 1, rpt, sizeof(rpt));
-    vTaskDelay(pdMS_TO_TICKS(30));
+#define CUSTOM_CHAR_CONFIG_UUID_BASE {0xE1, 0xF2, 0x03, 0x14, 0x25, 0x36, 0x47, 0x58, 0x69, 0x7A, 0x8B, 0x9C, 0x41, 0x42, 0x43, 0x44}
 
-    // Send key release
-    rpt[0] = rpt[1] = 0;
-    esp_hidd_dev_input_set(hid_dev, 0, 1, rpt, sizeof(rpt));
-}
+// Largest single write accepted (matches CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU)
+#define CUSTOM_WRITE_MAX_LEN 256
 
-/* ───────────────────────── Keyboard Function ────────────────────────────── */
-void send_key(uint8_t modifier, uint8_t keycode)
-{
-    uint8_t report[8] = {0};
+// Bump when the attribute table changes in a way the fingerprint cannot see
+#define GATT_LAYOUT_VERSION 1
 
-    report[0] = modifier; // Modifier (e.g., SHIFT)
-    report[2] = keycode;  // Keycode (e.g., G = 0x0A)
 
-    // Press
-    esp_hidd_dev_input_set(hid_dev, 0, 3, report, sizeof(report));
-    vTaskDelay(pdMS_TO_TICKS(20));
+/* ───────────────────────── Report Map ──────────────────── */
+// Collections and their reports are defined in hid_report_map.h
+static const uint8_t consumer_map[] = {HID_REPORT_MAP};
 
-    // Release
-    memset(report, 0, sizeof(report));
-    esp_hidd_dev_input_set(hid_dev, 0, 3, report, sizeof(report));
-    vTaskDelay(pdMS_TO_TICKS(10)); // delay again
-}
-
-/* ───────────────────────── Mouse Function ────────────────────────────── */
-void send_mouse(int8_t dx, int8_t dy, uint8_t buttons)
-{
-    uint8_t mouse_report[4] = {
-        0x02,    // Report ID (2)
-        buttons, // Button bits
-        dx,      // X delta
-        dy       // Y delta
-    };
-
-    esp_hidd_dev_input_set(hid_dev, 0, mouse_report[0], &mouse_report[1], 3);
-}
-
-/* ───────────────────────── simple freeRTOS task ────────────────────────────── */
-//You Can remove it or might be use it for the random purposes
-void ble_hid_task(void *pvParameters)
+/* ───────────────────────── Globals ─────────────────────────────── */
+static esp_hidd_dev_t *hid_dev;
+static uint16_t s_status_val_handle; // status characteristic, see hid_proto.h
+static uint16_t s_clock_val_handle;  // clock characteristic, see hid_proto.h
+static uint16_t s_clock_conn = BLE_HS_CONN_HANDLE_NONE; // last connection that wrote a command
+static uint16_t s_write_val_handle;
+static uint16_t s_stats_val_handle;
+static uint16_t s_config_val_handle;
+static void (*s_prev_sync_cb)(void);
+
+/* Nothing here is needed to advertise or to take a connection, so it waits
+ * until the first host is connected */
+static void deferred_init(void)
 {
-    while (1)
+    esp_err_t err = hid_battery_init(hid_dev, NULL);
+    if (err != ESP_OK)
     {
-        ESP_LOGI(TAG, "Demo Task");
-
-        esp_hidd_dev_battery_set(hid_dev, 10);
-        // send_consumer(VOLUME_DOWN);
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-        // // send_consumer(VOLUME_UP);
-        // send_mouse(10, 0, 0x01); // Move mouse right with left click
-        // vTaskDelay(pdMS_TO_TICKS(20));
-        // send_mouse(0, 0, 0x00); // Release button
+        ESP_LOGI(TAG, "Battery monitor off (%s)", esp_err_to_name(err));
     }
+    hid_boot_mark(HID_BOOT_DEFERRED);
 }
 
-void ble_hid_task_start_up(void)
+/* HID / GAP events: keep advertising, resync report state on connect */
+static void hid_cb(void *arg, esp_event_base_t base, int32_t id, void *data)
 {
-    if (s_ble_hid_param.task_hdl)
-    {
-        // Task already exists
-        return;
-    }
+    static bool deferred_done;
 
-    xTaskCreate(ble_hid_task, "ble_hid_task", 2 * 4096, NULL, configMAX_PRIORITIES - 3,
-                &s_ble_hid_param.task_hdl);
-}
+    esp_hidd_event_data_t *param = (esp_hidd_event_data_t *)data;
 
-/* HID / GAP events: start advertising, spawn task on connect */
-static void hid_cb(void *arg, esp_event_base_t base, int32_t id, void *data)
-{
     switch (id)
     {
     case ESP_HIDD_START_EVENT:
-        esp_hid_ble_gap_adv_start();
+        // Advertising is started by on_sync, which does not wait for this
         break;
     case ESP_HIDD_CONNECT_EVENT:
+        // A new connection starts from an unknown host state, in Report mode
+        hid_output_set_protocol(ESP_HID_PROTOCOL_MODE_REPORT);
+        hid_output_resync();
         esp_hid_ble_gap_adv_start();
-        // xTaskCreate(ble_hid_task, "vol", 4096, NULL, 5, NULL);
-        // ble_hid_task_start_up();
+        hid_boot_mark(HID_BOOT_CONNECTED);
+        if (!deferred_done)
+        {
+            deferred_done = true;
+            deferred_init();
+        }
+        break;
+    case ESP_HIDD_PROTOCOL_MODE_EVENT:
+        ESP_LOGI(TAG, "Protocol mode: %s",
+                 param->protocol_mode.protocol_mode == ESP_HID_PROTOCOL_MODE_BOOT ? "BOOT" : "REPORT");
+        hid_output_set_protocol(param->protocol_mode.protocol_mode);
+        ble_gatts_chr_updated(s_status_val_handle);
+        break;
+    case ESP_HIDD_OUTPUT_EVENT:
+        // Keyboard LEDs, the only output report in the map (boot or report mode)
+        if (param->output.length >= 1 && param->output.data[0] != hid_output_get_leds())
+        {
+            ESP_LOGI(TAG, "LEDs: 0x%02x", param->output.data[0]);
+            hid_output_set_leds(param->output.data[0]);
+            ble_gatts_chr_updated(s_status_val_handle);
+        }
         break;
     case ESP_HIDD_DISCONNECT_EVENT:
         esp_hid_ble_gap_adv_start();
@@ -317,8 +134,19 @@ static void ble_host_task(void *param)
 static int custom_write_cb(uint16_t conn_handle, uint16_t attr_handle,
                            struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
+    int64_t rx_us = esp_timer_get_time();
     uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
-    uint8_t buffer[64] = {0};
+    uint8_t buffer[CUSTOM_WRITE_MAX_LEN] = {0};
+
+    s_clock_conn = conn_handle;
+    // Time sync is answered right here, so queueing never skews the timestamps
+    if (len == HID_PROTO_FRAME_HDR_LEN + HID_TIME_SYNC_LEN &&
+        ble_hs_mbuf_to_flat(ctxt->om, buffer, sizeof(buffer), NULL) == 0 &&
+        buffer[0] == HID_PROTO_FRAME_MARKER && buffer[1] == HID_OP_TIME_SYNC)
+    {
+        hid_sched_sync_request(buffer + HID_PROTO_FRAME_HDR_LEN, HID_TIME_SYNC_LEN, rx_us);
+        return 0;
+    }
 
     printf("---------------------------------------------------------\n");
 
@@ -331,315 +159,240 @@ static int custom_write_cb(uint16_t conn_handle, uint16_t attr_handle,
 
     ESP_LOGI(TAG, "Custom Write received (%d bytes): %.*s", len, len, buffer);
 
-    // Convert to null-terminated string
-    buffer[len] = '\0';
+    // Decoding and reports happen on the HID core, off the host task
+    hid_cmd_submit(HID_CMD_SRC_GATT, buffer, len);
+
+    return 0;
+}
+
+static int custom_status_cb(uint16_t conn_handle, uint16_t attr_handle,
+                            struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    uint8_t status[HID_STATUS_LEN] = {hid_output_get_leds(), hid_output_get_protocol()};
+    return os_mbuf_append(ctxt->om, status, sizeof(status)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+static int custom_stats_cb(uint16_t conn_handle, uint16_t attr_handle,
+                           struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    uint8_t stats[HID_STATS_LEN];
+    size_t len = hid_boot_encode(stats, sizeof(stats));
+    return os_mbuf_append(ctxt->om, stats, len) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+/* Reads return the selected view, writes set keys or select a view (hid_proto.h);
+ * encrypted only, since the record holds the passkey */
+static int custom_config_cb(uint16_t conn_handle, uint16_t attr_handle,
+                            struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    uint8_t buffer[HID_CONFIG_READ_MAX];
+    uint16_t len;
 
-    // Basic command parsing
-    if (strncmp((char *)buffer, "volup", 5) == 0)
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
     {
-        send_consumer(VOLUME_UP);
-        // send_key(KEY_MOD_LSHIFT, KEY_G); // Sends 'G'
+        size_t n = hid_config_read(buffer, sizeof(buffer));
+        return os_mbuf_append(ctxt->om, buffer, n) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
     }
-    else if (strncmp((char *)buffer, "voldown", 7) == 0)
+
+    if (ble_hs_mbuf_to_flat(ctxt->om, buffer, sizeof(buffer), &len) != 0)
     {
-        ESP_LOGI(TAG, "Command parsed");
-        send_consumer(VOLUME_DOWN);
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
     }
-    else if (strncmp((char *)buffer, "mute", 4) == 0)
+    esp_err_t err = hid_config_write(buffer, len);
+    if (err != ESP_OK)
     {
-        send_consumer(MUTE);
-        send_key(KEY_MOD_NONE, KEY_ENTER); // Sends Enter key
+        ESP_LOGW(TAG, "Config write refused (%s)", esp_err_to_name(err));
+        return err == ESP_ERR_INVALID_SIZE ? BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
     }
-    else if (strncmp((char *)buffer, "play", 4) == 0)
+    return 0;
+}
+
+/* Notify only; reads are refused by the stack */
+static int custom_clock_cb(uint16_t conn_handle, uint16_t attr_handle,
+                           struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    return 0;
+}
+
+static void clock_notify(const uint8_t *msg, size_t len)
+{
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(msg, len);
+
+    if (om && ble_gatts_notify_custom(s_clock_conn, s_clock_val_handle, om) != 0)
     {
-        send_consumer(PLAY_PAUSE);
+        ESP_LOGD(TAG, "Clock notification not sent");
     }
-    else if (strncmp((char *)buffer, "next", 4) == 0)
+}
+
+static const struct ble_gatt_svc_def gatt_custom_svcs[] = {
+    {.type = BLE_GATT_SVC_TYPE_PRIMARY,
+     .uuid = BLE_UUID128_DECLARE(CUSTOM_SERVICE_UUID_BASE),
+     .characteristics = (struct ble_gatt_chr_def[]){
+         {
+             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_WRITE_UUID_BASE),
+             .access_cb = custom_write_cb,
+             .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP,
+             .val_handle = &s_write_val_handle,
+         },
+         {
+             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_READ_UUID_BASE),
+             .access_cb = custom_status_cb,
+             .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+             .val_handle = &s_status_val_handle,
+         },
+         {
+             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_CLOCK_UUID_BASE),
+             .access_cb = custom_clock_cb,
+             .flags = BLE_GATT_CHR_F_NOTIFY,
+             .val_handle = &s_clock_val_handle,
+         },
+         {
+             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_STATS_UUID_BASE),
+             .access_cb = custom_stats_cb,
+             .flags = BLE_GATT_CHR_F_READ,
+             .val_handle = &s_stats_val_handle,
+         },
+         {
+             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_CONFIG_UUID_BASE),
+             .access_cb = custom_config_cb,
+             .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC,
+             .val_handle = &s_config_val_handle,
+         },
+         {0} // End
+     }},
+    {0} // End
+};
+
+/* ───────────────────────── GATT Layout ────────────────────────────── */
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len--)
     {
-        send_consumer(SCAN_NEXT);
+        h = (h ^ *p++) * 16777619u;
     }
-    else if (strncmp((char *)buffer, "prev", 4) == 0)
+    return h;
+}
+
+/* Hosts that cached the database (Database Hash / Client Supported Features,
+ * CONFIG_BT_NIMBLE_GATT_CACHING) skip discovery on reconnect. The table is
+ * registered in a fixed order so it only changes with the firmware; when it
+ * does, bonded hosts get Service Changed the next time they connect. */
+static void gatt_layout_check(void)
+{
+    uint32_t version = GATT_LAYOUT_VERSION;
+    uint16_t handles[] = {s_write_val_handle, s_status_val_handle, s_clock_val_handle, s_stats_val_handle,
+                          s_config_val_handle};
+    uint32_t fp = 2166136261u;
+    uint32_t stored = 0;
+    nvs_handle_t nvs;
+
+    fp = fnv1a(fp, &version, sizeof(version));
+    fp = fnv1a(fp, consumer_map, sizeof(consumer_map));
+    fp = fnv1a(fp, handles, sizeof(handles));
+
+    if (nvs_open("hid_gatt", NVS_READWRITE, &nvs) != ESP_OK)
     {
-        send_consumer(SCAN_PREVIOUS);
+        return;
     }
-    else if (strncmp((char *)buffer, "stop", 4) == 0)
+    if (nvs_get_u32(nvs, "layout", &stored) == ESP_OK && stored != fp)
     {
-        ESP_LOGI(TAG, "Command parsed");
-        send_consumer(STOP);
+        ESP_LOGI(TAG, "Attribute table changed (%08" PRIx32 " -> %08" PRIx32 "), indicating Service Changed", stored, fp);
+        ble_svc_gatt_changed(0x0001, 0xffff);
     }
-    else if (strncmp((char *)buffer, "move", 4) == 0)
+    if (stored != fp && nvs_set_u32(nvs, "layout", fp) == ESP_OK)
     {
-        int dx = 0, dy = 0;
-        if (sscanf((char *)buffer + 5, "%d %d", &dx, &dy) == 2)
-        {
-            send_mouse((int8_t)dx, (int8_t)dy, 0);
-        }
-        else
-        {
-            ESP_LOGW(TAG, "Invalid format for 'move' command. Use: move <dx> <dy>");
-        }
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+/* ───────────────────────── Config ────────────────────────────── */
+#define CFG_KEY_IN(key, first, last) ((key) == 0 || ((key) >= (first) && (key) <= (last)))
+
+/* Pushes config changes into the modules; key 0 at registration applies the
+ * whole record. Vendor and product id are only read at boot. */
+static void config_apply(const hid_config_t *c, uint8_t key)
+{
+    if (CFG_KEY_IN(key, HID_CFG_unicode_mode, HID_CFG_unicode_mode))
+    {
+        hid_unicode_set_mode((hid_unicode_mode_t)c->unicode_mode);
     }
-    else if (strncmp((char *)buffer, "click", 5) == 0)
+    if (CFG_KEY_IN(key, HID_CFG_nkro, HID_CFG_nkro))
     {
-        send_mouse(0, 0, 0x01); // Left click down
-        vTaskDelay(pdMS_TO_TICKS(20));
-        send_mouse(0, 0, 0x00); // Release
+        hid_output_set_nkro(c->nkro);
     }
-    else if (strncmp((char *)buffer, "rightclick", 5) == 0)
+    if (CFG_KEY_IN(key, HID_CFG_log_level, HID_CFG_log_level))
     {
-        send_mouse(0, 0, 0x02); // Right click down
-        vTaskDelay(pdMS_TO_TICKS(20));
-        send_mouse(0, 0, 0x00); // Release
+        esp_log_level_set("*", (esp_log_level_t)c->log_level);
     }
-    else
+    if (CFG_KEY_IN(key, HID_CFG_passkey, HID_CFG_passkey))
     {
-        ESP_LOGI(TAG, "Typing string: %s", buffer);
-
-        for (int i = 0; buffer[i] != '\0'; i++)
+        esp_hid_ble_gap_set_passkey(c->passkey);
+    }
+    if (CFG_KEY_IN(key, HID_CFG_conn_itvl_min, HID_CFG_conn_timeout))
+    {
+        esp_hid_ble_gap_set_conn_params(c->conn_itvl_min, c->conn_itvl_max, c->conn_latency, c->conn_timeout);
+    }
+    if (CFG_KEY_IN(key, HID_CFG_adv_itvl_min_ms, HID_CFG_adv_duration_s))
+    {
+        esp_hid_ble_gap_set_adv_params(c->adv_itvl_min_ms, c->adv_itvl_max_ms, c->adv_duration_s * 1000u);
+    }
+    // At boot the name is already in place, later it is re-encoded and re-advertised
+    if (key == HID_CFG_name)
+    {
+        ble_svc_gap_device_name_set(c->name);
+        if (esp_hid_ble_gap_adv_init(ESP_HID_APPEARANCE_GENERIC, c->name) == ESP_OK)
         {
-            char ch = buffer[i];
-            uint8_t keycode = 0;
-            uint8_t modifier = KEY_MOD_NONE;
-
-            if (ch >= 'A' && ch <= 'Z')
-            {
-                keycode = KEY_A + (ch - 'A');
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch >= 'a' && ch <= 'z')
-            {
-                keycode = KEY_A + (ch - 'a');
-            }
-            else if (ch >= '1' && ch <= '9')
-            {
-                keycode = KEY_1 + (ch - '1');
-            }
-            else if (ch == '0')
-            {
-                keycode = KEY_0;
-            }
-            else if (ch == ' ')
-            {
-                keycode = KEY_SPACE;
-            }
-            else if (ch == '\n' || ch == '\r')
-            {
-                keycode = KEY_ENTER;
-            }
-            else if (ch == '\t')
-            {
-                keycode = KEY_TAB;
-            }
-            // Punctuation & Symbols
-            else if (ch == '!')
-            {
-                keycode = KEY_1;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '@')
-            {
-                keycode = KEY_2;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '#')
-            {
-                keycode = KEY_3;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '$')
-            {
-                keycode = KEY_4;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '%')
-            {
-                keycode = KEY_5;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '^')
-            {
-                keycode = KEY_6;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '&')
-            {
-                keycode = KEY_7;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '*')
-            {
-                keycode = KEY_8;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '(')
-            {
-                keycode = KEY_9;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == ')')
-            {
-                keycode = KEY_0;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '-')
-            {
-                keycode = KEY_MINUS;
-            }
-            else if (ch == '_')
-            {
-                keycode = KEY_MINUS;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '=')
-            {
-                keycode = KEY_EQUAL;
-            }
-            else if (ch == '+')
-            {
-                keycode = KEY_EQUAL;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '[')
-            {
-                keycode = KEY_LEFTBRACE;
-            }
-            else if (ch == '{')
-            {
-                keycode = KEY_LEFTBRACE;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == ']')
-            {
-                keycode = KEY_RIGHTBRACE;
-            }
-            else if (ch == '}')
-            {
-                keycode = KEY_RIGHTBRACE;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '\\')
-            {
-                keycode = KEY_BACKSLASH;
-            }
-            else if (ch == '|')
-            {
-                keycode = KEY_BACKSLASH;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == ';')
-            {
-                keycode = KEY_SEMICOLON;
-            }
-            else if (ch == ':')
-            {
-                keycode = KEY_SEMICOLON;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '\'')
-            {
-                keycode = KEY_APOSTROPHE;
-            }
-            else if (ch == '"')
-            {
-                keycode = KEY_APOSTROPHE;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == ',')
-            {
-                keycode = KEY_COMMA;
-            }
-            else if (ch == '<')
-            {
-                keycode = KEY_COMMA;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '.')
-            {
-                keycode = KEY_DOT;
-            }
-            else if (ch == '>')
-            {
-                keycode = KEY_DOT;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '/')
-            {
-                keycode = KEY_SLASH;
-            }
-            else if (ch == '?')
-            {
-                keycode = KEY_SLASH;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else if (ch == '`')
-            {
-                keycode = KEY_GRAVE;
-            }
-            else if (ch == '~')
-            {
-                keycode = KEY_GRAVE;
-                modifier = KEY_MOD_LSHIFT;
-            }
-            else
-            {
-                ESP_LOGW(TAG, "Unsupported char: %c", ch);
-                continue;
-            }
-
-            send_key(modifier, keycode);
-            vTaskDelay(pdMS_TO_TICKS(100));
+            esp_hid_ble_gap_adv_start();
         }
     }
-
-    return 0;
 }
 
-static int custom_read_cb(uint16_t conn_handle, uint16_t attr_handle,
-                          struct ble_gatt_access_ctxt *ctxt, void *arg)
+/* Advertising starts here rather than on the HID start event, so bonded
+ * hosts can reconnect as soon as the host is up */
+static void on_sync(void)
 {
-    const char *response = "Hello from ESP32!";
-    os_mbuf_append(ctxt->om, response, strlen(response));
-    return 0;
+    hid_boot_mark(HID_BOOT_HOST_SYNC);
+    if (esp_hid_ble_gap_adv_start() == 0)
+    {
+        hid_boot_mark(HID_BOOT_ADVERTISING);
+    }
+    gatt_layout_check();
+    if (s_prev_sync_cb)
+    {
+        s_prev_sync_cb();
+    }
 }
-static const struct ble_gatt_svc_def gatt_custom_svcs[] = {
-    {.type = BLE_GATT_SVC_TYPE_PRIMARY,
-     .uuid = BLE_UUID128_DECLARE(CUSTOM_SERVICE_UUID_BASE),
-     .characteristics = (struct ble_gatt_chr_def[]){
-         {
-             .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_WRITE_UUID_BASE),
-             .access_cb = custom_write_cb,
-             .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP,
-
-         },
-         // {
-         //     .uuid = BLE_UUID128_DECLARE(CUSTOM_CHAR_READ_UUID_BASE),
-         //     .access_cb = custom_read_cb,
-         //     .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
-         // },
-         {0} // End
-     }},
-    {0} // End
-};
 
 /* ───────────────────────── app_main ────────────────────────────── */
 void app_main(void)
 {
+    hid_boot_mark(HID_BOOT_APP_MAIN);
+    // The controller reads its PHY calibration from NVS, so this comes first
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(hid_config_init());
+    hid_boot_mark(HID_BOOT_NVS);
     ESP_ERROR_CHECK(esp_hid_gap_init(ESP_HID_TRANSPORT_BLE));
+    hid_boot_mark(HID_BOOT_CONTROLLER);
+
+    const hid_config_t *conf = hid_config_get();
 
-    /* Advertise as a generic HID */
+    /* Advertise as a generic HID; the custom service UUID lets clients scan for this device */
+    static const uint8_t custom_svc_uuid[16] = CUSTOM_SERVICE_UUID_BASE;
+    esp_hid_ble_gap_set_adv_uuid128(custom_svc_uuid);
     ESP_ERROR_CHECK(esp_hid_ble_gap_adv_init(ESP_HID_APPEARANCE_GENERIC,
-                                             "Azmuth"));
+                                             conf->name));
 
     /* Device-level configuration */
     esp_hid_raw_report_map_t map = {.data = consumer_map,
                                     .len = sizeof(consumer_map)};
 
     esp_hid_device_config_t cfg = {
-        .vendor_id = 0x16C0,
-        .product_id = 0x05DF,
+        .vendor_id = conf->vendor_id,
+        .product_id = conf->product_id,
         .version = 0x0100,
-        .device_name = "Azmuth",
+        .device_name = conf->name,
         .manufacturer_name = "BitForge",
         .serial_number = "123456",
         .report_maps = &map,
@@ -653,9 +406,25 @@ void app_main(void)
     ESP_ERROR_CHECK(esp_hidd_dev_init(&cfg,
                                       ESP_HID_TRANSPORT_BLE,
                                       hid_cb, &hid_dev));
+    hid_boot_mark(HID_BOOT_SERVICES);
+
+    // Needed by the first connection, and all static, so they stay ahead of the host
+    ESP_ERROR_CHECK(hid_output_init(hid_dev));
+    hid_config_set_apply(config_apply);
+    ESP_ERROR_CHECK(hid_cmd_init());
+    ESP_ERROR_CHECK(hid_sched_init(clock_notify));
+
+    esp_err_t err = hid_l2cap_init();
+    if (err != ESP_OK)
+    {
+        ESP_LOGI(TAG, "L2CAP channel off (%s)", esp_err_to_name(err));
+    }
 
     /* Start the NimBLE stack */
     extern void ble_store_config_init(void); /* IDF helper */
     ble_store_config_init();
+    s_prev_sync_cb = ble_hs_cfg.sync_cb;
+    ble_hs_cfg.sync_cb = on_sync;
+    hid_boot_mark(HID_BOOT_HOST_START);
     ESP_ERROR_CHECK(esp_nimble_enable(ble_host_task));
 }